@@ -30,3 +30,7 @@ list(APPEND berkeley_sfm_LIBRARIES ${GFLAGS_LIBRARIES})
 include("cmake/External/glog.cmake")
 include_directories(SYSTEM ${GLOG_INCLUDE_DIRS})
 list(APPEND berkeley_sfm_LIBRARIES ${GLOG_LIBRARIES})
+
+# Find threads, used to match image pairs concurrently.
+find_package( Threads REQUIRED )
+list(APPEND berkeley_sfm_LIBRARIES ${CMAKE_THREAD_LIBS_INIT})
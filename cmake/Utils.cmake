@@ -58,6 +58,18 @@ macro(bsfm_enable_cpp11)
   endif()
 endmacro()
 
+################################################################################
+# Compile for the host CPU, if the compiler supports it.
+macro(bsfm_enable_native_arch)
+  include(CheckCXXCompilerFlag)
+  check_cxx_compiler_flag("-march=native" COMPILER_SUPPORTS_MARCH_NATIVE)
+  if (COMPILER_SUPPORTS_MARCH_NATIVE)
+    set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -march=native")
+  else()
+    message(WARNING "The compiler (${CMAKE_CXX_COMPILER}) does not support -march=native.")
+  endif()
+endmacro()
+
 ################################################################################
 # Set the runtime directory for a target.
 function(bsfm_set_runtime_directory target runtime_dir)
@@ -200,11 +200,22 @@ int main(int argc, char** argv) {
   // RANSAC iterations chosen using ~10% outliers @ 99% chance to sample from
   // Table 4.3 of H&Z.
   vo_options.fundamental_matrix_ransac_options.iterations = 100;
-  vo_options.fundamental_matrix_ransac_options.acceptable_error = 1e-1;
+  vo_options.fundamental_matrix_ransac_options.acceptable_error = 1.0;  // px^2.
   vo_options.fundamental_matrix_ransac_options.minimum_num_inliers = 35;
   vo_options.fundamental_matrix_ransac_options.num_samples = 8;
 
+  // PnP RANSAC stops once it has 99% confidence of having drawn an all-inlier
+  // sample, which usually takes far fewer than the maximum iterations. Samples
+  // are drawn from the closest descriptor matches first, hypotheses are
+  // generated on all cores, bad hypotheses are rejected after checking a few
+  // observations, and only new best hypotheses are locally optimized.
   vo_options.pnp_ransac_options.iterations = 10000;
+  vo_options.pnp_ransac_options.adaptive_iterations = true;
+  vo_options.pnp_ransac_options.use_prosac = true;
+  vo_options.pnp_ransac_options.num_threads = 0;
+  vo_options.pnp_ransac_options.use_sprt = true;
+  vo_options.pnp_ransac_options.use_local_optimization = true;
+  vo_options.pnp_ransac_options.confidence = 0.99;
   vo_options.pnp_ransac_options.acceptable_error = 1.0;
   vo_options.pnp_ransac_options.minimum_num_inliers = 100;
   vo_options.pnp_ransac_options.num_samples = 6;
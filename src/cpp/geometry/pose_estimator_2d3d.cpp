@@ -106,6 +106,21 @@ bool PoseEstimator2D3D::Initialize(const FeatureList& points_2d,
 }
 
 bool PoseEstimator2D3D::Solve(Pose& camera_pose) {
+  // Get an initial solution.
+  Pose initial_pose;
+  if (!SolveLinear(initial_pose))
+    return false;
+  camera_pose = initial_pose;
+
+  // Refine P with non-linear optimization.
+  if (!OptimizePose(camera_pose)) {
+    VLOG(1) << "Failed to optimize camera pose. Continuing using the initial solution.";
+  }
+
+  return true;
+}
+
+bool PoseEstimator2D3D::SolveLinear(Pose& camera_pose) const {
   // Get an initial projection matrix.
   Matrix34d P;
   if (!ComputeInitialSolution(P)) {
@@ -125,11 +140,6 @@ bool PoseEstimator2D3D::Solve(Pose& camera_pose) {
     return false;
   }
 
-  // Refine P with non-linear optimization.
-  if (!OptimizePose(camera_pose)) {
-    VLOG(1) << "Failed to optimize camera pose. Continuing using the initial solution.";
-  }
-
   return true;
 }
 
@@ -89,6 +89,15 @@ class PoseEstimator2D3D {
   // not found, the input pose remains unchanged.
   bool Solve(Pose& camera_pose);
 
+  // Computes the camera pose from the linear initial solution alone, without
+  // refining it. This is much cheaper than Solve(), e.g. for generating RANSAC
+  // hypotheses. If a solution was not found, the input pose remains unchanged.
+  bool SolveLinear(Pose& camera_pose) const;
+
+  // Refines the pose estimate using the Levenberg-Marquardt iterative algorithm
+  // for non-linear least-squares, starting from 'pose'.
+  bool OptimizePose(Pose& pose) const;
+
  private:
   DISALLOW_COPY_AND_ASSIGN(PoseEstimator2D3D)
 
@@ -102,10 +111,6 @@ class PoseEstimator2D3D {
   // with a determinant of 0, which is not a valid rotation matrix.
   bool ExtractPose(const Matrix34d& P, Pose& pose) const;
 
-  // Refines the pose estimate using the Levenberg-Marquardt iterative algorithm
-  // for non-linear least-squares.
-  bool OptimizePose(Pose& pose) const;
-
   // Check if a projection matrix is a good enough initialization to optimize.
   // This check is performed by evaluating the reprojection error (squared pixel
   // distance) between all 2D and 3D feature matches. The error threshold is
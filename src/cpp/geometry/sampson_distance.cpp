@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2015, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ *          Erik Nelson            ( eanelson@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// This file defines methods for computing the Sampson distance of feature
+// matches from the epipolar geometry given by a fundamental matrix.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "sampson_distance.h"
+
+#include <limits>
+
+// The AVX kernel is compiled whenever the target is x86 and the compiler
+// supports per-function targets, and is chosen at run time if the CPU has AVX.
+// Builds that already target AVX call it directly.
+#if defined(__AVX__) || \
+    (defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)))
+#define BSFM_SAMPSON_AVX
+#include <immintrin.h>
+#endif
+
+namespace bsfm {
+
+namespace {
+
+// Epipolar residual x2' * F * x1 of a match, and the squared norm of its
+// gradient with respect to the match coordinates. The squared Sampson distance
+// is their ratio.
+inline void SampsonTerms(const Eigen::Matrix3d& F, double u1, double v1,
+                         double u2, double v2, double* residual,
+                         double* gradient) {
+  // The epipolar lines F * x1 in the second image and F' * x2 in the first.
+  const double l2_u = F(0, 0) * u1 + F(0, 1) * v1 + F(0, 2);
+  const double l2_v = F(1, 0) * u1 + F(1, 1) * v1 + F(1, 2);
+  const double l2_w = F(2, 0) * u1 + F(2, 1) * v1 + F(2, 2);
+  const double l1_u = F(0, 0) * u2 + F(1, 0) * v2 + F(2, 0);
+  const double l1_v = F(0, 1) * u2 + F(1, 1) * v2 + F(2, 1);
+
+  *residual = u2 * l2_u + v2 * l2_v + l2_w;
+  *gradient = l2_u * l2_u + l2_v * l2_v + l1_u * l1_u + l1_v * l1_v;
+}
+
+#ifdef BSFM_SAMPSON_AVX
+// Score matches four at a time, starting from the first, and return the index
+// of the first match that was not scored.
+#ifndef __AVX__
+__attribute__((target("avx")))
+#endif
+size_t SampsonInliersAVX(const Eigen::Matrix3d& F,
+                         const FeatureMatchArrays& matches, double threshold,
+                         std::vector<unsigned char>& inliers,
+                         size_t* num_inliers) {
+  const size_t num_matches = matches.Size();
+  const __m256d f00 = _mm256_set1_pd(F(0, 0)), f01 = _mm256_set1_pd(F(0, 1));
+  const __m256d f02 = _mm256_set1_pd(F(0, 2)), f10 = _mm256_set1_pd(F(1, 0));
+  const __m256d f11 = _mm256_set1_pd(F(1, 1)), f12 = _mm256_set1_pd(F(1, 2));
+  const __m256d f20 = _mm256_set1_pd(F(2, 0)), f21 = _mm256_set1_pd(F(2, 1));
+  const __m256d f22 = _mm256_set1_pd(F(2, 2));
+  const __m256d t = _mm256_set1_pd(threshold);
+
+  size_t ii = 0;
+  for (; ii + 4 <= num_matches; ii += 4) {
+    const __m256d u1 = _mm256_loadu_pd(&matches.u1_[ii]);
+    const __m256d v1 = _mm256_loadu_pd(&matches.v1_[ii]);
+    const __m256d u2 = _mm256_loadu_pd(&matches.u2_[ii]);
+    const __m256d v2 = _mm256_loadu_pd(&matches.v2_[ii]);
+
+    const __m256d l2_u = _mm256_add_pd(
+        _mm256_add_pd(_mm256_mul_pd(f00, u1), _mm256_mul_pd(f01, v1)), f02);
+    const __m256d l2_v = _mm256_add_pd(
+        _mm256_add_pd(_mm256_mul_pd(f10, u1), _mm256_mul_pd(f11, v1)), f12);
+    const __m256d l2_w = _mm256_add_pd(
+        _mm256_add_pd(_mm256_mul_pd(f20, u1), _mm256_mul_pd(f21, v1)), f22);
+    const __m256d l1_u = _mm256_add_pd(
+        _mm256_add_pd(_mm256_mul_pd(f00, u2), _mm256_mul_pd(f10, v2)), f20);
+    const __m256d l1_v = _mm256_add_pd(
+        _mm256_add_pd(_mm256_mul_pd(f01, u2), _mm256_mul_pd(f11, v2)), f21);
+
+    const __m256d residual = _mm256_add_pd(
+        _mm256_add_pd(_mm256_mul_pd(u2, l2_u), _mm256_mul_pd(v2, l2_v)), l2_w);
+    const __m256d gradient = _mm256_add_pd(
+        _mm256_add_pd(_mm256_mul_pd(l2_u, l2_u), _mm256_mul_pd(l2_v, l2_v)),
+        _mm256_add_pd(_mm256_mul_pd(l1_u, l1_u), _mm256_mul_pd(l1_v, l1_v)));
+
+    const int mask = _mm256_movemask_pd(
+        _mm256_cmp_pd(_mm256_mul_pd(residual, residual),
+                      _mm256_mul_pd(t, gradient), _CMP_LT_OQ));
+    for (int jj = 0; jj < 4; ++jj)
+      inliers[ii + jj] = (mask >> jj) & 1;
+    *num_inliers += __builtin_popcount(mask);
+  }
+  return ii;
+}
+
+// Whether the CPU running this code supports AVX. Checked once.
+bool HasAVX() {
+#ifdef __AVX__
+  return true;
+#else
+  static const bool has_avx = __builtin_cpu_supports("avx");
+  return has_avx;
+#endif
+}
+#endif
+
+}  //\namespace
+
+void FeatureMatchArrays::Set(const FeatureMatchList& matches) {
+  u1_.resize(matches.size());
+  v1_.resize(matches.size());
+  u2_.resize(matches.size());
+  v2_.resize(matches.size());
+  for (size_t ii = 0; ii < matches.size(); ++ii) {
+    u1_[ii] = matches[ii].feature1_.u_;
+    v1_[ii] = matches[ii].feature1_.v_;
+    u2_[ii] = matches[ii].feature2_.u_;
+    v2_[ii] = matches[ii].feature2_.v_;
+  }
+}
+
+double SampsonDistance(const Eigen::Matrix3d& F, double u1, double v1,
+                       double u2, double v2) {
+  double residual = 0.0, gradient = 0.0;
+  SampsonTerms(F, u1, v1, u2, v2, &residual, &gradient);
+  if (!(gradient > 0.0))
+    return std::numeric_limits<double>::infinity();
+  return residual * residual / gradient;
+}
+
+double SampsonDistance(const Eigen::Matrix3d& F, const FeatureMatch& match) {
+  return SampsonDistance(F, match.feature1_.u_, match.feature1_.v_,
+                         match.feature2_.u_, match.feature2_.v_);
+}
+
+size_t SampsonInliers(const Eigen::Matrix3d& F,
+                      const FeatureMatchArrays& matches, double threshold,
+                      std::vector<unsigned char>& inliers) {
+  const size_t num_matches = matches.Size();
+  inliers.resize(num_matches);
+  size_t num_inliers = 0;
+
+  // Matches are inliers if residual^2 < threshold * gradient, which avoids a
+  // division and rejects matches where the distance is undefined.
+  size_t ii = 0;
+#ifdef BSFM_SAMPSON_AVX
+  if (HasAVX())
+    ii = SampsonInliersAVX(F, matches, threshold, inliers, &num_inliers);
+#endif
+
+  for (; ii < num_matches; ++ii) {
+    double residual = 0.0, gradient = 0.0;
+    SampsonTerms(F, matches.u1_[ii], matches.v1_[ii], matches.u2_[ii],
+                 matches.v2_[ii], &residual, &gradient);
+    inliers[ii] = residual * residual < threshold * gradient;
+    num_inliers += inliers[ii];
+  }
+
+  return num_inliers;
+}
+
+}  //\namespace bsfm
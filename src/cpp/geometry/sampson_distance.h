@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2015, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ *          Erik Nelson            ( eanelson@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// This file defines methods for computing the Sampson distance of feature
+// matches from the epipolar geometry given by a fundamental matrix. The squared
+// Sampson distance is a first order approximation of the squared distance (in
+// pixels) that the features of a match must be moved to satisfy the epipolar
+// constraint x2' * F * x1 = 0. Matches can be scored in batches from a
+// structure of arrays, four at a time with AVX when the CPU supports it.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef BSFM_GEOMETRY_SAMPSON_DISTANCE_H
+#define BSFM_GEOMETRY_SAMPSON_DISTANCE_H
+
+#include <Eigen/Core>
+#include <vector>
+
+#include "../matching/feature_match.h"
+
+namespace bsfm {
+
+// Image space coordinates of a list of feature matches, with one array per
+// coordinate so that consecutive matches can be loaded into SIMD registers.
+struct FeatureMatchArrays {
+  // Gather the coordinates of 'matches'.
+  void Set(const FeatureMatchList& matches);
+
+  size_t Size() const { return u1_.size(); }
+
+  std::vector<double> u1_;
+  std::vector<double> v1_;
+  std::vector<double> u2_;
+  std::vector<double> v2_;
+};  //\struct FeatureMatchArrays
+
+// Squared Sampson distance of the match (u1, v1) <--> (u2, v2) under 'F'.
+// Returns infinity if the distance is undefined.
+double SampsonDistance(const Eigen::Matrix3d& F, double u1, double v1,
+                       double u2, double v2);
+
+// Squared Sampson distance of 'match' under 'F'.
+double SampsonDistance(const Eigen::Matrix3d& F, const FeatureMatch& match);
+
+// Mark the matches whose squared Sampson distance under 'F' is below
+// 'threshold' in 'inliers', which is resized to the number of matches. Returns
+// the number of inliers.
+size_t SampsonInliers(const Eigen::Matrix3d& F,
+                      const FeatureMatchArrays& matches, double threshold,
+                      std::vector<unsigned char>& inliers);
+
+}  //\namespace bsfm
+
+#endif
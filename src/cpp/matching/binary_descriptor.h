@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2015, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: Erik Nelson            ( eanelson@eecs.berkeley.edu )
+ *          David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// The BinaryDescriptor class stores a packed binary feature descriptor (ORB,
+// BRIEF, BRISK, FREAK) with inline storage for up to 512 bits. Bits are kept in
+// 64-bit words so that Hamming distances can be computed with one popcount per
+// word (see hamming_distance.h). Unused trailing bits are always zero.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef BSFM_MATCHING_BINARY_DESCRIPTOR_H
+#define BSFM_MATCHING_BINARY_DESCRIPTOR_H
+
+#include <cstdint>
+#include <cstring>
+#include <glog/logging.h>
+#include <vector>
+
+#include "../util/types.h"
+
+namespace bsfm {
+
+class BinaryDescriptor {
+ public:
+  // Maximum descriptor length. ORB and BRIEF use 32 bytes, BRISK and FREAK use
+  // 64 bytes.
+  static constexpr size_t kMaxBytes = 64;
+  static constexpr size_t kMaxWords = kMaxBytes / sizeof(uint64_t);
+
+  // An empty descriptor.
+  BinaryDescriptor() : num_bytes_(0) {
+    std::memset(words_, 0, sizeof(words_));
+  }
+
+  // Pack 'num_bytes' bytes of descriptor data.
+  BinaryDescriptor(const unsigned char* bytes, size_t num_bytes)
+      : num_bytes_(static_cast<uint32_t>(num_bytes)) {
+    CHECK(num_bytes <= kMaxBytes) << "Binary descriptors are limited to "
+                                   << kMaxBytes << " bytes.";
+    std::memset(words_, 0, sizeof(words_));
+    if (num_bytes > 0) {
+      CHECK_NOTNULL(bytes);
+      std::memcpy(words_, bytes, num_bytes);
+    }
+  }
+
+  // Pack a descriptor that was stored as one double per byte, e.g. the output
+  // of DescriptorExtractor::DescribeFeatures() for a binary descriptor type.
+  static BinaryDescriptor FromDescriptor(const Descriptor& descriptor) {
+    CHECK(static_cast<size_t>(descriptor.size()) <= kMaxBytes);
+    unsigned char bytes[kMaxBytes];
+    for (int ii = 0; ii < descriptor.size(); ++ii)
+      bytes[ii] = static_cast<unsigned char>(descriptor(ii));
+    return BinaryDescriptor(bytes, descriptor.size());
+  }
+
+  // Unpack to one double per byte.
+  ::bsfm::Descriptor ToDescriptor() const {
+    ::bsfm::Descriptor descriptor(num_bytes_);
+    const unsigned char* bytes = Data();
+    for (size_t ii = 0; ii < num_bytes_; ++ii)
+      descriptor(ii) = static_cast<double>(bytes[ii]);
+    return descriptor;
+  }
+
+  // Accessors.
+  size_t Bytes() const { return num_bytes_; }
+  size_t Bits() const { return 8 * num_bytes_; }
+  size_t Words() const {
+    return (num_bytes_ + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+  }
+  bool Empty() const { return num_bytes_ == 0; }
+  const unsigned char* Data() const {
+    return reinterpret_cast<const unsigned char*>(words_);
+  }
+  const uint64_t* WordData() const { return words_; }
+
+  bool operator==(const BinaryDescriptor& other) const {
+    return num_bytes_ == other.num_bytes_ &&
+           std::memcmp(words_, other.words_, sizeof(words_)) == 0;
+  }
+  bool operator!=(const BinaryDescriptor& other) const {
+    return !(*this == other);
+  }
+
+ private:
+  uint64_t words_[kMaxWords];
+  uint32_t num_bytes_;
+};  //\class BinaryDescriptor
+
+typedef std::vector<BinaryDescriptor> BinaryDescriptorList;
+
+}  //\namespace bsfm
+
+#endif
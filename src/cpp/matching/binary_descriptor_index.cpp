@@ -0,0 +1,260 @@
+/*
+ * Copyright (c) 2015, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: Erik Nelson            ( eanelson@eecs.berkeley.edu )
+ *          David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+#include "binary_descriptor_index.h"
+#include "hamming_distance.h"
+
+#include <algorithm>
+#include <glog/logging.h>
+#include <queue>
+#include <utility>
+
+namespace bsfm {
+
+namespace {
+
+// Number of ways to choose 'k' of 'n' items, as a double to avoid overflow.
+double Choose(unsigned int n, unsigned int k) {
+  double result = 1.0;
+  for (unsigned int ii = 1; ii <= k; ++ii)
+    result = result * (n - k + ii) / ii;
+  return result;
+}
+
+// Sort neighbors by distance, breaking ties by index, and split them into
+// output lists.
+void SortNeighbors(std::vector<std::pair<int, int> >& neighbors,
+                   std::vector<int>& nn_indices,
+                   std::vector<int>& nn_distances) {
+  std::sort(neighbors.begin(), neighbors.end());
+  nn_indices.clear();
+  nn_distances.clear();
+  for (const auto& neighbor : neighbors) {
+    nn_distances.push_back(neighbor.first);
+    nn_indices.push_back(neighbor.second);
+  }
+}
+
+}  //\namespace
+
+BinaryDescriptorIndex::BinaryDescriptorIndex(unsigned int substring_bits)
+    : substring_bits_(substring_bits), num_substrings_(0) {
+  CHECK(substring_bits_ == 8 || substring_bits_ == 16 || substring_bits_ == 32)
+      << "Substrings must be 8, 16, or 32 bits.";
+}
+
+BinaryDescriptorIndex::~BinaryDescriptorIndex() {}
+
+void BinaryDescriptorIndex::AddDescriptor(const BinaryDescriptor& descriptor) {
+  // The first descriptor determines how many substrings there are.
+  if (descriptors_.empty()) {
+    num_substrings_ =
+        (descriptor.Bits() + substring_bits_ - 1) / substring_bits_;
+    tables_.assign(num_substrings_,
+                   std::unordered_map<uint32_t, std::vector<int> >());
+  } else {
+    CHECK_EQ(descriptors_[0].Bytes(), descriptor.Bytes());
+  }
+
+  const int index = descriptors_.size();
+  descriptors_.push_back(descriptor);
+  for (unsigned int ii = 0; ii < num_substrings_; ++ii)
+    tables_[ii][Substring(descriptor, ii)].push_back(index);
+}
+
+void BinaryDescriptorIndex::AddDescriptors(
+    const std::vector<BinaryDescriptor>& descriptors) {
+  descriptors_.reserve(descriptors_.size() + descriptors.size());
+  for (const auto& descriptor : descriptors)
+    AddDescriptor(descriptor);
+}
+
+size_t BinaryDescriptorIndex::Size() const {
+  return descriptors_.size();
+}
+
+bool BinaryDescriptorIndex::NearestNeighbor(const BinaryDescriptor& query,
+                                            int& nn_index,
+                                            int& nn_distance) const {
+  std::vector<int> nn_indices, nn_distances;
+  KNearestNeighbors(query, 1, nn_indices, nn_distances);
+  if (nn_indices.empty()) {
+    VLOG(1) << "Descriptors must be added before querying the index.";
+    return false;
+  }
+
+  nn_index = nn_indices[0];
+  nn_distance = nn_distances[0];
+  return true;
+}
+
+void BinaryDescriptorIndex::KNearestNeighbors(
+    const BinaryDescriptor& query, unsigned int k, std::vector<int>& nn_indices,
+    std::vector<int>& nn_distances) const {
+  nn_indices.clear();
+  nn_distances.clear();
+  if (descriptors_.empty() || k == 0)
+    return;
+
+  // Keep the best k (distance, index) pairs seen so far in a max heap.
+  std::priority_queue<std::pair<int, int> > best;
+  auto visit = [&](int index, int distance) {
+    const std::pair<int, int> neighbor(distance, index);
+    if (best.size() < k) {
+      best.push(neighbor);
+    } else if (neighbor < best.top()) {
+      best.pop();
+      best.push(neighbor);
+    }
+  };
+
+  std::vector<char> visited(descriptors_.size(), false);
+  if (k >= descriptors_.size()) {
+    SearchAll(query, visited, visit);
+  } else {
+    for (unsigned int radius = 0; radius <= substring_bits_; ++radius) {
+      if (!SearchRadius(query, radius, visited, visit)) {
+        SearchAll(query, visited, visit);
+        break;
+      }
+
+      // Every descriptor within m * (radius + 1) - 1 has now been visited.
+      const int searched_distance = num_substrings_ * (radius + 1) - 1;
+      if (best.size() == k && best.top().first <= searched_distance)
+        break;
+    }
+  }
+
+  std::vector<std::pair<int, int> > neighbors;
+  while (!best.empty()) {
+    neighbors.push_back(best.top());
+    best.pop();
+  }
+  SortNeighbors(neighbors, nn_indices, nn_distances);
+}
+
+void BinaryDescriptorIndex::RadiusSearch(const BinaryDescriptor& query,
+                                         int radius,
+                                         std::vector<int>& nn_indices,
+                                         std::vector<int>& nn_distances) const {
+  nn_indices.clear();
+  nn_distances.clear();
+  if (descriptors_.empty() || radius < 0)
+    return;
+
+  std::vector<std::pair<int, int> > neighbors;
+  auto visit = [&](int index, int distance) {
+    if (distance <= radius)
+      neighbors.push_back(std::make_pair(distance, index));
+  };
+
+  // Descriptors within 'radius' have a substring within radius / m.
+  std::vector<char> visited(descriptors_.size(), false);
+  const unsigned int max_substring_radius =
+      std::min(static_cast<unsigned int>(radius) / num_substrings_,
+               substring_bits_);
+  for (unsigned int ii = 0; ii <= max_substring_radius; ++ii) {
+    if (!SearchRadius(query, ii, visited, visit)) {
+      SearchAll(query, visited, visit);
+      break;
+    }
+  }
+
+  SortNeighbors(neighbors, nn_indices, nn_distances);
+}
+
+uint32_t BinaryDescriptorIndex::Substring(const BinaryDescriptor& descriptor,
+                                          unsigned int substring) const {
+  const size_t first_bit = substring * substring_bits_;
+  const uint64_t word = descriptor.WordData()[first_bit / 64];
+  const uint64_t mask = (uint64_t(1) << substring_bits_) - 1;
+  return static_cast<uint32_t>((word >> (first_bit % 64)) & mask);
+}
+
+template <typename Visitor>
+bool BinaryDescriptorIndex::SearchRadius(const BinaryDescriptor& query,
+                                         unsigned int radius,
+                                         std::vector<char>& visited,
+                                         Visitor visit) const {
+  CHECK_EQ(descriptors_[0].Bytes(), query.Bytes());
+
+  // Enumerating substrings costs more than a linear scan past this point.
+  if (Choose(substring_bits_, radius) * num_substrings_ >
+      static_cast<double>(descriptors_.size()))
+    return false;
+
+  // Probe every substring value that differs from the query's in exactly
+  // 'radius' bits. Flip masks with 'radius' bits set are enumerated in
+  // increasing order with Gosper's hack.
+  const uint64_t end = uint64_t(1) << substring_bits_;
+  for (unsigned int ii = 0; ii < num_substrings_; ++ii) {
+    const uint32_t key = Substring(query, ii);
+    uint64_t flips = (uint64_t(1) << radius) - 1;
+    while (flips < end) {
+      const auto bucket = tables_[ii].find(key ^ static_cast<uint32_t>(flips));
+      if (bucket != tables_[ii].end()) {
+        for (const auto& index : bucket->second) {
+          if (visited[index])
+            continue;
+          visited[index] = true;
+          visit(index, HammingDistance(query, descriptors_[index]));
+        }
+      }
+
+      if (flips == 0)
+        break;
+      const uint64_t lowest = flips & -flips;
+      const uint64_t ripple = flips + lowest;
+      flips = (((ripple ^ flips) >> 2) / lowest) | ripple;
+    }
+  }
+  return true;
+}
+
+template <typename Visitor>
+void BinaryDescriptorIndex::SearchAll(const BinaryDescriptor& query,
+                                      std::vector<char>& visited,
+                                      Visitor visit) const {
+  for (size_t ii = 0; ii < descriptors_.size(); ++ii) {
+    if (visited[ii])
+      continue;
+    visited[ii] = true;
+    visit(ii, HammingDistance(query, descriptors_[ii]));
+  }
+}
+
+}  //\namespace bsfm
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2015, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: Erik Nelson            ( eanelson@eecs.berkeley.edu )
+ *          David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// The BinaryDescriptorIndex class is a multi-index hashing index (Norouzi et
+// al., "Fast Search in Hamming Space with Multi-Index Hashing", CVPR 2012) for
+// exact nearest neighbor search over packed binary descriptors. Each
+// descriptor is split into m disjoint substrings, and each substring is stored
+// in its own hash table. If two descriptors are within Hamming distance
+// m * (s + 1) - 1, at least one of their substrings is within distance s, so
+// searching the tables for substrings at increasing distance s from the query
+// finds all near neighbors while only touching a small fraction of the index.
+//
+// Descriptors can be added incrementally. Indices returned by queries are
+// based on the order in which descriptors were added.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef BSFM_MATCHING_BINARY_DESCRIPTOR_INDEX_H
+#define BSFM_MATCHING_BINARY_DESCRIPTOR_INDEX_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "binary_descriptor.h"
+
+#include "../util/disallow_copy_and_assign.h"
+
+namespace bsfm {
+
+class BinaryDescriptorIndex {
+ public:
+  // Substrings are 'substring_bits' long, which must be 8, 16, or 32. The
+  // default suits indices of up to a few hundred thousand descriptors.
+  explicit BinaryDescriptorIndex(unsigned int substring_bits = 16);
+  ~BinaryDescriptorIndex();
+
+  // Add descriptors to the index. All descriptors must have the same length.
+  void AddDescriptor(const BinaryDescriptor& descriptor);
+  void AddDescriptors(const std::vector<BinaryDescriptor>& descriptors);
+
+  // Number of descriptors in the index.
+  size_t Size() const;
+
+  // Find the nearest neighbor of 'query'. Returns false if the index is empty.
+  bool NearestNeighbor(const BinaryDescriptor& query, int& nn_index,
+                       int& nn_distance) const;
+
+  // Find the (at most) 'k' nearest neighbors of 'query', sorted by increasing
+  // distance.
+  void KNearestNeighbors(const BinaryDescriptor& query, unsigned int k,
+                         std::vector<int>& nn_indices,
+                         std::vector<int>& nn_distances) const;
+
+  // Find all descriptors within Hamming distance 'radius' of 'query', sorted by
+  // increasing distance.
+  void RadiusSearch(const BinaryDescriptor& query, int radius,
+                    std::vector<int>& nn_indices,
+                    std::vector<int>& nn_distances) const;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(BinaryDescriptorIndex)
+
+  // Get substring 'substring' of a descriptor.
+  uint32_t Substring(const BinaryDescriptor& descriptor,
+                     unsigned int substring) const;
+
+  // Compare 'query' against every descriptor in the index that has not been
+  // visited yet and whose substring in some table is exactly 'radius' bits
+  // from the query's. Calls 'visit(index, distance)' for each one. Returns
+  // false if there are too many substrings at that radius to enumerate, in
+  // which case nothing is visited.
+  template <typename Visitor>
+  bool SearchRadius(const BinaryDescriptor& query, unsigned int radius,
+                    std::vector<char>& visited, Visitor visit) const;
+
+  // Compare 'query' against every descriptor in the index that has not been
+  // visited yet.
+  template <typename Visitor>
+  void SearchAll(const BinaryDescriptor& query, std::vector<char>& visited,
+                 Visitor visit) const;
+
+  // Substring length and the number of substrings in each descriptor.
+  unsigned int substring_bits_;
+  unsigned int num_substrings_;
+
+  // All descriptors, and one hash table per substring mapping substring values
+  // to the indices of descriptors that contain them.
+  std::vector<BinaryDescriptor> descriptors_;
+  std::vector<std::unordered_map<uint32_t, std::vector<int> > > tables_;
+};  //\class BinaryDescriptorIndex
+
+}  //\namespace bsfm
+
+#endif
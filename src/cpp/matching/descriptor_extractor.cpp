@@ -72,6 +72,70 @@ bool DescriptorExtractor::DescribeFeatures(
     const Image& image, KeypointList& keypoints,
     std::vector<Feature>& features_out,
     std::vector<Descriptor>& descriptors_out) {
+  cv::Mat cv_descriptors;
+  if (!ComputeDescriptors(image, keypoints, features_out, cv_descriptors)) {
+    return false;
+  }
+
+  // Convert the computed OpenCV-type descriptors into a list of descriptors.
+  // Floating point descriptors are normalized here, once, so that they can be
+  // compared with the SCALED_L2 metric without normalizing them again. Binary
+  // strings are left as they are for the HAMMING metric.
+  const bool normalize = !IsBinary();
+  descriptors_out.reserve(descriptors_out.size() + keypoints.size());
+  for (size_t ii = 0; ii < keypoints.size(); ++ii) {
+    MatrixXd descriptor_mat;
+    OpenCVToEigenMat<double>(cv_descriptors.row(ii), descriptor_mat);
+
+    // Need to explicitly convert from matrix to vector.
+    descriptors_out.push_back(descriptor_mat.row(0).transpose());
+    if (normalize) {
+      descriptors_out.back().normalize();
+    }
+  }
+
+  return true;
+}
+
+bool DescriptorExtractor::DescribeFeatures(
+    const Image& image, KeypointList& keypoints,
+    std::vector<Feature>& features_out,
+    std::vector<BinaryDescriptor>& descriptors_out) {
+  if (!IsBinary()) {
+    VLOG(1) << "Descriptor type \"" << descriptor_type_
+            << "\" is not binary. Failed to extract binary descriptors.";
+    return false;
+  }
+
+  cv::Mat cv_descriptors;
+  if (!ComputeDescriptors(image, keypoints, features_out, cv_descriptors)) {
+    return false;
+  }
+  CHECK_EQ(CV_8U, cv_descriptors.depth());
+
+  // Pack the rows of the OpenCV descriptor matrix directly, without a detour
+  // through double precision.
+  descriptors_out.reserve(descriptors_out.size() + keypoints.size());
+  for (size_t ii = 0; ii < keypoints.size(); ++ii) {
+    descriptors_out.push_back(
+        BinaryDescriptor(cv_descriptors.ptr<unsigned char>(ii),
+                         cv_descriptors.cols * cv_descriptors.elemSize()));
+  }
+
+  return true;
+}
+
+bool DescriptorExtractor::IsBinary() const {
+  return descriptor_type_.compare("BRIEF") == 0 ||
+         descriptor_type_.compare("BRISK") == 0 ||
+         descriptor_type_.compare("FREAK") == 0 ||
+         descriptor_type_.compare("ORB") == 0;
+}
+
+bool DescriptorExtractor::ComputeDescriptors(const Image& image,
+                                             KeypointList& keypoints,
+                                             std::vector<Feature>& features_out,
+                                             cv::Mat& cv_descriptors) {
   // Make the user has called SetDescriptor().
   if (descriptor_type_.empty()) {
     VLOG(1)
@@ -93,7 +157,6 @@ bool DescriptorExtractor::DescribeFeatures(
   }
 
   // Extract descriptors from the provided keypoints in the image.
-  cv::Mat cv_descriptors;
   try {
     extractor_->compute(cv_image, keypoints, cv_descriptors);
   } catch (const std::exception& e) {
@@ -101,20 +164,12 @@ bool DescriptorExtractor::DescribeFeatures(
     return false;
   }
 
-  // Convert the computed OpenCV-type descriptors and keypoints into a list of
-  // features and descriptors.
+  // Convert the OpenCV-type keypoints into a list of features.
   for (size_t ii = 0; ii < keypoints.size(); ++ii) {
     Feature feature;
     feature.u_ = keypoints[ii].pt.x;
     feature.v_ = keypoints[ii].pt.y;
     features_out.push_back(feature);
-
-    MatrixXd descriptor_mat;
-    OpenCVToEigenMat<double>(cv_descriptors.row(ii), descriptor_mat);
-
-    // Need to explicitly convert from matrix to vector.
-    Descriptor descriptor = descriptor_mat.row(0).transpose();
-    descriptors_out.push_back(descriptor);
   }
 
   return true;
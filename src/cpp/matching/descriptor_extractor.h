@@ -42,6 +42,7 @@
 #include <glog/logging.h>
 #include <opencv2/features2d/features2d.hpp>
 
+#include "binary_descriptor.h"
 #include "feature.h"
 #include "keypoint_detector.h"
 
@@ -63,14 +64,31 @@ class DescriptorExtractor {
   bool SetDescriptor(const std::string& descriptor_type);
 
   // Creates a list of features by extracting descriptors for each keypoint and
-  // associating the two together into an object.
+  // associating the two together into an object. Descriptors of floating point
+  // types (SIFT, SURF) are normalized to unit length.
   bool DescribeFeatures(const Image& image, KeypointList& keypoints,
                         std::vector<Feature>& features_out,
                         std::vector<Descriptor>& descriptors_out);
 
+  // Same as above, but packs descriptors into binary descriptors. Only valid
+  // for binary descriptor types (see IsBinary()).
+  bool DescribeFeatures(const Image& image, KeypointList& keypoints,
+                        std::vector<Feature>& features_out,
+                        std::vector<BinaryDescriptor>& descriptors_out);
+
+  // Returns true if the descriptor type produces binary strings that should be
+  // compared with the Hamming distance (BRIEF, BRISK, FREAK, ORB).
+  bool IsBinary() const;
+
  private:
   DISALLOW_COPY_AND_ASSIGN(DescriptorExtractor)
 
+  // Compute OpenCV descriptors for the keypoints in the image, and convert
+  // keypoints to features.
+  bool ComputeDescriptors(const Image& image, KeypointList& keypoints,
+                          std::vector<Feature>& features_out,
+                          cv::Mat& cv_descriptors);
+
   std::string descriptor_type_;
   cv::Ptr<cv::DescriptorExtractor> extractor_;
 };  //\class DescriptorExtractor
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2015, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: Erik Nelson            ( eanelson@eecs.berkeley.edu )
+ *          David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+#include "descriptor_matrix.h"
+
+#include <cmath>
+#include <glog/logging.h>
+
+namespace bsfm {
+
+DescriptorMatrix::DescriptorMatrix()
+    : rows_(0), cols_(0), quantized_(false) {}
+
+DescriptorMatrix::~DescriptorMatrix() {}
+
+void DescriptorMatrix::SetDescriptors(
+    const std::vector<Descriptor>& descriptors, bool quantize) {
+  rows_ = descriptors.size();
+  cols_ = descriptors.empty() ? 0 : descriptors[0].size();
+  quantized_ = quantize;
+
+  if (!quantized_) {
+    quantized_data_.resize(0, 0);
+    scales_.resize(0);
+    data_.resize(rows_, cols_);
+    for (size_t ii = 0; ii < rows_; ++ii) {
+      CHECK_EQ(cols_, static_cast<size_t>(descriptors[ii].size()));
+      data_.row(ii) = descriptors[ii].transpose().cast<float>();
+    }
+    return;
+  }
+
+  data_.resize(0, 0);
+  quantized_data_.resize(rows_, cols_);
+  scales_.resize(rows_);
+  for (size_t ii = 0; ii < rows_; ++ii) {
+    CHECK_EQ(cols_, static_cast<size_t>(descriptors[ii].size()));
+    const double max_coefficient =
+        cols_ > 0 ? descriptors[ii].cwiseAbs().maxCoeff() : 0.0;
+    const double scale = max_coefficient > 0.0 ? max_coefficient / 127.0 : 1.0;
+    scales_(ii) = static_cast<float>(scale);
+    for (size_t jj = 0; jj < cols_; ++jj) {
+      quantized_data_(ii, jj) =
+          static_cast<int8_t>(std::round(descriptors[ii](jj) / scale));
+    }
+  }
+}
+
+size_t DescriptorMatrix::Rows() const {
+  return rows_;
+}
+
+size_t DescriptorMatrix::Cols() const {
+  return cols_;
+}
+
+bool DescriptorMatrix::IsQuantized() const {
+  return quantized_;
+}
+
+void DescriptorMatrix::GetBlock(size_t first_row, size_t num_rows,
+                                RowMatrixXf& block) const {
+  CHECK_LE(first_row + num_rows, rows_);
+  if (!quantized_) {
+    block = data_.middleRows(first_row, num_rows);
+    return;
+  }
+
+  block = quantized_data_.middleRows(first_row, num_rows).cast<float>();
+  block.array().colwise() *= scales_.segment(first_row, num_rows).array();
+}
+
+}  //\namespace bsfm
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2015, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: Erik Nelson            ( eanelson@eecs.berkeley.edu )
+ *          David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// The DescriptorMatrix class stores all floating point descriptors from one
+// image (or one set of landmarks) as a single contiguous row-major matrix, one
+// descriptor per row. Storage is single precision, or optionally 8-bit
+// quantized with a per-row scale, which cuts memory by 8x relative to a list
+// of Descriptors. Blocks of rows are handed out in single precision for
+// matrix-matrix products (see dot_product_matcher.h).
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef BSFM_MATCHING_DESCRIPTOR_MATRIX_H
+#define BSFM_MATCHING_DESCRIPTOR_MATRIX_H
+
+#include <Eigen/Core>
+#include <cstdint>
+#include <vector>
+
+#include "../util/types.h"
+
+namespace bsfm {
+
+// Row-major single precision matrix, with one descriptor per row.
+typedef ::Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic,
+                        Eigen::RowMajor> RowMatrixXf;
+
+class DescriptorMatrix {
+ public:
+  DescriptorMatrix();
+  ~DescriptorMatrix();
+
+  // Copy descriptors into the matrix. All descriptors must have the same
+  // length. If 'quantize' is true, each descriptor is stored as signed 8-bit
+  // integers scaled by the descriptor's largest absolute value.
+  void SetDescriptors(const std::vector<Descriptor>& descriptors,
+                      bool quantize = false);
+
+  // Accessors.
+  size_t Rows() const;
+  size_t Cols() const;
+  bool IsQuantized() const;
+
+  // Copy rows [first_row, first_row + num_rows) into 'block' in single
+  // precision, dequantizing if necessary.
+  void GetBlock(size_t first_row, size_t num_rows, RowMatrixXf& block) const;
+
+ private:
+  // Number of descriptors and descriptor length.
+  size_t rows_;
+  size_t cols_;
+
+  // Either 'data_' or 'quantized_data_' and 'scales_' are populated,
+  // depending on whether or not descriptors were quantized.
+  RowMatrixXf data_;
+  ::Eigen::Matrix<int8_t, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>
+      quantized_data_;
+  ::Eigen::VectorXf scales_;
+  bool quantized_;
+};  //\class DescriptorMatrix
+
+}  //\namespace bsfm
+
+#endif
@@ -39,9 +39,23 @@
 
 namespace bsfm {
 
-DistanceMetric& DistanceMetric::Instance() {
-  static DistanceMetric instance;
-  return instance;
+constexpr DistanceMetric::Metric ScaledL2Metric::kMetric;
+constexpr bool ScaledL2Metric::kNormalizes;
+constexpr DistanceMetric::Metric HammingMetric::kMetric;
+constexpr bool HammingMetric::kNormalizes;
+
+DistanceMetric::DistanceMetric()
+    : metric_(SCALED_L2),
+      maximum_distance_(std::numeric_limits<double>::max()) {}
+
+DistanceMetric::Metric DistanceMetric::Parse(const std::string& metric) {
+  if (metric.compare("SCALED_L2") == 0) {
+    return SCALED_L2;
+  } else if (metric.compare("HAMMING") == 0) {
+    return HAMMING;
+  }
+  LOG(WARNING) << "Invalid distance metric. Setting to SCALED_L2.";
+  return SCALED_L2;
 }
 
 void DistanceMetric::SetMetric(const Metric& metric) {
@@ -49,14 +63,11 @@ void DistanceMetric::SetMetric(const Metric& metric) {
 }
 
 void DistanceMetric::SetMetric(const std::string& metric) {
-  if (metric.compare("SCALED_L2") == 0) {
-    SetMetric(Metric::SCALED_L2);
-  } else if (metric.compare("HAMMING") == 0) {
-    SetMetric(Metric::HAMMING);
-  } else {
-    LOG(WARNING) << "Invalid distance metric. Setting to SCALED_L2.";
-    SetMetric(Metric::SCALED_L2);
-  }
+  SetMetric(Parse(metric));
+}
+
+DistanceMetric::Metric DistanceMetric::GetMetric() const {
+  return metric_;
 }
 
 void DistanceMetric::SetMaximumDistance(double maximum_distance) {
@@ -68,18 +79,37 @@ double DistanceMetric::Max() const {
 }
 
 double DistanceMetric::operator()(const Descriptor& descriptor1,
-                                  const Descriptor& descriptor2) {
-  double distance = 0.0;
+                                  const Descriptor& descriptor2) const {
+  CHECK_EQ(descriptor1.size(), descriptor2.size());
   switch (metric_) {
     case SCALED_L2:
-      distance = GetScaledL2Distance(descriptor1, descriptor2);
-      break;
+      return ScaledL2Metric()(descriptor1, descriptor2);
     case HAMMING:
-      distance = GetHammingDistance(descriptor1, descriptor2);
-      break;
+      return HammingMetric()(descriptor1, descriptor2);
+    // No default to catch incompatible types at compile time.
+  }
+  return 0.0;
+}
+
+double DistanceMetric::Bounded(const Descriptor& descriptor1,
+                               const Descriptor& descriptor2,
+                               double bound) const {
+  CHECK_EQ(descriptor1.size(), descriptor2.size());
+  switch (metric_) {
+    case SCALED_L2:
+      return ScaledL2Metric().Bounded(descriptor1, descriptor2, bound);
+    case HAMMING:
+      return HammingMetric().Bounded(descriptor1, descriptor2, bound);
     // No default to catch incompatible types at compile time.
   }
-  return distance;
+  return 0.0;
+}
+
+double DistanceMetric::operator()(const BinaryDescriptor& descriptor1,
+                                  const BinaryDescriptor& descriptor2) const {
+  CHECK(metric_ == HAMMING) << "Binary descriptors require the HAMMING metric.";
+  CHECK_EQ(descriptor1.Bytes(), descriptor2.Bytes());
+  return HammingMetric()(descriptor1, descriptor2);
 }
 
 bool DistanceMetric::MaybeNormalizeDescriptors(
@@ -87,7 +117,7 @@ bool DistanceMetric::MaybeNormalizeDescriptors(
   bool normalized = false;
   switch (metric_) {
     case SCALED_L2:
-      NormalizeDescriptors(descriptors);
+      ScaledL2Metric().NormalizeDescriptors(descriptors);
       normalized = true;
       break;
     case HAMMING:
@@ -98,35 +128,4 @@ bool DistanceMetric::MaybeNormalizeDescriptors(
   return normalized;
 }
 
-// Hidden constructor.
-DistanceMetric::DistanceMetric()
-    : maximum_distance_(std::numeric_limits<double>::max()) {
-  SetMetric(Metric::SCALED_L2);
-}
-
-double DistanceMetric::GetScaledL2Distance(
-    const Descriptor& descriptor1, const Descriptor& descriptor2) const {
-  CHECK_EQ(descriptor1.size(), descriptor2.size());
-  return 1.0 - descriptor1.dot(descriptor2);
-}
-
-double DistanceMetric::GetHammingDistance(const Descriptor& descriptor1,
-                                          const Descriptor& descriptor2) const {
-  CHECK_EQ(descriptor1.size(), descriptor2.size());
-  int sum = 0;
-  for (size_t ii = 0; ii < descriptor1.size(); ++ii) {
-    unsigned char d1 = static_cast<unsigned char>(descriptor1(ii));
-    unsigned char d2 = static_cast<unsigned char>(descriptor2(ii));
-    sum += d1 ^ d2;
-  }
-  return static_cast<double>(sum);
-}
-
-void DistanceMetric::NormalizeDescriptors(
-    std::vector<Descriptor>& descriptors) const {
-  for (auto& descriptor : descriptors) {
-    descriptor.normalize();
-  }
-}
-
 }  //\namespace bsfm
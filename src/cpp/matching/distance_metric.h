@@ -37,9 +37,14 @@
 
 ///////////////////////////////////////////////////////////////////////////////
 //
-// The DistanceMetric class defines a singleton that computes distances between
-// two descriptors. The descriptor and distance metric have global access via
-// the DistanceMetric::Instance() method.
+// This file defines distance metrics between two descriptors. ScaledL2Metric
+// and HammingMetric each compute a single metric, and are passed as template
+// parameters to matchers so that distances are inlined into their inner loops.
+// They hold no state, so any number of threads may share them.
+//
+// The DistanceMetric class chooses between the two at run time, and holds an
+// optional maximum distance. Code that needs many distances should switch on
+// DistanceMetric::Parse() once and call a templated function instead.
 //
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -47,9 +52,14 @@
 #define BSFM_MATCHING_DISTANCE_METRIC_H
 
 #include <Eigen/Core>
+#include <cmath>
 #include <glog/logging.h>
 #include <limits>
+#include <string>
+#include <vector>
 
+#include "binary_descriptor.h"
+#include "hamming_distance.h"
 #include "../util/disallow_copy_and_assign.h"
 #include "../util/types.h"
 
@@ -63,8 +73,12 @@ class DistanceMetric {
     HAMMING
   };
 
-  // Get the singleton instance of the distance metric.
-  static DistanceMetric& Instance();
+  // Defaults to SCALED_L2 with no maximum distance.
+  DistanceMetric();
+
+  // Convert a metric name to a metric. Unknown names give SCALED_L2, with a
+  // warning.
+  static Metric Parse(const std::string& metric);
 
   // Set distance metric type.
   void SetMetric(const Metric& metric = Metric::SCALED_L2);
@@ -72,49 +86,48 @@ class DistanceMetric {
   // Set distance metric type from string.
   void SetMetric(const std::string& metric = "SCALED_L2");
 
+  // Get the distance metric type.
+  Metric GetMetric() const;
+
   // Set a maximum tolerable distance between two descriptors. This is not
   // required, but is useful for comparisons like:
   //
-  // DistanceMetric& distance = DistanceMetric::Instance();
-  // if (distance(descriptor1, descriptor2) < DistanceMetric::Max()) {
+  // DistanceMetric distance;
+  // if (distance(descriptor1, descriptor2) < distance.Max()) {
   //    // This is a good match.
   //  }
   //
   //  By default, a maximum distance is set to infinity, so if this function is
-  //  not called, distance(descriptor1, descriptor2) < DistanceMetric::Max()
-  //  will always evaluate to true.
+  //  not called, distance(descriptor1, descriptor2) < distance.Max() will
+  //  always evaluate to true.
   void SetMaximumDistance(double maximum_distance);
 
   // Returns the maximum tolerable distance between two descriptors. If this
-  // value has not been set with 'SetMaximumDistance', returns 0.
+  // value has not been set with 'SetMaximumDistance', returns
+  // std::numeric_limits<double>::max().
   double Max() const;
 
   // Functor method computes distance between two input descriptors.
   double operator()(const Descriptor& descriptor1,
-                    const Descriptor& descriptor2);
+                    const Descriptor& descriptor2) const;
+
+  // Computes the same distance as above when it is less than 'bound'.
+  // Otherwise, may stop early and return any value that is at least 'bound'.
+  // This lets matchers skip candidates that cannot beat their current best
+  // matches. Only the HAMMING metric stops early.
+  double Bounded(const Descriptor& descriptor1, const Descriptor& descriptor2,
+                 double bound) const;
+
+  // Functor method computes distance between two packed binary descriptors.
+  // Binary descriptors only support the HAMMING metric.
+  double operator()(const BinaryDescriptor& descriptor1,
+                    const BinaryDescriptor& descriptor2) const;
 
   // Depending on the distance metric used, normalize descriptors.
   bool MaybeNormalizeDescriptors(std::vector<Descriptor>& descriptors) const;
 
  private:
-  // Ensure that DistanceMetric is a singleton.
   DISALLOW_COPY_AND_ASSIGN(DistanceMetric)
-  DistanceMetric();
-
-  // Compute the L2 norm of the difference between two descriptor vectors. If both
-  // descriptors have unit length, the L2 norm is equal to 2*(1-x.y). Since all
-  // distances are computed this way, we can drop the leading 2*. The L2 norm
-  // induces an inner product space over R^{n}, and we can test as such.
-  double GetScaledL2Distance(const Descriptor& descriptor1,
-                             const Descriptor& descriptor2) const;
-
-  // Compute the Hamming distance between two binary descriptor vectors. This is
-  // the number of bits that are in disagreement (i.e. bit1 ^ bit2 == 1).
-  double GetHammingDistance(const Descriptor& descriptor1,
-                            const Descriptor& descriptor2) const;
-
-  // Normalize all input descriptor vectors.
-  void NormalizeDescriptors(std::vector<Descriptor>& descriptors) const;
 
   // The distance metric that will be used.
   Metric metric_;
@@ -126,6 +139,96 @@ class DistanceMetric {
 
 };  //\class DistanceMetric
 
+// The L2 norm of the difference between two descriptor vectors. If both
+// descriptors have unit length, the squared L2 norm is equal to 2*(1-x.y).
+// Since all distances are computed this way, we can drop the leading 2*. The
+// L2 norm induces an inner product space over R^{n}, and we can test as such.
+// Descriptors must be normalized with NormalizeDescriptors() first.
+struct ScaledL2Metric {
+  static constexpr DistanceMetric::Metric kMetric = DistanceMetric::SCALED_L2;
+
+  // Descriptors must have unit length before they are compared.
+  static constexpr bool kNormalizes = true;
+
+  double operator()(const Descriptor& descriptor1,
+                    const Descriptor& descriptor2) const {
+    DCHECK_EQ(descriptor1.size(), descriptor2.size());
+    return 1.0 - descriptor1.dot(descriptor2);
+  }
+
+  // Partial dot products do not bound the final distance, so the distance is
+  // always computed in full.
+  double Bounded(const Descriptor& descriptor1, const Descriptor& descriptor2,
+                 double bound) const {
+    return (*this)(descriptor1, descriptor2);
+  }
+
+  void NormalizeDescriptors(std::vector<Descriptor>& descriptors) const {
+    for (auto& descriptor : descriptors) {
+      descriptor.normalize();
+    }
+  }
+
+  // Returns whether a descriptor already has unit length, in which case
+  // normalizing it again can be skipped. Descriptors are checked once when they
+  // are stored, so that matchers do not renormalize them on every call.
+  static bool IsNormalized(const Descriptor& descriptor) {
+    return descriptor.size() > 0 &&
+        std::abs(descriptor.squaredNorm() - 1.0) < 1e-10;
+  }
+};  //\struct ScaledL2Metric
+
+// The number of bits that are in disagreement (i.e. bit1 ^ bit2 == 1) between
+// two binary descriptors. Floating point descriptors hold one byte per
+// coefficient.
+struct HammingMetric {
+  static constexpr DistanceMetric::Metric kMetric = DistanceMetric::HAMMING;
+  static constexpr bool kNormalizes = false;
+
+  double operator()(const Descriptor& descriptor1,
+                    const Descriptor& descriptor2) const {
+    return Bounded(descriptor1, descriptor2,
+                   std::numeric_limits<double>::max());
+  }
+
+  double operator()(const BinaryDescriptor& descriptor1,
+                    const BinaryDescriptor& descriptor2) const {
+    return static_cast<double>(HammingDistance(descriptor1, descriptor2));
+  }
+
+  // Same as above, but may stop once the distance reaches 'bound', returning
+  // a value that is at least 'bound'. The partial distance is checked once per
+  // block of bytes.
+  double Bounded(const Descriptor& descriptor1, const Descriptor& descriptor2,
+                 double bound) const {
+    DCHECK_EQ(descriptor1.size(), descriptor2.size());
+    const int kBlockSize = 16;
+    int sum = 0;
+    for (int ii = 0; ii < descriptor1.size(); ++ii) {
+      const unsigned char d1 = static_cast<unsigned char>(descriptor1(ii));
+      const unsigned char d2 = static_cast<unsigned char>(descriptor2(ii));
+      sum += Popcount64(static_cast<uint64_t>(d1 ^ d2));
+      if ((ii + 1) % kBlockSize == 0 && sum >= bound)
+        break;
+    }
+    return static_cast<double>(sum);
+  }
+
+  double Bounded(const BinaryDescriptor& descriptor1,
+                 const BinaryDescriptor& descriptor2, double bound) const {
+    // Bounds that no descriptor can reach use the unrolled kernel. Hamming
+    // distances are integers, so stopping at ceil(bound) is safe.
+    if (bound >= 8.0 * descriptor1.Bytes()) {
+      return static_cast<double>(HammingDistance(descriptor1, descriptor2));
+    }
+    return static_cast<double>(HammingDistance(
+        descriptor1, descriptor2, static_cast<int>(std::ceil(bound))));
+  }
+
+  // Binary descriptors are not normalized.
+  void NormalizeDescriptors(std::vector<Descriptor>& descriptors) const {}
+};  //\struct HammingMetric
+
 }  //\namespace bsfm
 
 #endif
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2015, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: Erik Nelson            ( eanelson@eecs.berkeley.edu )
+ *          David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+#include "dot_product_matcher.h"
+
+#include <algorithm>
+#include <glog/logging.h>
+#include <limits>
+
+namespace bsfm {
+
+namespace {
+
+// Best and second best similarities (x.y) and their indices. Larger is better.
+struct TwoMostSimilar {
+  TwoMostSimilar()
+      : best_(-std::numeric_limits<float>::max()),
+        second_(-std::numeric_limits<float>::max()),
+        best_index_(-1),
+        second_index_(-1) {}
+
+  void Add(int index, float similarity) {
+    if (similarity <= second_) {
+      return;
+    }
+    if (similarity > best_) {
+      second_ = best_;
+      second_index_ = best_index_;
+      best_ = similarity;
+      best_index_ = index;
+    } else {
+      second_ = similarity;
+      second_index_ = index;
+    }
+  }
+
+  // Convert similarities to distances.
+  TwoNearestNeighbors ToNeighbors() const {
+    TwoNearestNeighbors nn;
+    nn.best_index_ = best_index_;
+    nn.second_index_ = second_index_;
+    if (best_index_ >= 0)
+      nn.best_distance_ = 1.0 - static_cast<double>(best_);
+    if (second_index_ >= 0)
+      nn.second_distance_ = 1.0 - static_cast<double>(second_);
+    return nn;
+  }
+
+  float best_;
+  float second_;
+  int best_index_;
+  int second_index_;
+};
+
+// Find the two most similar train rows of each query row and, if
+// 'train_neighbors' is not null, the two most similar query rows of each train
+// row.
+void FindNeighbors(const DescriptorMatrix& query,
+                   const DescriptorMatrix& train,
+                   std::vector<TwoNearestNeighbors>& query_neighbors,
+                   std::vector<TwoNearestNeighbors>* train_neighbors,
+                   size_t query_block_size, size_t train_block_size) {
+  CHECK_GT(query_block_size, 0);
+  CHECK_GT(train_block_size, 0);
+  query_neighbors.clear();
+  query_neighbors.resize(query.Rows());
+  if (train_neighbors != nullptr) {
+    train_neighbors->clear();
+    train_neighbors->resize(train.Rows());
+  }
+  if (query.Rows() == 0 || train.Rows() == 0) {
+    return;
+  }
+  CHECK_EQ(query.Cols(), train.Cols());
+
+  std::vector<TwoMostSimilar> query_top(query.Rows());
+  std::vector<TwoMostSimilar> train_top(
+      train_neighbors != nullptr ? train.Rows() : 0);
+
+  RowMatrixXf query_block, train_block, similarities;
+  for (size_t q0 = 0; q0 < query.Rows(); q0 += query_block_size) {
+    const size_t num_query = std::min(query_block_size, query.Rows() - q0);
+    query.GetBlock(q0, num_query, query_block);
+
+    for (size_t t0 = 0; t0 < train.Rows(); t0 += train_block_size) {
+      const size_t num_train = std::min(train_block_size, train.Rows() - t0);
+      train.GetBlock(t0, num_train, train_block);
+
+      // One product computes every similarity in the tile.
+      similarities.noalias() = query_block * train_block.transpose();
+
+      // Keep the top two per query row, and per train row if requested.
+      for (size_t ii = 0; ii < num_query; ++ii) {
+        const float* row = similarities.data() + ii * num_train;
+        TwoMostSimilar& top = query_top[q0 + ii];
+        for (size_t jj = 0; jj < num_train; ++jj) {
+          top.Add(static_cast<int>(t0 + jj), row[jj]);
+        }
+        if (train_neighbors != nullptr) {
+          for (size_t jj = 0; jj < num_train; ++jj) {
+            train_top[t0 + jj].Add(static_cast<int>(q0 + ii), row[jj]);
+          }
+        }
+      }
+    }
+  }
+
+  for (size_t ii = 0; ii < query_top.size(); ++ii)
+    query_neighbors[ii] = query_top[ii].ToNeighbors();
+  for (size_t ii = 0; ii < train_top.size(); ++ii)
+    (*train_neighbors)[ii] = train_top[ii].ToNeighbors();
+}
+
+}  //\namespace
+
+void FindTwoNearestNeighbors(const DescriptorMatrix& query,
+                             const DescriptorMatrix& train,
+                             std::vector<TwoNearestNeighbors>& neighbors,
+                             size_t query_block_size,
+                             size_t train_block_size) {
+  FindNeighbors(query, train, neighbors, nullptr, query_block_size,
+                train_block_size);
+}
+
+void FindMutualTwoNearestNeighbors(
+    const DescriptorMatrix& query, const DescriptorMatrix& train,
+    std::vector<TwoNearestNeighbors>& query_neighbors,
+    std::vector<TwoNearestNeighbors>& train_neighbors,
+    size_t query_block_size, size_t train_block_size) {
+  FindNeighbors(query, train, query_neighbors, &train_neighbors,
+                query_block_size, train_block_size);
+}
+
+}  //\namespace bsfm
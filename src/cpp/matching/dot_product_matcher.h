@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2015, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: Erik Nelson            ( eanelson@eecs.berkeley.edu )
+ *          David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Brute force nearest neighbor search over DescriptorMatrix objects using the
+// scaled L2 distance (1 - x.y, see distance_metric.h). Rather than comparing
+// descriptors one pair at a time, the similarity between a block of query rows
+// and a block of train rows is computed with a single matrix-matrix product,
+// which Eigen evaluates with a cache-blocked, vectorized kernel. Only the best
+// two neighbors of each query are kept while scanning each block, which is all
+// that the Lowe's ratio test needs. For mutual matching, the best two neighbors
+// of each train row are tracked from the same blocks.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef BSFM_MATCHING_DOT_PRODUCT_MATCHER_H
+#define BSFM_MATCHING_DOT_PRODUCT_MATCHER_H
+
+#include <vector>
+
+#include "descriptor_matrix.h"
+#include "two_nearest_neighbors.h"
+
+namespace bsfm {
+
+// Find the two nearest rows of 'train' for every row of 'query' under the
+// scaled L2 distance. Descriptors are assumed to be normalized. The block sizes
+// determine how many query and train rows are multiplied at a time.
+void FindTwoNearestNeighbors(const DescriptorMatrix& query,
+                             const DescriptorMatrix& train,
+                             std::vector<TwoNearestNeighbors>& neighbors,
+                             size_t query_block_size = 128,
+                             size_t train_block_size = 512);
+
+// Same as above, but also find the two nearest rows of 'query' for every row of
+// 'train' in the same pass, so that mutual nearest neighbors can be found
+// without computing each similarity twice.
+void FindMutualTwoNearestNeighbors(
+    const DescriptorMatrix& query, const DescriptorMatrix& train,
+    std::vector<TwoNearestNeighbors>& query_neighbors,
+    std::vector<TwoNearestNeighbors>& train_neighbors,
+    size_t query_block_size = 128, size_t train_block_size = 512);
+
+}  //\namespace bsfm
+
+#endif
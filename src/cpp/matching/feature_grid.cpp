@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2015, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: Erik Nelson            ( eanelson@eecs.berkeley.edu )
+ *          David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+#include "feature_grid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <glog/logging.h>
+
+namespace bsfm {
+
+namespace {
+
+// Features farther than this from the image origin (pixels) are ignored.
+const double kMaxCoordinate = 1e6;
+
+// Upper bound on the number of cells along each side of the grid. If the
+// features span more than this many cells, cells are enlarged to fit.
+const int kMaxCellsPerSide = 1024;
+
+bool IsIndexable(const Feature& feature) {
+  return std::abs(feature.u_) < kMaxCoordinate &&
+         std::abs(feature.v_) < kMaxCoordinate;
+}
+
+}  //\namespace
+
+FeatureGrid::FeatureGrid()
+    : cell_size_(1.0), min_u_(0.0), min_v_(0.0), rows_(0), cols_(0) {}
+
+FeatureGrid::~FeatureGrid() {}
+
+void FeatureGrid::Build(const std::vector<Feature>& features,
+                        double cell_size) {
+  CHECK_GT(cell_size, 0.0);
+  rows_ = 0;
+  cols_ = 0;
+  cell_starts_.clear();
+  cell_indices_.clear();
+
+  // Find the extent of all features that will be stored.
+  double max_u = -kMaxCoordinate, max_v = -kMaxCoordinate;
+  min_u_ = kMaxCoordinate;
+  min_v_ = kMaxCoordinate;
+  for (const auto& feature : features) {
+    if (!IsIndexable(feature))
+      continue;
+    min_u_ = std::min(min_u_, feature.u_);
+    min_v_ = std::min(min_v_, feature.v_);
+    max_u = std::max(max_u, feature.u_);
+    max_v = std::max(max_v, feature.v_);
+  }
+  if (min_u_ > max_u)
+    return;
+
+  // Enlarging cells beyond 'cell_size' keeps the 3x3 neighborhood a superset
+  // of the query radius.
+  cell_size_ = std::max(cell_size, std::max(max_u - min_u_, max_v - min_v_) /
+                                       (kMaxCellsPerSide - 1));
+  cols_ = Cell(max_u, min_u_) + 1;
+  rows_ = Cell(max_v, min_v_) + 1;
+
+  // Counting sort of feature indices by cell.
+  std::vector<int> feature_cells(features.size(), -1);
+  cell_starts_.assign(rows_ * cols_ + 1, 0);
+  for (size_t ii = 0; ii < features.size(); ++ii) {
+    if (!IsIndexable(features[ii]))
+      continue;
+    feature_cells[ii] = Cell(features[ii].v_, min_v_) * cols_ +
+                        Cell(features[ii].u_, min_u_);
+    cell_starts_[feature_cells[ii] + 1]++;
+  }
+  for (size_t ii = 1; ii < cell_starts_.size(); ++ii)
+    cell_starts_[ii] += cell_starts_[ii - 1];
+
+  std::vector<int> cell_fill(cell_starts_.begin(), cell_starts_.end() - 1);
+  cell_indices_.resize(cell_starts_.back());
+  for (size_t ii = 0; ii < features.size(); ++ii) {
+    if (feature_cells[ii] >= 0)
+      cell_indices_[cell_fill[feature_cells[ii]]++] = ii;
+  }
+}
+
+void FeatureGrid::GetNeighbors(const Feature& query,
+                               std::vector<int>& indices) const {
+  indices.clear();
+  if (rows_ == 0 || !IsIndexable(query))
+    return;
+
+  const int query_col = Cell(query.u_, min_u_);
+  const int query_row = Cell(query.v_, min_v_);
+  const int first_row = std::max(query_row - 1, 0);
+  const int last_row = std::min(query_row + 1, rows_ - 1);
+  const int first_col = std::max(query_col - 1, 0);
+  const int last_col = std::min(query_col + 1, cols_ - 1);
+
+  for (int row = first_row; row <= last_row; ++row) {
+    // Cells in a row are adjacent, so the 3 neighbors in a row are one range.
+    if (first_col > last_col)
+      break;
+    const int begin = cell_starts_[row * cols_ + first_col];
+    const int end = cell_starts_[row * cols_ + last_col + 1];
+    indices.insert(indices.end(), cell_indices_.begin() + begin,
+                   cell_indices_.begin() + end);
+  }
+  std::sort(indices.begin(), indices.end());
+}
+
+int FeatureGrid::Cell(double x, double min) const {
+  return static_cast<int>(std::floor((x - min) / cell_size_));
+}
+
+}  //\namespace bsfm
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2015, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: Erik Nelson            ( eanelson@eecs.berkeley.edu )
+ *          David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// The FeatureGrid class buckets features into a uniform image-space grid of
+// square cells. All features within one cell width of a query position lie in
+// the query's cell or one of its 8 neighbors, so matchers that gate on image
+// space distance only need to compare descriptors of features from those 9
+// cells.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef BSFM_MATCHING_FEATURE_GRID_H
+#define BSFM_MATCHING_FEATURE_GRID_H
+
+#include <vector>
+
+#include "feature.h"
+
+namespace bsfm {
+
+class FeatureGrid {
+ public:
+  FeatureGrid();
+  ~FeatureGrid();
+
+  // Bucket features into cells with side length 'cell_size' (pixels). Features
+  // whose coordinates are not finite (or are far outside any image, e.g. the
+  // placeholder position of an unobserved landmark) are not stored, and will
+  // never be returned as neighbors.
+  void Build(const std::vector<Feature>& features, double cell_size);
+
+  // Get indices of all stored features in the cell containing 'query' and the
+  // 8 cells surrounding it, in increasing order. This includes every feature
+  // within 'cell_size' of the query, and possibly some that are farther away.
+  void GetNeighbors(const Feature& query, std::vector<int>& indices) const;
+
+ private:
+  // Get the cell column/row containing the coordinate 'x', offset by 'min'.
+  // May be out of range.
+  int Cell(double x, double min) const;
+
+  // Grid geometry. The cell at (row, col) covers
+  // [min_u_ + col * cell_size_, min_u_ + (col + 1) * cell_size_) in u, and
+  // similarly in v.
+  double cell_size_;
+  double min_u_;
+  double min_v_;
+  int rows_;
+  int cols_;
+
+  // Feature indices sorted by cell. Indices of features in cell 'c' are stored
+  // in cell_indices_[cell_starts_[c]] to cell_indices_[cell_starts_[c+1] - 1].
+  std::vector<int> cell_starts_;
+  std::vector<int> cell_indices_;
+};  //\class FeatureGrid
+
+}  //\namespace bsfm
+
+#endif
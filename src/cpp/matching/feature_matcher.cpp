@@ -39,12 +39,18 @@
 
 namespace bsfm {
 
+void FeatureMatcher::SetVocabularyTree(
+    const VocabularyTree::Ptr& vocabulary_tree) {
+  vocabulary_tree_ = vocabulary_tree;
+}
+
 // Append features from a single image to the list of all image features.
 void FeatureMatcher::AddImageFeatures(
     const std::vector<Feature>& image_features,
     const std::vector<Descriptor>& image_descriptors) {
   image_features_.push_back(image_features);
   image_descriptors_.push_back(image_descriptors);
+  image_binary_descriptors_.push_back(std::vector<BinaryDescriptor>());
 }
 
 // Append features from a set of images to the list of all image features.
@@ -55,15 +61,169 @@ void FeatureMatcher::AddImageFeatures(
                          image_features.end());
   image_descriptors_.insert(image_descriptors_.end(), image_descriptors.begin(),
                             image_descriptors.end());
+  image_binary_descriptors_.resize(image_descriptors_.size());
+}
+
+// Append features with binary descriptors from a single image.
+void FeatureMatcher::AddImageFeatures(
+    const std::vector<Feature>& image_features,
+    const std::vector<BinaryDescriptor>& image_descriptors) {
+  image_features_.push_back(image_features);
+  image_descriptors_.push_back(std::vector<Descriptor>());
+  image_binary_descriptors_.push_back(image_descriptors);
 }
 
 bool FeatureMatcher::MatchImages(const FeatureMatcherOptions& options,
                                  PairwiseImageMatchList& image_matches) {
   // Store the matching options locally.
   options_ = options;
+  metric_ = DistanceMetric::Parse(options_.distance_metric);
+
+  // Normalize descriptors up front, since image pairs share descriptors and may
+  // be matched concurrently.
+  NormalizeImageDescriptors();
+
+  // Collect pairs of images to match.
+  std::vector<std::pair<int, int> > image_pairs;
+  GetImagePairs(image_pairs);
+
+  // Each pair gets its own output slot, so that threads never write to the
+  // same image match and results can be merged in a fixed order.
+  PairwiseImageMatchList pair_matches(image_pairs.size());
+  std::vector<char> pair_matched(image_pairs.size(), false);
+
+  // Attempt to match each image pair by comparing their features. Threads take
+  // the next unmatched pair from a shared counter.
+  std::atomic<size_t> next_pair(0);
+  auto match_pairs = [&]() {
+    for (size_t ii = next_pair++; ii < image_pairs.size(); ii = next_pair++) {
+      const int image_index1 = image_pairs[ii].first;
+      const int image_index2 = image_pairs[ii].second;
+      if (!MatchImagePair(image_index1, image_index2, pair_matches[ii])) {
+        VLOG(1) << "Could not match image " << image_index1 << " to image "
+                << image_index2 << ".";
+        continue;
+      }
+      pair_matches[ii].image_index1_ = image_index1;
+      pair_matches[ii].image_index2_ = image_index2;
+      pair_matched[ii] = true;
+    }
+  };
+
+  size_t num_threads = options_.num_threads;
+  if (num_threads == 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  num_threads = std::min(num_threads, image_pairs.size());
+
+  if (num_threads <= 1) {
+    match_pairs();
+  } else {
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads - 1);
+    for (size_t ii = 0; ii + 1 < num_threads; ++ii) {
+      threads.emplace_back(match_pairs);
+    }
+    match_pairs();
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+
+  // If the image match was successful, store it.
+  for (size_t ii = 0; ii < pair_matches.size(); ++ii) {
+    if (pair_matched[ii]) {
+      image_matches.push_back(std::move(pair_matches[ii]));
+    }
+  }
+
+  // Return whether or not any of the image pairs were matched.
+  return image_matches.size() > 0;
+}
+
+void FeatureMatcher::GetImagePairs(
+    std::vector<std::pair<int, int> >& image_pairs) {
+  image_pairs.clear();
+
+  if (options_.num_candidate_images == 0) {
+    GetAllImagePairs(image_pairs);
+    return;
+  }
 
-  // Iterate over all pairs of images and attempt to match them together by
-  // comparing their features.
+  // Use binary descriptors for retrieval only if every image has them.
+  bool use_binary = true;
+  for (size_t ii = 0; ii < image_features_.size(); ++ii) {
+    if (!image_features_[ii].empty() && image_binary_descriptors_[ii].empty())
+      use_binary = false;
+  }
+
+  // Train a vocabulary tree on the images being matched if one was not given.
+  if (vocabulary_tree_ == nullptr) {
+    vocabulary_tree_.reset(new VocabularyTree);
+    const bool trained =
+        use_binary
+            ? vocabulary_tree_->Train(image_binary_descriptors_,
+                                      options_.vocabulary_tree_branching,
+                                      options_.vocabulary_tree_depth)
+            : vocabulary_tree_->Train(image_descriptors_,
+                                      options_.vocabulary_tree_branching,
+                                      options_.vocabulary_tree_depth);
+    if (!trained) {
+      LOG(WARNING) << "Failed to train a vocabulary tree. Matching all image "
+                      "pairs.";
+      vocabulary_tree_.reset();
+      GetAllImagePairs(image_pairs);
+      return;
+    }
+  }
+  CHECK(vocabulary_tree_->IsTrained());
+  if (vocabulary_tree_->IsBinary() != use_binary) {
+    LOG(WARNING) << "Vocabulary tree descriptor type does not match the "
+                    "images' descriptors. Matching all image pairs.";
+    GetAllImagePairs(image_pairs);
+    return;
+  }
+
+  // Add all images to the tree's database. Database indices match image
+  // indices.
+  vocabulary_tree_->ClearImages();
+  for (size_t ii = 0; ii < image_features_.size(); ++ii) {
+    if (use_binary)
+      vocabulary_tree_->AddImage(image_binary_descriptors_[ii]);
+    else
+      vocabulary_tree_->AddImage(image_descriptors_[ii]);
+  }
+
+  // Keep the top candidates for each image, in both directions.
+  std::vector<int> candidates;
+  for (size_t ii = 0; ii < image_features_.size(); ++ii) {
+    if (image_features_[ii].empty()) {
+      continue;
+    }
+    vocabulary_tree_->Query(ii, options_.num_candidate_images, candidates);
+    for (const auto& jj : candidates) {
+      if (image_features_[jj].empty()) {
+        continue;
+      }
+      image_pairs.push_back(std::make_pair(std::min<int>(ii, jj),
+                                           std::max<int>(ii, jj)));
+    }
+  }
+  std::sort(image_pairs.begin(), image_pairs.end());
+  image_pairs.erase(std::unique(image_pairs.begin(), image_pairs.end()),
+                    image_pairs.end());
+
+  // Retrieval may find nothing, e.g. if no two images share a visual word.
+  if (image_pairs.empty()) {
+    VLOG(1) << "Vocabulary tree retrieval found no image pairs. Matching all "
+               "image pairs.";
+    GetAllImagePairs(image_pairs);
+  }
+}
+
+void FeatureMatcher::GetAllImagePairs(
+    std::vector<std::pair<int, int> >& image_pairs) {
+  image_pairs.clear();
   for (size_t ii = 0; ii < image_features_.size(); ++ii) {
     // Make sure this image has features.
     if (image_features_[ii].size() == 0) {
@@ -74,21 +234,17 @@ bool FeatureMatcher::MatchImages(const FeatureMatcherOptions& options,
       if (image_features_[jj].size() == 0) {
         continue;
       }
-
-      // Create an image match object and attempt to match image ii to image jj.
-      PairwiseImageMatch image_match;
-      if (!MatchImagePair(ii, jj, image_match)) {
-        VLOG(1) << "Could not match image " << ii << " to image " << jj << ".";
-        continue;
-      }
-
-      // If the image match was successful, store it.
-      image_matches.push_back(image_match);
+      image_pairs.push_back(std::make_pair(ii, jj));
     }
   }
+}
 
-  // Return whether or not any of the image pairs were matched.
-  return image_matches.size() > 0;
+void FeatureMatcher::NormalizeImageDescriptors() {
+  DistanceMetric distance;
+  distance.SetMetric(metric_);
+  for (auto& descriptors : image_descriptors_) {
+    distance.MaybeNormalizeDescriptors(descriptors);
+  }
 }
 
 void FeatureMatcher::SymmetricMatches(
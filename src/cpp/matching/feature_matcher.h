@@ -38,22 +38,31 @@
 ///////////////////////////////////////////////////////////////////////////////
 //
 // This class defines a base class for feature matching. A derived class should
-// be used to implement the specific feature matching strategy.  All matching
-// strategies will attempt to do pairwise matches between all pairs of input
-// images. This is slow, with O(n^2) in the number of images.
+// be used to implement the specific feature matching strategy.  By default,
+// all matching strategies will attempt to do pairwise matches between all pairs
+// of input images. This is slow, with O(n^2) in the number of images. Setting
+// 'num_candidate_images' in the matching options instead matches each image
+// only against the most similar images retrieved from a vocabulary tree.
 //
 ///////////////////////////////////////////////////////////////////////////////
 
 #ifndef BSFM_MATCHING_FEATURE_MATCHER_H
 #define BSFM_MATCHING_FEATURE_MATCHER_H
+#include <algorithm>
+#include <atomic>
+#include <thread>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <glog/logging.h>
 
+#include "binary_descriptor.h"
 #include "distance_metric.h"
 #include "feature.h"
 #include "feature_matcher_options.h"
 #include "pairwise_image_match.h"
+#include "vocabulary_tree.h"
 
 #include "../image/image.h"
 #include "../util/disallow_copy_and_assign.h"
@@ -63,7 +72,7 @@ namespace bsfm {
 
 class FeatureMatcher {
  public:
-  FeatureMatcher() { }
+  FeatureMatcher() : metric_(DistanceMetric::SCALED_L2) { }
   virtual ~FeatureMatcher() { }
 
   // Add a single image's features for matching.
@@ -76,16 +85,46 @@ class FeatureMatcher {
       const std::vector<std::vector<Feature> >& image_features,
       const std::vector<std::vector<Descriptor> >& image_descriptors);
 
-  // Match images together using the input options.
+  // Add a single image's features with packed binary descriptors. Pairs of
+  // images that both have binary descriptors are matched with the Hamming
+  // distance on the packed bits.
+  virtual void AddImageFeatures(
+      const std::vector<Feature>& image_features,
+      const std::vector<BinaryDescriptor>& image_descriptors);
+
+  // Use a trained vocabulary tree to choose candidate image pairs when
+  // 'num_candidate_images' is set in the matching options. Images added to the
+  // matcher are added to the tree's database in MatchImages().
+  void SetVocabularyTree(const VocabularyTree::Ptr& vocabulary_tree);
+
+  // Match images together using the input options. Image pairs are matched
+  // on 'options.num_threads' threads, and successful matches are appended to
+  // 'image_matches' ordered by their image indices.
   virtual bool MatchImages(const FeatureMatcherOptions& options,
                            PairwiseImageMatchList& image_matches);
 
  protected:
   // Abstract method to match a pair of images using the input options. Override
-  // this in the derived feature matching strategy class to implement it.
+  // this in the derived feature matching strategy class to implement it. This
+  // may be called for several image pairs at once from different threads, so it
+  // must not modify any member variables.
   virtual bool MatchImagePair(int image_index1, int image_index2,
                               PairwiseImageMatch& image_match) = 0;
 
+  // Normalize all floating point descriptors if required by the distance
+  // metric in 'options_'. This is done once before any pairs are matched.
+  virtual void NormalizeImageDescriptors();
+
+  // Get pairs of image indices to match, with the first index less than the
+  // second, in increasing order. This is either all pairs of images with
+  // features, or the pairs chosen by vocabulary tree retrieval. Retrieval falls
+  // back to all pairs if the tree cannot be used or suggests no pairs.
+  virtual void GetImagePairs(std::vector<std::pair<int, int> >& image_pairs);
+
+  // Get all pairs of images that both have features, as in GetImagePairs().
+  virtual void GetAllImagePairs(
+      std::vector<std::pair<int, int> >& image_pairs);
+
   // Find the set intersection of the two sets of input feature matches, and
   // store that set in the second argument.
   virtual void SymmetricMatches(
@@ -96,9 +135,22 @@ class FeatureMatcher {
   std::vector<std::vector<Feature> > image_features_;
   std::vector<std::vector<Descriptor> > image_descriptors_;
 
+  // Packed binary descriptors for each image. This is kept the same length as
+  // 'image_descriptors_', and is empty for images that were added with
+  // floating point descriptors (and vice versa).
+  std::vector<std::vector<BinaryDescriptor> > image_binary_descriptors_;
+
   // A set of options used for matching features and images.
   FeatureMatcherOptions options_;
 
+  // The distance metric named by 'options_.distance_metric'. This is parsed
+  // once in MatchImages(), and picks which metric functor image pairs are
+  // matched with.
+  DistanceMetric::Metric metric_;
+
+  // An optional vocabulary tree for choosing which image pairs to match.
+  VocabularyTree::Ptr vocabulary_tree_;
+
  private:
   DISALLOW_COPY_AND_ASSIGN(FeatureMatcher)
 
@@ -99,6 +99,47 @@ struct FeatureMatcherOptions {
   // matching/distance_metric.h.
   std::string distance_metric = "SCALED_L2";
 
+  // Floating point descriptors compared with the SCALED_L2 metric are matched
+  // in blocks with single precision matrix products. If this is true, they are
+  // additionally stored as 8-bit integers with a per-descriptor scale, which
+  // uses a quarter of the memory at a small cost in accuracy.
+  bool quantize_descriptors = false;
+
+  // The number of threads used to match image pairs concurrently. Each thread
+  // takes the next unmatched pair from a shared queue. If this is 0, one thread
+  // is used per hardware core. Results are returned in the same order as with
+  // a single thread.
+  unsigned int num_threads = 1;
+
+  // If this is greater than 0, each image is only matched with the
+  // 'num_candidate_images' other images that are most similar to it, as
+  // scored by a vocabulary tree, rather than with every other image. An image
+  // pair is matched if either image is a candidate for the other. If no
+  // vocabulary tree has been given to the feature matcher, one is trained on
+  // the matcher's images with the branching factor and depth below.
+  unsigned int num_candidate_images = 0;
+  unsigned int vocabulary_tree_branching = 10;
+  unsigned int vocabulary_tree_depth = 4;
+
+  // Binary descriptors that are not thresholded on image space distance are
+  // matched against a multi-index hash table instead of by brute force once
+  // there are at least this many descriptors to search. Results are the same
+  // as with brute force, up to ties in distance.
+  unsigned int min_num_descriptors_for_index = 1000;
+
+  // Discard matches that do not move coherently with their neighbors, using
+  // grid-based motion statistics (see matching/motion_statistics_filter.h).
+  // This runs in linear time after matching, and removes most outliers before
+  // RANSAC. Each image is divided into 'motion_statistics_grid_size' cells
+  // along each side, and a match is kept if its support exceeds
+  // 'motion_statistics_threshold' times the square root of the average number
+  // of matches per neighboring cell. For 2D<-->3D matches, the position of a
+  // landmark's previous observation is used as its position in the first
+  // image.
+  bool use_motion_statistics_filter = false;
+  unsigned int motion_statistics_grid_size = 20;
+  double motion_statistics_threshold = 6.0;
+
 };  //\struct FeatureMatcherOptions
 
 }  //\namespace bsfm
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2015, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: Erik Nelson            ( eanelson@eecs.berkeley.edu )
+ *          David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+#include "hamming_distance.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace bsfm {
+
+#ifdef __AVX2__
+namespace {
+
+// Per-byte popcount of a 256-bit register via a 4-bit lookup table, summed
+// into four 64-bit lanes.
+inline __m256i PopcountBytesAVX2(__m256i v) {
+  const __m256i lookup = _mm256_setr_epi8(
+      0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+      0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low_mask = _mm256_set1_epi8(0x0f);
+  const __m256i lo = _mm256_and_si256(v, low_mask);
+  const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+  const __m256i counts = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo),
+                                         _mm256_shuffle_epi8(lookup, hi));
+  return _mm256_sad_epu8(counts, _mm256_setzero_si256());
+}
+
+inline int HorizontalSumAVX2(__m256i v) {
+  return static_cast<int>(_mm256_extract_epi64(v, 0) +
+                          _mm256_extract_epi64(v, 1) +
+                          _mm256_extract_epi64(v, 2) +
+                          _mm256_extract_epi64(v, 3));
+}
+
+}  //\namespace
+#endif
+
+void HammingDistances(const BinaryDescriptor& query,
+                      const std::vector<BinaryDescriptor>& descriptors,
+                      std::vector<int>& distances) {
+  distances.resize(descriptors.size());
+  const size_t num_words = query.Words();
+
+#ifdef __AVX2__
+  // 32-byte and 64-byte descriptors cover every binary type that OpenCV
+  // produces. Anything else goes through the scalar path below.
+  if (query.Bytes() == 32 || query.Bytes() == 64) {
+    const __m256i* q = reinterpret_cast<const __m256i*>(query.WordData());
+    const __m256i q0 = _mm256_loadu_si256(q);
+    const __m256i q1 =
+        query.Bytes() == 64 ? _mm256_loadu_si256(q + 1) : _mm256_setzero_si256();
+
+    for (size_t ii = 0; ii < descriptors.size(); ++ii) {
+      DCHECK_EQ(query.Bytes(), descriptors[ii].Bytes());
+      const __m256i* d =
+          reinterpret_cast<const __m256i*>(descriptors[ii].WordData());
+      __m256i x = _mm256_xor_si256(q0, _mm256_loadu_si256(d));
+      __m256i sum = PopcountBytesAVX2(x);
+      if (query.Bytes() == 64) {
+        x = _mm256_xor_si256(q1, _mm256_loadu_si256(d + 1));
+        sum = _mm256_add_epi64(sum, PopcountBytesAVX2(x));
+      }
+      distances[ii] = HorizontalSumAVX2(sum);
+    }
+    return;
+  }
+#endif
+
+  for (size_t ii = 0; ii < descriptors.size(); ++ii) {
+    DCHECK_EQ(query.Bytes(), descriptors[ii].Bytes());
+    distances[ii] = HammingDistance(query.WordData(),
+                                    descriptors[ii].WordData(), num_words);
+  }
+}
+
+bool HammingDistanceUsesAVX2() {
+#ifdef __AVX2__
+  return true;
+#else
+  return false;
+#endif
+}
+
+}  //\namespace bsfm
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2015, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: Erik Nelson            ( eanelson@eecs.berkeley.edu )
+ *          David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Hamming distance kernels for packed binary descriptors. The pairwise kernel
+// uses one 64-bit popcount per word (the POPCNT instruction when the compiler
+// targets it, otherwise a portable bit-twiddling fallback). The one-to-many
+// kernel additionally uses an AVX2 nibble lookup table when available. It XORs
+// a 32-byte descriptor in a single 256-bit register, and a 64-byte descriptor
+// in two.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef BSFM_MATCHING_HAMMING_DISTANCE_H
+#define BSFM_MATCHING_HAMMING_DISTANCE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "binary_descriptor.h"
+
+namespace bsfm {
+
+// Number of set bits in a 64-bit word.
+inline int Popcount64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_popcountll(x);
+#else
+  x = x - ((x >> 1) & 0x5555555555555555ULL);
+  x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+  x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+  return static_cast<int>((x * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+// Hamming distance between two packed word arrays of equal length.
+inline int HammingDistance(const uint64_t* words1, const uint64_t* words2,
+                           size_t num_words) {
+  int distance = 0;
+  for (size_t ii = 0; ii < num_words; ++ii)
+    distance += Popcount64(words1[ii] ^ words2[ii]);
+  return distance;
+}
+
+// Same as above, but stops early once the distance reaches 'bound', in which
+// case the partial distance (which is at least 'bound') is returned.
+inline int HammingDistance(const uint64_t* words1, const uint64_t* words2,
+                           size_t num_words, int bound) {
+  int distance = 0;
+  for (size_t ii = 0; ii < num_words; ++ii) {
+    distance += Popcount64(words1[ii] ^ words2[ii]);
+    if (distance >= bound)
+      break;
+  }
+  return distance;
+}
+
+// Hamming distance between two binary descriptors. Descriptors must have the
+// same length.
+inline int HammingDistance(const BinaryDescriptor& descriptor1,
+                           const BinaryDescriptor& descriptor2) {
+  DCHECK_EQ(descriptor1.Bytes(), descriptor2.Bytes());
+  return HammingDistance(descriptor1.WordData(), descriptor2.WordData(),
+                         descriptor1.Words());
+}
+
+// Hamming distance between two binary descriptors, stopping early once it
+// reaches 'bound'.
+inline int HammingDistance(const BinaryDescriptor& descriptor1,
+                           const BinaryDescriptor& descriptor2, int bound) {
+  DCHECK_EQ(descriptor1.Bytes(), descriptor2.Bytes());
+  return HammingDistance(descriptor1.WordData(), descriptor2.WordData(),
+                         descriptor1.Words(), bound);
+}
+
+// Compute the Hamming distance from 'query' to every descriptor in
+// 'descriptors', storing the results in 'distances'. This is the inner loop of
+// brute force binary matching, and is vectorized when compiled with AVX2.
+void HammingDistances(const BinaryDescriptor& query,
+                      const std::vector<BinaryDescriptor>& descriptors,
+                      std::vector<int>& distances);
+
+// Returns true if the AVX2 kernel was compiled in.
+bool HammingDistanceUsesAVX2();
+
+}  //\namespace bsfm
+
+#endif
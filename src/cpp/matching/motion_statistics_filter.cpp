@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) 2015, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: Erik Nelson            ( eanelson@eecs.berkeley.edu )
+ *          David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+#include "motion_statistics_filter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <glog/logging.h>
+
+namespace bsfm {
+
+namespace {
+
+// A uniform grid over the extent of a set of features. The grid may be shifted
+// by a fraction of a cell, in which case it has an extra row and column so that
+// it still covers every feature.
+class CellGrid {
+ public:
+  CellGrid(const std::vector<Feature>& features, unsigned int grid_size,
+           double shift_u, double shift_v)
+      : shift_u_(shift_u), shift_v_(shift_v) {
+    double max_u = -std::numeric_limits<double>::max();
+    double max_v = -std::numeric_limits<double>::max();
+    min_u_ = std::numeric_limits<double>::max();
+    min_v_ = std::numeric_limits<double>::max();
+    for (const auto& feature : features) {
+      if (!IsFinite(feature))
+        continue;
+      min_u_ = std::min(min_u_, feature.u_);
+      min_v_ = std::min(min_v_, feature.v_);
+      max_u = std::max(max_u, feature.u_);
+      max_v = std::max(max_v, feature.v_);
+    }
+
+    cell_u_ = max_u > min_u_ ? (max_u - min_u_) / grid_size : 1.0;
+    cell_v_ = max_v > min_v_ ? (max_v - min_v_) / grid_size : 1.0;
+    cols_ = grid_size + (shift_u > 0.0 ? 1 : 0);
+    rows_ = grid_size + (shift_v > 0.0 ? 1 : 0);
+  }
+
+  int Rows() const { return rows_; }
+  int Cols() const { return cols_; }
+  int NumCells() const { return rows_ * cols_; }
+
+  // Get the index of the cell containing 'feature', or -1 if it does not have
+  // finite coordinates.
+  int Cell(const Feature& feature) const {
+    if (!IsFinite(feature))
+      return -1;
+    const int col =
+        static_cast<int>((feature.u_ - min_u_) / cell_u_ + shift_u_);
+    const int row =
+        static_cast<int>((feature.v_ - min_v_) / cell_v_ + shift_v_);
+    return std::min(row, rows_ - 1) * cols_ + std::min(col, cols_ - 1);
+  }
+
+ private:
+  static bool IsFinite(const Feature& feature) {
+    return std::isfinite(feature.u_) && std::isfinite(feature.v_);
+  }
+
+  double min_u_;
+  double min_v_;
+  double cell_u_;
+  double cell_v_;
+  double shift_u_;
+  double shift_v_;
+  int rows_;
+  int cols_;
+};  //\class CellGrid
+
+}  //\namespace
+
+MotionStatisticsFilter::MotionStatisticsFilter(unsigned int grid_size,
+                                               double threshold)
+    : grid_size_(grid_size), threshold_(threshold) {
+  CHECK_GT(grid_size_, 0);
+}
+
+MotionStatisticsFilter::~MotionStatisticsFilter() {}
+
+void MotionStatisticsFilter::Filter(const std::vector<Feature>& features1,
+                                    const std::vector<Feature>& features2,
+                                    std::vector<int>& inliers) const {
+  CHECK_EQ(features1.size(), features2.size());
+  inliers.clear();
+
+  // Matches near a cell border in the first image have most of their support
+  // in neighboring cells. Repeat with the grid shifted by half a cell in each
+  // direction, and keep matches that pass with any of the grids.
+  std::vector<bool> is_inlier(features1.size(), false);
+  FilterShifted(features1, features2, 0.0, 0.0, is_inlier);
+  FilterShifted(features1, features2, 0.5, 0.0, is_inlier);
+  FilterShifted(features1, features2, 0.0, 0.5, is_inlier);
+  FilterShifted(features1, features2, 0.5, 0.5, is_inlier);
+
+  for (size_t ii = 0; ii < is_inlier.size(); ++ii) {
+    if (is_inlier[ii])
+      inliers.push_back(ii);
+  }
+}
+
+void MotionStatisticsFilter::Filter(FeatureMatchList& feature_matches) const {
+  std::vector<Feature> features1, features2;
+  features1.reserve(feature_matches.size());
+  features2.reserve(feature_matches.size());
+  for (const auto& feature_match : feature_matches) {
+    features1.push_back(feature_match.feature1_);
+    features2.push_back(feature_match.feature2_);
+  }
+
+  std::vector<int> inliers;
+  Filter(features1, features2, inliers);
+  for (size_t ii = 0; ii < inliers.size(); ++ii)
+    feature_matches[ii] = feature_matches[inliers[ii]];
+  feature_matches.resize(inliers.size());
+}
+
+void MotionStatisticsFilter::FilterShifted(
+    const std::vector<Feature>& features1,
+    const std::vector<Feature>& features2, double shift_u, double shift_v,
+    std::vector<bool>& is_inlier) const {
+  const CellGrid grid1(features1, grid_size_, shift_u, shift_v);
+  const CellGrid grid2(features2, grid_size_, 0.0, 0.0);
+
+  // Get the cell of each match in both images. Matches that cannot be placed
+  // in both grids are never kept.
+  std::vector<int> cells1(features1.size()), cells2(features2.size());
+  for (size_t ii = 0; ii < features1.size(); ++ii) {
+    cells1[ii] = grid1.Cell(features1[ii]);
+    cells2[ii] = grid2.Cell(features2[ii]);
+    if (cells2[ii] < 0)
+      cells1[ii] = -1;
+  }
+
+  // Counting sort of match indices by their cell in the first image. Matches
+  // in cell 'c' are stored in order[starts[c]] to order[starts[c+1] - 1].
+  std::vector<int> starts(grid1.NumCells() + 1, 0);
+  for (const auto& cell : cells1) {
+    if (cell >= 0)
+      starts[cell + 1]++;
+  }
+  for (size_t ii = 1; ii < starts.size(); ++ii)
+    starts[ii] += starts[ii - 1];
+
+  std::vector<int> fill(starts.begin(), starts.end() - 1);
+  std::vector<int> order(starts.back());
+  for (size_t ii = 0; ii < cells1.size(); ++ii) {
+    if (cells1[ii] >= 0)
+      order[fill[cells1[ii]]++] = ii;
+  }
+
+  // Pair each cell in the first image with the cell in the second image that
+  // receives the most of its matches.
+  std::vector<int> best_cells(grid1.NumCells(), -1);
+  std::vector<int> counts(grid2.NumCells(), 0);
+  for (int cell = 0; cell < grid1.NumCells(); ++cell) {
+    int best_count = 0;
+    for (int kk = starts[cell]; kk < starts[cell + 1]; ++kk) {
+      const int count = ++counts[cells2[order[kk]]];
+      if (count > best_count) {
+        best_count = count;
+        best_cells[cell] = cells2[order[kk]];
+      }
+    }
+    for (int kk = starts[cell]; kk < starts[cell + 1]; ++kk)
+      counts[cells2[order[kk]]] = 0;
+  }
+
+  // Score each pair of cells by the number of matches between it and the 8
+  // pairs of cells around it, displaced the same way. Each match is visited
+  // once for each of its 9 neighboring cells.
+  for (int cell = 0; cell < grid1.NumCells(); ++cell) {
+    if (best_cells[cell] < 0)
+      continue;
+
+    const int row1 = cell / grid1.Cols(), col1 = cell % grid1.Cols();
+    const int row2 = best_cells[cell] / grid2.Cols();
+    const int col2 = best_cells[cell] % grid2.Cols();
+
+    int support = 0, num_matches = 0, num_neighbors = 0;
+    for (int dr = -1; dr <= 1; ++dr) {
+      for (int dc = -1; dc <= 1; ++dc) {
+        if (row1 + dr < 0 || row1 + dr >= grid1.Rows() ||
+            col1 + dc < 0 || col1 + dc >= grid1.Cols() ||
+            row2 + dr < 0 || row2 + dr >= grid2.Rows() ||
+            col2 + dc < 0 || col2 + dc >= grid2.Cols())
+          continue;
+
+        const int neighbor1 = (row1 + dr) * grid1.Cols() + col1 + dc;
+        const int neighbor2 = (row2 + dr) * grid2.Cols() + col2 + dc;
+        for (int kk = starts[neighbor1]; kk < starts[neighbor1 + 1]; ++kk) {
+          if (cells2[order[kk]] == neighbor2)
+            support++;
+        }
+        num_matches += starts[neighbor1 + 1] - starts[neighbor1];
+        num_neighbors++;
+      }
+    }
+
+    if (support <= threshold_ * std::sqrt(static_cast<double>(num_matches) /
+                                          num_neighbors))
+      continue;
+
+    for (int kk = starts[cell]; kk < starts[cell + 1]; ++kk) {
+      if (cells2[order[kk]] == best_cells[cell])
+        is_inlier[order[kk]] = true;
+    }
+  }
+}
+
+}  //\namespace bsfm
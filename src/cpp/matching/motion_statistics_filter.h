@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2015, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: Erik Nelson            ( eanelson@eecs.berkeley.edu )
+ *          David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// The MotionStatisticsFilter class discards feature matches that are not
+// supported by the motion of nearby matches, following grid-based motion
+// statistics (GMS). Both images are divided into a coarse grid, and every cell
+// in the first image is paired with the cell in the second image that receives
+// the most of its matches. A pair of cells is kept if the pairs of cells
+// around it, displaced the same way, also share many matches. Correct matches
+// move coherently with their neighbors, while incorrect matches scatter, so
+// this removes most outliers before RANSAC in time linear in the number of
+// matches.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef BSFM_MATCHING_MOTION_STATISTICS_FILTER_H
+#define BSFM_MATCHING_MOTION_STATISTICS_FILTER_H
+
+#include <vector>
+
+#include "feature.h"
+#include "feature_match.h"
+
+namespace bsfm {
+
+class MotionStatisticsFilter {
+ public:
+  // Each image is divided into 'grid_size' x 'grid_size' cells over the extent
+  // of its matched features. A pair of cells is kept if the number of matches
+  // supporting it exceeds 'threshold' times the square root of the average
+  // number of matches per cell around it.
+  MotionStatisticsFilter(unsigned int grid_size, double threshold);
+  ~MotionStatisticsFilter();
+
+  // Filter the matches 'features1[ii]' <--> 'features2[ii]', storing the
+  // indices of matches that are kept in 'inliers' in increasing order.
+  void Filter(const std::vector<Feature>& features1,
+              const std::vector<Feature>& features2,
+              std::vector<int>& inliers) const;
+
+  // Remove matches that are not kept from 'feature_matches', preserving the
+  // order of the remaining matches.
+  void Filter(FeatureMatchList& feature_matches) const;
+
+ private:
+  // Find the inliers with the grid in the first image shifted by
+  // ('shift_u', 'shift_v') cells, marking them in 'is_inlier'.
+  void FilterShifted(const std::vector<Feature>& features1,
+                     const std::vector<Feature>& features2, double shift_u,
+                     double shift_v, std::vector<bool>& is_inlier) const;
+
+  unsigned int grid_size_;
+  double threshold_;
+};  //\class MotionStatisticsFilter
+
+}  //\namespace bsfm
+
+#endif
@@ -36,40 +36,132 @@
  */
 
 #include "naive_matcher_2d2d.h"
+#include "dot_product_matcher.h"
+#include "feature_grid.h"
+#include "hamming_distance.h"
+#include "motion_statistics_filter.h"
+
+#include <limits>
+#include <type_traits>
 
 namespace bsfm {
 
+namespace {
+
+// Binary descriptors are compared with the vectorized one-to-many Hamming
+// kernel, one query against every descriptor of the other image at once.
+// Floating point descriptors are compared one pair at a time instead, so that
+// each comparison can stop early.
+template <typename DescriptorType>
+struct IsBatched : std::is_same<DescriptorType, BinaryDescriptor> {};
+
+// Compare 'query' to every descriptor in 'descriptors', calling
+// 'add(index, distance)' for each pair. Batched descriptor types compute all
+// distances in one call. The others fall back to 'compare_each', which compares
+// one pair at a time.
+template <typename DescriptorType, typename Add, typename CompareEach>
+inline void CompareToAll(const DescriptorType& query,
+                         const std::vector<DescriptorType>& descriptors,
+                         std::vector<int>& distances, const Add& add,
+                         const CompareEach&, std::true_type) {
+  HammingDistances(query, descriptors, distances);
+  for (size_t jj = 0; jj < distances.size(); ++jj)
+    add(jj, distances[jj]);
+}
+
+template <typename DescriptorType, typename Add, typename CompareEach>
+inline void CompareToAll(const DescriptorType&,
+                         const std::vector<DescriptorType>&, std::vector<int>&,
+                         const Add&, const CompareEach& compare_each,
+                         std::false_type) {
+  compare_each();
+}
+
+}  //\namespace
+
 bool NaiveMatcher2D2D::MatchImagePair(
     int image_index1, int image_index2,
     PairwiseImageMatch& image_match) {
   image_match.feature_matches_.clear();
   image_match.descriptor_indices1_.clear();
   image_match.descriptor_indices2_.clear();
+  image_match.distances_.clear();
 
-  // Get the descriptors corresponding to these two images.
-  std::vector<Descriptor>& descriptors1 = image_descriptors_[image_index1];
-  std::vector<Descriptor>& descriptors2 = image_descriptors_[image_index2];
+  // Get the descriptors corresponding to these two images. Floating point
+  // descriptors have already been normalized in MatchImages(), if required by
+  // the distance metric.
+  const std::vector<Descriptor>& descriptors1 =
+      image_descriptors_[image_index1];
+  const std::vector<Descriptor>& descriptors2 =
+      image_descriptors_[image_index2];
+  const std::vector<BinaryDescriptor>& binary_descriptors1 =
+      image_binary_descriptors_[image_index1];
+  const std::vector<BinaryDescriptor>& binary_descriptors2 =
+      image_binary_descriptors_[image_index2];
+  const bool use_binary =
+      !binary_descriptors1.empty() && !binary_descriptors2.empty();
 
-  // Normalize descriptors if required by the distance metric.
-  DistanceMetric::Instance().SetMetric(options_.distance_metric);
-  DistanceMetric::Instance().MaybeNormalizeDescriptors(descriptors1);
-  DistanceMetric::Instance().MaybeNormalizeDescriptors(descriptors2);
+  // Set the maximum tolerable distance between descriptors, if applicable.
+  const double max_distance = options_.enforce_maximum_descriptor_distance
+      ? options_.maximum_descriptor_distance
+      : std::numeric_limits<double>::max();
 
-  // Compute forward (and reverse, if applicable) matches.
-  LightFeatureMatchList light_feature_matches;
-  ComputePutativeMatches(descriptors1, descriptors2, light_feature_matches);
+  // Without an image space gate, floating point descriptors compared with the
+  // scaled L2 metric are packed into contiguous matrices and matched a block at
+  // a time.
+  const bool use_blocked =
+      !use_binary && !options_.threshold_image_distance &&
+      metric_ == DistanceMetric::SCALED_L2;
+  const std::vector<Feature>& features1 = image_features_[image_index1];
+  const std::vector<Feature>& features2 = image_features_[image_index2];
+  DescriptorMatrix descriptor_matrix1, descriptor_matrix2;
+  if (use_blocked) {
+    descriptor_matrix1.SetDescriptors(descriptors1,
+                                      options_.quantize_descriptors);
+    descriptor_matrix2.SetDescriptors(descriptors2,
+                                      options_.quantize_descriptors);
+  }
 
-  // Check that we got enough matches here. If we didn't, reverse matches won't
-  // help us.
-  if (light_feature_matches.size() < options_.min_num_feature_matches) {
-    return false;
+  // Compute matches. Symmetric matches are found in a single pass over all
+  // descriptor pairs, tracking the best neighbors in both directions at once.
+  // Binary descriptors are always compared with the Hamming distance.
+  LightFeatureMatchList light_feature_matches;
+  if (use_binary) {
+    ComputeMatches(HammingMetric(), max_distance, binary_descriptors1,
+                   binary_descriptors2, features1, features2,
+                   light_feature_matches);
+  } else if (use_blocked && options_.require_symmetric_matches) {
+    ComputeMutualMatches(max_distance, descriptor_matrix1, descriptor_matrix2,
+                         light_feature_matches);
+  } else if (use_blocked) {
+    ComputePutativeMatches(max_distance, descriptor_matrix1,
+                           descriptor_matrix2, light_feature_matches);
+  } else if (metric_ == DistanceMetric::SCALED_L2) {
+    ComputeMatches(ScaledL2Metric(), max_distance, descriptors1, descriptors2,
+                   features1, features2, light_feature_matches);
+  } else {
+    ComputeMatches(HammingMetric(), max_distance, descriptors1, descriptors2,
+                   features1, features2, light_feature_matches);
   }
 
-  if (options_.require_symmetric_matches) {
-    LightFeatureMatchList reverse_light_feature_matches;
-    ComputePutativeMatches(descriptors2, descriptors1,
-                           reverse_light_feature_matches);
-    SymmetricMatches(reverse_light_feature_matches, light_feature_matches);
+  // Discard matches that are not supported by the motion of their neighbors.
+  if (options_.use_motion_statistics_filter) {
+    std::vector<Feature> matched_features1, matched_features2;
+    matched_features1.reserve(light_feature_matches.size());
+    matched_features2.reserve(light_feature_matches.size());
+    for (const auto& match : light_feature_matches) {
+      matched_features1.push_back(features1[match.feature_index1_]);
+      matched_features2.push_back(features2[match.feature_index2_]);
+    }
+
+    std::vector<int> inliers;
+    MotionStatisticsFilter filter(options_.motion_statistics_grid_size,
+                                  options_.motion_statistics_threshold);
+    filter.Filter(matched_features1, matched_features2, inliers);
+    for (size_t ii = 0; ii < inliers.size(); ++ii)
+      light_feature_matches[ii] = light_feature_matches[inliers[ii]];
+    light_feature_matches.erase(light_feature_matches.begin() + inliers.size(),
+                                light_feature_matches.end());
   }
 
   if (light_feature_matches.size() < options_.min_num_feature_matches) {
@@ -90,88 +182,201 @@ bool NaiveMatcher2D2D::MatchImagePair(
   }
 
   // Convert from LightFeatureMatchList to FeatureMatchList for the output.
+  // Putative matches are already close in image space if
+  // 'threshold_image_distance' is set.
   for (int ii = 0; ii < num_features_out; ++ii) {
     const auto& match = light_feature_matches[ii];
 
-    const Feature& matched_feature1 =
-        image_features_[image_index1][match.feature_index1_];
-    const Feature& matched_feature2 =
-        image_features_[image_index2][match.feature_index2_];
-
-    // Check that the features are close in image space.
-    if (options_.threshold_image_distance) {
-      const double du = matched_feature1.u_ - matched_feature2.u_;
-      const double dv = matched_feature1.v_ - matched_feature2.v_;
-      if (std::sqrt(du*du + dv*dv) > options_.maximum_image_distance) {
-        continue;
-      }
-    }
+    const Feature& matched_feature1 = features1[match.feature_index1_];
+    const Feature& matched_feature2 = features2[match.feature_index2_];
     image_match.feature_matches_.emplace_back(matched_feature1,
                                               matched_feature2);
 
     // Also store the index of each descriptor used for this match.
     image_match.descriptor_indices1_.push_back(match.feature_index1_);
     image_match.descriptor_indices2_.push_back(match.feature_index2_);
+    image_match.distances_.push_back(match.distance_);
   }
 
   return true;
 }
 
+template <typename Metric, typename DescriptorType>
+void NaiveMatcher2D2D::ComputeMatches(
+    const Metric& distance, double max_distance,
+    const std::vector<DescriptorType>& descriptors1,
+    const std::vector<DescriptorType>& descriptors2,
+    const std::vector<Feature>& features1,
+    const std::vector<Feature>& features2,
+    std::vector<LightFeatureMatch>& matches) {
+  if (options_.require_symmetric_matches) {
+    ComputeMutualMatches(distance, max_distance, descriptors1, descriptors2,
+                         features1, features2, matches);
+  } else {
+    ComputePutativeMatches(distance, max_distance, descriptors1, descriptors2,
+                           features1, features2, matches);
+  }
+}
+
+template <typename Metric, typename DescriptorType>
 void NaiveMatcher2D2D::ComputePutativeMatches(
-    const std::vector<Descriptor>& descriptors1,
-    const std::vector<Descriptor>& descriptors2,
+    const Metric& distance, double max_distance,
+    const std::vector<DescriptorType>& descriptors1,
+    const std::vector<DescriptorType>& descriptors2,
+    const std::vector<Feature>& features1,
+    const std::vector<Feature>& features2,
     std::vector<LightFeatureMatch>& putative_matches) {
   putative_matches.clear();
 
-  // Get the singletone distance metric for descriptor comparison.
-  DistanceMetric& distance = DistanceMetric::Instance();
-
-  // Set the maximum tolerable distance between descriptors, if applicable.
-  if (options_.enforce_maximum_descriptor_distance) {
-    distance.SetMaximumDistance(options_.maximum_descriptor_distance);
+  // If matches are gated on image space distance, bucket features2 into a
+  // grid so that only nearby features are compared.
+  const bool gated = options_.threshold_image_distance;
+  const double max_image_distance_sq =
+      options_.maximum_image_distance * options_.maximum_image_distance;
+  FeatureGrid grid;
+  if (gated) {
+    grid.Build(features2, options_.maximum_image_distance);
   }
 
-  // Store all matches and their distances.
+  // Only the best two matches of each descriptor are kept, which is all that
+  // the Lowes ratio test needs. If a maximum distance was not set,
+  // 'max_distance' will be infinity and will not reject any matches.
+  std::vector<int> distances;
+  std::vector<int> candidates;
   for (size_t ii = 0; ii < descriptors1.size(); ++ii) {
-    LightFeatureMatchList one_way_matches;
-    for (size_t jj = 0; jj < descriptors2.size(); ++jj) {
-      double dist = distance(descriptors1[ii], descriptors2[jj]);
-
-      // If max distance was not set above, distance.Max() will be infinity and
-      // this will always be true.
-      if (dist < distance.Max()) {
-        one_way_matches.emplace_back(ii, jj, dist);
+    TwoNearestNeighbors nn;
+    auto add = [&](int jj, double dist) {
+      if (dist < max_distance) {
+        nn.Add(jj, dist);
       }
-    }
+    };
+    auto compare_each = [&]() {
+      if (gated) {
+        grid.GetNeighbors(features1[ii], candidates);
+      }
+      const size_t num_candidates =
+          gated ? candidates.size() : descriptors2.size();
+      for (size_t kk = 0; kk < num_candidates; ++kk) {
+        const int jj = gated ? candidates[kk] : kk;
+        if (gated) {
+          const double du = features1[ii].u_ - features2[jj].u_;
+          const double dv = features1[ii].v_ - features2[jj].v_;
+          if (du*du + dv*dv > max_image_distance_sq) {
+            continue;
+          }
+        }
+
+        // Candidates that cannot beat the second best match so far are
+        // abandoned early.
+        const double bound = std::min(max_distance, nn.second_distance_);
+        const double dist =
+            distance.Bounded(descriptors1[ii], descriptors2[jj], bound);
+        if (dist < bound) {
+          nn.Add(jj, dist);
+        }
+      }
+    };
 
-    if (one_way_matches.empty()) {
-      continue;
+    if (gated) {
+      compare_each();
+    } else {
+      CompareToAll(descriptors1[ii], descriptors2, distances, add,
+                   compare_each, IsBatched<DescriptorType>());
     }
 
-    if (one_way_matches.size() == 1) {
-      putative_matches.emplace_back(one_way_matches[0]);
-      continue;
+    if (IsDistinctiveMatch(nn, max_distance, options_)) {
+      putative_matches.emplace_back(ii, nn.best_index_, nn.best_distance_);
     }
+  }
+}
 
-    // Sort by distance. We only care about the distances between the best 2
-    // matches for the Lowes ratio test, and about the best match if we are not
-    // using Lowes ratio.
-    std::partial_sort(one_way_matches.begin(),
-                      one_way_matches.begin() + 2,
-                      one_way_matches.end(),
-                      LightFeatureMatch::SortByDistance);
+void NaiveMatcher2D2D::ComputePutativeMatches(
+    double max_distance, const DescriptorMatrix& descriptors1,
+    const DescriptorMatrix& descriptors2,
+    std::vector<LightFeatureMatch>& putative_matches) {
+  // Same logic as above: matches must be closer than 'max_distance', and a
+  // lone match below the maximum distance is kept without a ratio test.
+  std::vector<TwoNearestNeighbors> neighbors;
+  FindTwoNearestNeighbors(descriptors1, descriptors2, neighbors);
+  OneWayMatches(neighbors, max_distance, options_, putative_matches);
+}
+
+template <typename Metric, typename DescriptorType>
+void NaiveMatcher2D2D::ComputeMutualMatches(
+    const Metric& distance, double max_distance,
+    const std::vector<DescriptorType>& descriptors1,
+    const std::vector<DescriptorType>& descriptors2,
+    const std::vector<Feature>& features1,
+    const std::vector<Feature>& features2,
+    std::vector<LightFeatureMatch>& mutual_matches) {
+  // If matches are gated on image space distance, bucket features2 into a
+  // grid so that only nearby features are compared.
+  const bool gated = options_.threshold_image_distance;
+  const double max_image_distance_sq =
+      options_.maximum_image_distance * options_.maximum_image_distance;
+  FeatureGrid grid;
+  if (gated) {
+    grid.Build(features2, options_.maximum_image_distance);
+  }
 
-    // Store the best match for this element of features2.
-    if (options_.use_lowes_ratio && one_way_matches.size() > 1) {
-      // The second best match must be within the lowes ratio of the best match.
-      if (one_way_matches[0].distance_ <
-          options_.lowes_ratio * one_way_matches[1].distance_) {
-        putative_matches.emplace_back(one_way_matches[0]);
+  // Compare each pair of descriptors once, updating the best two neighbors of
+  // both descriptors.
+  std::vector<TwoNearestNeighbors> neighbors1(descriptors1.size());
+  std::vector<TwoNearestNeighbors> neighbors2(descriptors2.size());
+  std::vector<int> distances;
+  std::vector<int> candidates;
+  for (size_t ii = 0; ii < descriptors1.size(); ++ii) {
+    auto add = [&](int jj, double dist) {
+      if (dist < max_distance) {
+        neighbors1[ii].Add(jj, dist);
+        neighbors2[jj].Add(ii, dist);
+      }
+    };
+    auto compare_each = [&]() {
+      if (gated) {
+        grid.GetNeighbors(features1[ii], candidates);
       }
+      const size_t num_candidates =
+          gated ? candidates.size() : descriptors2.size();
+      for (size_t kk = 0; kk < num_candidates; ++kk) {
+        const int jj = gated ? candidates[kk] : kk;
+        if (gated) {
+          const double du = features1[ii].u_ - features2[jj].u_;
+          const double dv = features1[ii].v_ - features2[jj].v_;
+          if (du*du + dv*dv > max_image_distance_sq) {
+            continue;
+          }
+        }
+
+        // Pairs beyond the maximum distance are abandoned early. The second
+        // best distances of the two descriptors give too loose a bound to pay
+        // for itself here.
+        add(jj,
+            distance.Bounded(descriptors1[ii], descriptors2[jj], max_distance));
+      }
+    };
+
+    if (gated) {
+      compare_each();
     } else {
-      putative_matches.emplace_back(one_way_matches[0]);
+      CompareToAll(descriptors1[ii], descriptors2, distances, add,
+                   compare_each, IsBatched<DescriptorType>());
     }
   }
+
+  MutualMatches(neighbors1, neighbors2, max_distance, options_,
+                mutual_matches);
+}
+
+void NaiveMatcher2D2D::ComputeMutualMatches(
+    double max_distance, const DescriptorMatrix& descriptors1,
+    const DescriptorMatrix& descriptors2,
+    std::vector<LightFeatureMatch>& mutual_matches) {
+  std::vector<TwoNearestNeighbors> neighbors1, neighbors2;
+  FindMutualTwoNearestNeighbors(descriptors1, descriptors2, neighbors1,
+                                neighbors2);
+  MutualMatches(neighbors1, neighbors2, max_distance, options_,
+                mutual_matches);
 }
 
 }  //\namespace bsfm
@@ -50,6 +50,8 @@
 #include <memory>
 #include <vector>
 
+#include "binary_descriptor.h"
+#include "descriptor_matrix.h"
 #include "distance_metric.h"
 #include "feature.h"
 #include "feature_match.h"
@@ -75,11 +77,58 @@ class NaiveMatcher2D2D : public FeatureMatcher {
   virtual bool MatchImagePair(int image_index1, int image_index2,
                               PairwiseImageMatch& feature_matches);
 
-  // Compute putative matches between feature descriptors for an image pair.
-  // These might be removed later on due to e.g. not being symmetric, etc.
-  void ComputePutativeMatches(const std::vector<Descriptor>& descriptors1,
-                              const std::vector<Descriptor>& descriptors2,
+  // Compute matches between the descriptors of an image pair with the
+  // distance metric functor 'distance' (e.g. ScaledL2Metric or HammingMetric),
+  // which is inlined into the comparison loops. Matches are mutual if
+  // 'require_symmetric_matches' is set, and putative otherwise. Distances of
+  // 'max_distance' or more never match.
+  template <typename Metric, typename DescriptorType>
+  void ComputeMatches(const Metric& distance, double max_distance,
+                      const std::vector<DescriptorType>& descriptors1,
+                      const std::vector<DescriptorType>& descriptors2,
+                      const std::vector<Feature>& features1,
+                      const std::vector<Feature>& features2,
+                      std::vector<LightFeatureMatch>& matches);
+
+  // Compute putative matches between feature descriptors for an image pair,
+  // using the input distance metric. These might be removed later on due to
+  // e.g. not being symmetric, etc. If 'threshold_image_distance' is set, only
+  // features that are close in image space are compared. DescriptorType is
+  // either Descriptor or BinaryDescriptor.
+  template <typename Metric, typename DescriptorType>
+  void ComputePutativeMatches(const Metric& distance, double max_distance,
+                              const std::vector<DescriptorType>& descriptors1,
+                              const std::vector<DescriptorType>& descriptors2,
+                              const std::vector<Feature>& features1,
+                              const std::vector<Feature>& features2,
+                              std::vector<LightFeatureMatch>& putative_matches);
+
+  // Same as above, but for normalized descriptors stored in descriptor
+  // matrices, without thresholding on image space distance. Distances are
+  // computed a block at a time with matrix products.
+  void ComputePutativeMatches(double max_distance,
+                              const DescriptorMatrix& descriptors1,
+                              const DescriptorMatrix& descriptors2,
                               std::vector<LightFeatureMatch>& putative_matches);
+
+  // Compute matches between descriptors that are each other's best match,
+  // subject to the same tests as above. Every descriptor pair is compared once,
+  // and the best neighbors of descriptors in both images are tracked together,
+  // which gives the same result as intersecting putative matches computed in
+  // both directions at half the cost.
+  template <typename Metric, typename DescriptorType>
+  void ComputeMutualMatches(const Metric& distance, double max_distance,
+                            const std::vector<DescriptorType>& descriptors1,
+                            const std::vector<DescriptorType>& descriptors2,
+                            const std::vector<Feature>& features1,
+                            const std::vector<Feature>& features2,
+                            std::vector<LightFeatureMatch>& mutual_matches);
+
+  // Same as above, for normalized descriptors stored in descriptor matrices.
+  void ComputeMutualMatches(double max_distance,
+                            const DescriptorMatrix& descriptors1,
+                            const DescriptorMatrix& descriptors2,
+                            std::vector<LightFeatureMatch>& mutual_matches);
 };  //\class NaiveMatcher2D2D
 
 }  //\namespace bsfm
@@ -36,16 +36,57 @@
  */
 
 #include "naive_matcher_2d3d.h"
+#include "dot_product_matcher.h"
+#include "feature_grid.h"
+#include "hamming_distance.h"
+
+#include <limits>
 
 namespace bsfm {
 
-NaiveMatcher2D3D::NaiveMatcher2D3D() {}
+NaiveMatcher2D3D::NaiveMatcher2D3D()
+    : metric_(DistanceMetric::SCALED_L2),
+      max_distance_(std::numeric_limits<double>::max()),
+      store_(nullptr) {}
 
 NaiveMatcher2D3D::~NaiveMatcher2D3D() {}
 
+void NaiveMatcher2D3D::SetLandmarkDescriptorStore(
+    const LandmarkDescriptorStore* store) {
+  store_ = store;
+}
+
 bool NaiveMatcher2D3D::Match(
     const FeatureMatcherOptions& options, const ViewIndex& view_index,
     const std::vector<LandmarkIndex>& landmark_indices) {
+  // Get the image space position of each landmark to threshold matches based
+  // on image space distance. If the landmark has not been observed at all, set
+  // a feature position to be at infinity such that the distance check will
+  // fail on this landmark.
+  std::vector<Feature> projected_features;
+  projected_features.reserve(landmark_indices.size());
+  for (const auto& landmark_index : landmark_indices) {
+    const Landmark::Ptr landmark = Landmark::GetLandmark(landmark_index);
+    CHECK_NOTNULL(landmark.get());
+    if (!landmark->Observations().empty()) {
+      const Observation::Ptr observation = landmark->Observations().back();
+      CHECK_NOTNULL(observation.get());
+      projected_features.push_back(observation->Feature());
+    } else {
+      projected_features.push_back(Feature(std::numeric_limits<double>::max(),
+                                           std::numeric_limits<double>::max()));
+    }
+  }
+
+  return Match(options, view_index, landmark_indices, projected_features);
+}
+
+bool NaiveMatcher2D3D::Match(
+    const FeatureMatcherOptions& options, const ViewIndex& view_index,
+    const std::vector<LandmarkIndex>& landmark_indices,
+    const std::vector<Feature>& projected_features) {
+  CHECK_EQ(landmark_indices.size(), projected_features.size());
+
   // Copy options.
   options_ = options;
 
@@ -56,68 +97,213 @@ bool NaiveMatcher2D3D::Match(
     return false;
   }
 
-  // Get descriptors from unincorporated observations in the view.
+  // Pick the distance metric and the maximum tolerable distance between
+  // descriptors, if applicable.
+  metric_ = DistanceMetric::Parse(options_.distance_metric);
+  max_distance_ = options_.enforce_maximum_descriptor_distance
+      ? options_.maximum_descriptor_distance
+      : std::numeric_limits<double>::max();
+
+  // Landmark descriptors can be taken from the descriptor store if it holds
+  // every landmark, normalized for the same metric.
+  std::vector<int> store_slots;
+  bool use_store = store_ != nullptr &&
+      store_->GetMetric() == metric_;
+  if (use_store) {
+    store_slots.reserve(landmark_indices.size());
+    for (const auto& landmark_index : landmark_indices) {
+      store_slots.push_back(store_->Slot(landmark_index));
+      if (store_slots.back() < 0) {
+        use_store = false;
+        break;
+      }
+    }
+  }
+
+  // Match packed binary descriptors if every observation and landmark has one.
+  std::vector<Observation::Ptr> observations = view->Observations();
+  bool use_binary = true;
+  for (const auto& observation : observations) {
+    CHECK_NOTNULL(observation.get());
+    if (!observation->IsIncorporated() && !observation->IsMatched() &&
+        !observation->HasBinaryDescriptor())
+      use_binary = false;
+  }
+  for (size_t ii = 0; ii < landmark_indices.size() && use_binary; ++ii) {
+    if (use_store) {
+      if (store_->BinaryDescriptors()[store_slots[ii]].Empty())
+        use_binary = false;
+      continue;
+    }
+    const Landmark::Ptr landmark = Landmark::GetLandmark(landmark_indices[ii]);
+    CHECK_NOTNULL(landmark.get());
+    if (!landmark->HasBinaryDescriptor())
+      use_binary = false;
+  }
+
+  // Get descriptors from unincorporated observations in the view that have not
+  // already been matched.
   std::vector<Feature> features;
   std::vector<Descriptor> descriptors_2d;
+  std::vector<BinaryDescriptor> binary_descriptors_2d;
   std::vector<size_t> observation_indices;
-  std::vector<Observation::Ptr> observations = view->Observations();
+  std::vector<size_t> unnormalized_2d;
   for (size_t ii = 0; ii < observations.size(); ++ii) {
-    CHECK_NOTNULL(observations[ii].get());
-    if (!observations[ii]->IsIncorporated()) {
-      descriptors_2d.push_back(observations[ii]->Descriptor());
+    if (!observations[ii]->IsIncorporated() && !observations[ii]->IsMatched()) {
+      if (use_binary) {
+        binary_descriptors_2d.push_back(observations[ii]->BinaryDescriptor());
+      } else {
+        if (!observations[ii]->HasNormalizedDescriptor())
+          unnormalized_2d.push_back(descriptors_2d.size());
+        descriptors_2d.push_back(observations[ii]->Descriptor());
+      }
       features.push_back(observations[ii]->Feature());
       observation_indices.push_back(ii);
     }
   }
 
   // Get descriptors from landmarks.
-  std::vector<Feature> projected_features;
   std::vector<Descriptor> descriptors_3d;
-  descriptors_3d.reserve(landmark_indices.size());
+  std::vector<BinaryDescriptor> binary_descriptors_3d;
+  std::vector<size_t> unnormalized_3d;
+  if (use_binary)
+    binary_descriptors_3d.reserve(landmark_indices.size());
+  else
+    descriptors_3d.reserve(landmark_indices.size());
   for (size_t ii = 0; ii < landmark_indices.size(); ii++) {
+    if (use_store) {
+      if (use_binary)
+        binary_descriptors_3d.push_back(
+            store_->BinaryDescriptors()[store_slots[ii]]);
+      else
+        descriptors_3d.push_back(store_->Descriptors()[store_slots[ii]]);
+      continue;
+    }
     const Landmark::Ptr landmark = Landmark::GetLandmark(landmark_indices[ii]);
-    CHECK_NOTNULL(landmark.get());
-    descriptors_3d.push_back(landmark->Descriptor());
-
-    // Get the image space position of the landmark to threshold matches based
-    // on image space distance. If the landmark has not been observed at all,
-    // set a feature position to be at infinity such that the distance check will
-    // fail on this landmark.
-    if (!landmark->Observations().empty()) {
-      const Observation::Ptr observation = landmark->Observations().back();
-      CHECK_NOTNULL(observation.get());
-      projected_features.push_back(observation->Feature());
+    if (use_binary) {
+      binary_descriptors_3d.push_back(landmark->BinaryDescriptor());
     } else {
-      projected_features.push_back(Feature(std::numeric_limits<double>::max(),
-                                           std::numeric_limits<double>::max()));
+      if (!landmark->HasNormalizedDescriptor())
+        unnormalized_3d.push_back(descriptors_3d.size());
+      descriptors_3d.push_back(landmark->Descriptor());
     }
   }
 
-  // Normalize descriptors if required by the distance metric.
-  DistanceMetric::Instance().SetMetric(options_.distance_metric);
-  DistanceMetric::Instance().MaybeNormalizeDescriptors(descriptors_2d);
-  DistanceMetric::Instance().MaybeNormalizeDescriptors(descriptors_3d);
+  // Normalize descriptors if required by the distance metric. Most descriptors
+  // were normalized once when they were extracted, and those from the store
+  // are already normalized, so only the remaining ones are normalized here.
+  if (metric_ == DistanceMetric::SCALED_L2) {
+    for (const auto& ii : unnormalized_2d)
+      descriptors_2d[ii].normalize();
+    for (const auto& ii : unnormalized_3d)
+      descriptors_3d[ii].normalize();
+  }
+
+  // Without an image space gate, every 2D descriptor is compared with every 3D
+  // descriptor. In that case floating point descriptors under the scaled L2
+  // metric are packed into matrices and matched a block at a time.
+  const bool use_blocked =
+      !use_binary && !options_.threshold_image_distance &&
+      metric_ == DistanceMetric::SCALED_L2;
+  DescriptorMatrix descriptor_matrix_2d, descriptor_matrix_3d;
+  if (use_blocked) {
+    descriptor_matrix_2d.SetDescriptors(descriptors_2d,
+                                        options_.quantize_descriptors);
+    descriptor_matrix_3d.SetDescriptors(descriptors_3d,
+                                        options_.quantize_descriptors);
+  }
 
-  // Compute forward matches.
+  // Large sets of binary descriptors are searched with a multi-index hash table
+  // rather than by brute force. Image space gating already limits the number
+  // of comparisons, so the index is only used without it.
+  const bool index_3d = use_binary && !options_.threshold_image_distance &&
+      binary_descriptors_3d.size() >= options_.min_num_descriptors_for_index;
+  const bool index_2d = use_binary && !options_.threshold_image_distance &&
+      binary_descriptors_2d.size() >= options_.min_num_descriptors_for_index;
+  BinaryDescriptorIndex binary_index_2d, binary_index_3d;
+  if (index_3d)
+    binary_index_3d.AddDescriptors(binary_descriptors_3d);
+
+  // Compute matches. Unless landmark descriptors are searched with an index,
+  // symmetric matches are found in a single pass over all descriptor pairs.
+  // Binary descriptors are always compared with the Hamming distance.
   std::vector<LightFeatureMatch> forward_matches;
-  ComputeOneWayMatches(descriptors_2d,
-                       descriptors_3d,
-                       features,
-                       projected_features,
-                       forward_matches);
-
-  if (forward_matches.size() < options_.min_num_feature_matches)
-    return false;
+  if (options_.require_symmetric_matches && !index_3d) {
+    if (use_binary) {
+      ComputeMutualMatches(HammingMetric(),
+                           binary_descriptors_2d,
+                           binary_descriptors_3d,
+                           features,
+                           projected_features,
+                           forward_matches);
+    } else if (use_blocked) {
+      ComputeMutualMatches(descriptor_matrix_2d, descriptor_matrix_3d,
+                           forward_matches);
+    } else if (metric_ == DistanceMetric::SCALED_L2) {
+      ComputeMutualMatches(ScaledL2Metric(),
+                           descriptors_2d,
+                           descriptors_3d,
+                           features,
+                           projected_features,
+                           forward_matches);
+    } else {
+      ComputeMutualMatches(HammingMetric(),
+                           descriptors_2d,
+                           descriptors_3d,
+                           features,
+                           projected_features,
+                           forward_matches);
+    }
+  } else {
+    if (index_3d) {
+      ComputeOneWayMatches(binary_descriptors_2d, binary_index_3d,
+                           forward_matches);
+    } else if (use_binary) {
+      ComputeOneWayMatches(HammingMetric(),
+                           binary_descriptors_2d,
+                           binary_descriptors_3d,
+                           features,
+                           projected_features,
+                           forward_matches);
+    } else if (use_blocked) {
+      ComputeOneWayMatches(descriptor_matrix_2d, descriptor_matrix_3d,
+                           forward_matches);
+    } else if (metric_ == DistanceMetric::SCALED_L2) {
+      ComputeOneWayMatches(ScaledL2Metric(),
+                           descriptors_2d,
+                           descriptors_3d,
+                           features,
+                           projected_features,
+                           forward_matches);
+    } else {
+      ComputeOneWayMatches(HammingMetric(),
+                           descriptors_2d,
+                           descriptors_3d,
+                           features,
+                           projected_features,
+                           forward_matches);
+    }
 
-  // Compute reverse matches if needed.
-  if (options_.require_symmetric_matches) {
-    std::vector<LightFeatureMatch> reverse_matches;
-    ComputeOneWayMatches(descriptors_3d,
-                         descriptors_2d,
-                         projected_features,
-                         features,
-                         reverse_matches);
-    ComputeSymmetricMatches(reverse_matches, forward_matches);
+    if (forward_matches.size() < options_.min_num_feature_matches)
+      return false;
+
+    // Compute reverse matches against the index if needed.
+    if (options_.require_symmetric_matches) {
+      std::vector<LightFeatureMatch> reverse_matches;
+      if (index_2d) {
+        binary_index_2d.AddDescriptors(binary_descriptors_2d);
+        ComputeOneWayMatches(binary_descriptors_3d, binary_index_2d,
+                             reverse_matches);
+      } else {
+        ComputeOneWayMatches(HammingMetric(),
+                             binary_descriptors_3d,
+                             binary_descriptors_2d,
+                             projected_features,
+                             features,
+                             reverse_matches);
+      }
+      ComputeSymmetricMatches(reverse_matches, forward_matches);
+    }
   }
 
   // Symmetric matches are now stored in 'forward_matches'.
@@ -144,7 +330,8 @@ bool NaiveMatcher2D3D::Match(
     const LandmarkIndex landmark_index =
         landmark_indices[forward_matches[ii].feature_index2_];
 
-    observations[observation_index]->SetMatchedLandmark(landmark_index);
+    observations[observation_index]->SetMatchedLandmark(
+        landmark_index, forward_matches[ii].distance_);
   }
 
   return true;
@@ -154,72 +341,167 @@ bool NaiveMatcher2D3D::Match(
 // Note: this is essentially the function
 // NaiveFeatureMatcher::ComputePutativeMatches but it has been adjusted slightly
 // for this 2d-3d matcher.
+template <typename Metric, typename DescriptorType>
 void NaiveMatcher2D3D::ComputeOneWayMatches(
-     const std::vector<Descriptor>& descriptors1,
-     const std::vector<Descriptor>& descriptors2,
+     const Metric& distance,
+     const std::vector<DescriptorType>& descriptors1,
+     const std::vector<DescriptorType>& descriptors2,
      const std::vector<Feature>& features1,
      const std::vector<Feature>& features2,
      std::vector<LightFeatureMatch>& matches) {
   matches.clear();
 
-  // Get the singletone distance metric for descriptor comparison.
-  DistanceMetric& distance = DistanceMetric::Instance();
-
-  // Set the maximum tolerable distance between descriptors, if applicable.
-  if (options_.enforce_maximum_descriptor_distance) {
-    distance.SetMaximumDistance(options_.maximum_descriptor_distance);
+  // If matches are gated on image space distance, bucket features2 into a
+  // grid so that only nearby features are compared.
+  const double max_image_distance_sq =
+      options_.maximum_image_distance * options_.maximum_image_distance;
+  FeatureGrid grid;
+  if (options_.threshold_image_distance) {
+    grid.Build(features2, options_.maximum_image_distance);
   }
 
-  // Store all matches and their distances.
+  // Only the best two matches of each descriptor are kept, which is all that
+  // the Lowes ratio test needs.
+  const bool gated = options_.threshold_image_distance;
+  const double max_distance = max_distance_;
+  std::vector<int> candidates;
   for (size_t ii = 0; ii < descriptors1.size(); ++ii) {
-    LightFeatureMatchList one_way_matches;
-    for (size_t jj = 0; jj < descriptors2.size(); ++jj) {
-      const double dist = distance(descriptors1[ii], descriptors2[jj]);
-      bool close_in_image_space = true;
+    TwoNearestNeighbors nn;
+    if (gated) {
+      grid.GetNeighbors(features1[ii], candidates);
+    }
+    const size_t num_candidates =
+        gated ? candidates.size() : descriptors2.size();
+    for (size_t kk = 0; kk < num_candidates; ++kk) {
+      const int jj = gated ? candidates[kk] : kk;
 
       // Check if the feature match is close enough in image space to be
-      // considered a match.
-      if (options_.threshold_image_distance) {
+      // considered a match before comparing descriptors.
+      if (gated) {
         const double du = features1[ii].u_ - features2[jj].u_;
         const double dv = features1[ii].v_ - features2[jj].v_;
-        if (std::sqrt(du*du + dv*dv) > options_.maximum_image_distance) {
-          close_in_image_space = false;
+        if (du*du + dv*dv > max_image_distance_sq) {
+          continue;
         }
       }
 
-      // If max distance was not set above, distance.Max() will be infinity and
-      // this first check (dist < distance.Max()) will always be true.
-      if (dist < distance.Max() && close_in_image_space) {
-        one_way_matches.emplace_back(ii, jj, dist);
+      // Candidates that cannot beat the second best match so far, or that are
+      // beyond the maximum distance, are abandoned early. If max distance was
+      // not set, it will be infinity.
+      const double bound = std::min(max_distance, nn.second_distance_);
+      const double dist =
+          distance.Bounded(descriptors1[ii], descriptors2[jj], bound);
+      if (dist < bound) {
+        nn.Add(jj, dist);
       }
     }
 
-    if (one_way_matches.empty()) {
-      continue;
+    if (IsDistinctiveMatch(nn, max_distance, options_)) {
+      matches.emplace_back(ii, nn.best_index_, nn.best_distance_);
     }
+  }
+}
 
-    if (one_way_matches.size() == 1) {
-      matches.emplace_back(one_way_matches[0]);
-      continue;
-    }
+// Compute one-way matches from descriptor matrices, without an image space
+// gate.
+void NaiveMatcher2D3D::ComputeOneWayMatches(
+    const DescriptorMatrix& descriptors1, const DescriptorMatrix& descriptors2,
+    std::vector<LightFeatureMatch>& matches) {
+  matches.clear();
 
-    // Sort by distance. We only care about the distances between the best 2
-    // matches for the Lowes ratio test, and only care about the lowest distance
-    // match if we are not using Lowes ratio.
-    std::partial_sort(one_way_matches.begin(),
-                      one_way_matches.begin() + 2,
-                      one_way_matches.end(),
-                      LightFeatureMatch::SortByDistance);
+  std::vector<TwoNearestNeighbors> neighbors;
+  FindTwoNearestNeighbors(descriptors1, descriptors2, neighbors);
+  OneWayMatches(neighbors, max_distance_, options_, matches);
+}
+
+// Compute mutual matches, comparing each descriptor pair once.
+template <typename Metric, typename DescriptorType>
+void NaiveMatcher2D3D::ComputeMutualMatches(
+    const Metric& distance,
+    const std::vector<DescriptorType>& descriptors1,
+    const std::vector<DescriptorType>& descriptors2,
+    const std::vector<Feature>& features1,
+    const std::vector<Feature>& features2,
+    std::vector<LightFeatureMatch>& matches) {
+  // If matches are gated on image space distance, bucket features2 into a
+  // grid so that only nearby features are compared.
+  const double max_image_distance_sq =
+      options_.maximum_image_distance * options_.maximum_image_distance;
+  FeatureGrid grid;
+  if (options_.threshold_image_distance) {
+    grid.Build(features2, options_.maximum_image_distance);
+  }
+
+  // Track the best two neighbors of descriptors on both sides at once.
+  const bool gated = options_.threshold_image_distance;
+  const double max_distance = max_distance_;
+  std::vector<TwoNearestNeighbors> neighbors1(descriptors1.size());
+  std::vector<TwoNearestNeighbors> neighbors2(descriptors2.size());
+  std::vector<int> candidates;
+  for (size_t ii = 0; ii < descriptors1.size(); ++ii) {
+    if (gated) {
+      grid.GetNeighbors(features1[ii], candidates);
+    }
+    const size_t num_candidates =
+        gated ? candidates.size() : descriptors2.size();
+    for (size_t kk = 0; kk < num_candidates; ++kk) {
+      const int jj = gated ? candidates[kk] : kk;
+      if (gated) {
+        const double du = features1[ii].u_ - features2[jj].u_;
+        const double dv = features1[ii].v_ - features2[jj].v_;
+        if (du*du + dv*dv > max_image_distance_sq) {
+          continue;
+        }
+      }
 
-    // Store the best match for this element of features2.
-    if (options_.use_lowes_ratio) {
-      // The second best match must be within the lowes ratio of the best match.
-      if (one_way_matches[0].distance_ <
-          options_.lowes_ratio * one_way_matches[1].distance_) {
-        matches.emplace_back(one_way_matches[0]);
+      // Pairs beyond the maximum distance are abandoned early. The second best
+      // distances of the two descriptors give too loose a bound to pay for
+      // itself here.
+      const double dist =
+          distance.Bounded(descriptors1[ii], descriptors2[jj], max_distance);
+      if (dist < max_distance) {
+        neighbors1[ii].Add(jj, dist);
+        neighbors2[jj].Add(ii, dist);
       }
-    } else {
-      matches.emplace_back(one_way_matches[0]);
+    }
+  }
+
+  MutualMatches(neighbors1, neighbors2, max_distance_, options_, matches);
+}
+
+// Compute mutual matches from descriptor matrices, without an image space
+// gate.
+void NaiveMatcher2D3D::ComputeMutualMatches(
+    const DescriptorMatrix& descriptors1, const DescriptorMatrix& descriptors2,
+    std::vector<LightFeatureMatch>& matches) {
+  std::vector<TwoNearestNeighbors> neighbors1, neighbors2;
+  FindMutualTwoNearestNeighbors(descriptors1, descriptors2, neighbors1,
+                                neighbors2);
+  MutualMatches(neighbors1, neighbors2, max_distance_, options_, matches);
+}
+
+// Compute one-way matches against a binary descriptor index, without an image
+// space gate.
+void NaiveMatcher2D3D::ComputeOneWayMatches(
+    const std::vector<BinaryDescriptor>& descriptors1,
+    const BinaryDescriptorIndex& descriptors2,
+    std::vector<LightFeatureMatch>& matches) {
+  matches.clear();
+
+  // The two nearest neighbors are all that the ratio test needs.
+  std::vector<int> nn_indices, nn_distances;
+  for (size_t ii = 0; ii < descriptors1.size(); ++ii) {
+    descriptors2.KNearestNeighbors(descriptors1[ii], 2, nn_indices,
+                                   nn_distances);
+    if (nn_indices.empty() || !(nn_distances[0] < max_distance_)) {
+      continue;
+    }
+    const bool has_second =
+        nn_indices.size() > 1 && nn_distances[1] < max_distance_;
+
+    if (!has_second || !options_.use_lowes_ratio ||
+        nn_distances[0] < options_.lowes_ratio * nn_distances[1]) {
+      matches.emplace_back(ii, nn_indices[0], nn_distances[0]);
     }
   }
 }
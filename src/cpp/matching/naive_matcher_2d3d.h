@@ -51,6 +51,9 @@
 #include <memory>
 #include <vector>
 
+#include "binary_descriptor.h"
+#include "binary_descriptor_index.h"
+#include "descriptor_matrix.h"
 #include "distance_metric.h"
 #include "feature.h"
 #include "feature_match.h"
@@ -58,6 +61,7 @@
 
 #include "../sfm/view.h"
 #include "../slam/landmark.h"
+#include "../slam/landmark_descriptor_store.h"
 #include "../slam/observation.h"
 #include "../util/disallow_copy_and_assign.h"
 
@@ -68,24 +72,74 @@ class NaiveMatcher2D3D {
   NaiveMatcher2D3D();
   ~NaiveMatcher2D3D();
 
+  // Take landmark descriptors from 'store' instead of copying and normalizing
+  // them from the landmark registry. The store is only used if it holds every
+  // landmark being matched and was normalized for the same distance metric. It
+  // must outlive calls to Match(). Pass nullptr to stop using a store.
+  void SetLandmarkDescriptorStore(const LandmarkDescriptorStore* store);
+
   // Match observations stored in the view referred to by 'view_index' with
   // landmarks in 'landmark_indices'. Update all matched observations in the
-  // view.
+  // view. Observations that are already matched are skipped. If matches are
+  // thresholded on image space distance, each landmark is placed at the
+  // position of its most recent observation.
   bool Match(const FeatureMatcherOptions& options,
              const ViewIndex& view_index,
              const std::vector<LandmarkIndex>& landmark_indices);
 
+  // Same as above, but with the image space position of each landmark given in
+  // 'projected_features' (e.g. the landmark projected into a predicted camera
+  // pose).
+  bool Match(const FeatureMatcherOptions& options,
+             const ViewIndex& view_index,
+             const std::vector<LandmarkIndex>& landmark_indices,
+             const std::vector<Feature>& projected_features);
+
  private:
   DISALLOW_COPY_AND_ASSIGN(NaiveMatcher2D3D)
 
-  // Compute one-way matches. Feature positions are provided so that the matches
-  // can be thresholded based on image space distance.
-  void ComputeOneWayMatches(const std::vector<Descriptor>& descriptors1,
-                            const std::vector<Descriptor>& descriptors2,
+  // Compute one-way matches with the distance metric functor 'distance' (e.g.
+  // ScaledL2Metric or HammingMetric). Feature positions are provided so that
+  // the matches can be thresholded based on image space distance, in which case
+  // only features from neighboring grid cells are compared. DescriptorType is
+  // either Descriptor or BinaryDescriptor.
+  template <typename Metric, typename DescriptorType>
+  void ComputeOneWayMatches(const Metric& distance,
+                            const std::vector<DescriptorType>& descriptors1,
+                            const std::vector<DescriptorType>& descriptors2,
+                            const std::vector<Feature>& features1,
+                            const std::vector<Feature>& features2,
+                            std::vector<LightFeatureMatch>& matches);
+
+  // Compute one-way matches between normalized descriptors stored in
+  // descriptor matrices, without thresholding on image space distance.
+  void ComputeOneWayMatches(const DescriptorMatrix& descriptors1,
+                            const DescriptorMatrix& descriptors2,
+                            std::vector<LightFeatureMatch>& matches);
+
+  // Compute one-way matches between binary descriptors and descriptors stored
+  // in a multi-index hash table, without thresholding on image space distance.
+  void ComputeOneWayMatches(const std::vector<BinaryDescriptor>& descriptors1,
+                            const BinaryDescriptorIndex& descriptors2,
+                            std::vector<LightFeatureMatch>& matches);
+
+  // Compute matches between descriptors that are each other's best match,
+  // comparing each descriptor pair once. This gives the same result as
+  // computing one-way matches in both directions and keeping symmetric ones.
+  template <typename Metric, typename DescriptorType>
+  void ComputeMutualMatches(const Metric& distance,
+                            const std::vector<DescriptorType>& descriptors1,
+                            const std::vector<DescriptorType>& descriptors2,
                             const std::vector<Feature>& features1,
                             const std::vector<Feature>& features2,
                             std::vector<LightFeatureMatch>& matches);
 
+  // Same as above, for normalized descriptors stored in descriptor matrices,
+  // without thresholding on image space distance.
+  void ComputeMutualMatches(const DescriptorMatrix& descriptors1,
+                            const DescriptorMatrix& descriptors2,
+                            std::vector<LightFeatureMatch>& matches);
+
   // Compute symmetric matches.
   // Note: this is essentially the function FeatureMatcher::SymmetricMatches
   // but it has been adjusted slightly for this 2d-3d matcher.
@@ -96,6 +150,14 @@ class NaiveMatcher2D3D {
   // Feature matching options.
   FeatureMatcherOptions options_;
 
+  // The distance metric named by 'options_.distance_metric', and the maximum
+  // tolerable descriptor distance. Both are set at the start of Match().
+  DistanceMetric::Metric metric_;
+  double max_distance_;
+
+  // Optional store of normalized landmark descriptors. Not owned.
+  const LandmarkDescriptorStore* store_;
+
 };  //\class NaiveMatcher2D3D
 
 }  //\namespace bsfm
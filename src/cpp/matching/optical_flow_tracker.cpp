@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2015, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: Erik Nelson            ( eanelson@eecs.berkeley.edu )
+ *          David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+#include "optical_flow_tracker.h"
+
+#include <cmath>
+#include <glog/logging.h>
+#include <opencv2/video/tracking.hpp>
+
+namespace bsfm {
+
+OpticalFlowTracker::OpticalFlowTracker()
+    : window_size_(21), pyramid_levels_(3), max_flow_error_(1.0) {}
+
+void OpticalFlowTracker::SetOptions(unsigned int window_size,
+                                    unsigned int pyramid_levels,
+                                    double max_flow_error) {
+  CHECK_GT(window_size, 0);
+  window_size_ = window_size;
+  pyramid_levels_ = pyramid_levels;
+  max_flow_error_ = max_flow_error;
+}
+
+void OpticalFlowTracker::SetImage(const Image& image) {
+  ToGrayscale(image, previous_image_);
+}
+
+bool OpticalFlowTracker::HasImage() const {
+  return !previous_image_.empty();
+}
+
+bool OpticalFlowTracker::Track(const Image& image,
+                               const std::vector<Feature>& features,
+                               std::vector<Feature>& tracked_features,
+                               std::vector<bool>& found) const {
+  tracked_features.clear();
+  found.clear();
+  if (!HasImage()) {
+    VLOG(1) << "No image has been set to track features from.";
+    return false;
+  }
+  if (features.empty())
+    return true;
+
+  cv::Mat gray_image;
+  ToGrayscale(image, gray_image);
+
+  std::vector<cv::Point2f> points;
+  points.reserve(features.size());
+  for (const auto& feature : features)
+    points.push_back(cv::Point2f(feature.u_, feature.v_));
+
+  // Track features into the new image.
+  const cv::Size window(window_size_, window_size_);
+  const cv::TermCriteria criteria(
+      cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 30, 0.01);
+  std::vector<cv::Point2f> tracked_points;
+  std::vector<unsigned char> status;
+  std::vector<float> error;
+  cv::calcOpticalFlowPyrLK(previous_image_, gray_image, points,
+                           tracked_points, status, error, window,
+                           pyramid_levels_, criteria);
+
+  // Optionally track them back again, and check that they return to where they
+  // started.
+  std::vector<cv::Point2f> returned_points;
+  std::vector<unsigned char> returned_status;
+  if (max_flow_error_ > 0.0) {
+    cv::calcOpticalFlowPyrLK(gray_image, previous_image_, tracked_points,
+                             returned_points, returned_status, error, window,
+                             pyramid_levels_, criteria);
+  }
+
+  tracked_features.reserve(features.size());
+  found.resize(features.size(), false);
+  for (size_t ii = 0; ii < features.size(); ++ii) {
+    const cv::Point2f& point = tracked_points[ii];
+    tracked_features.push_back(Feature(point.x, point.y));
+
+    if (!status[ii] || point.x < 0.0 || point.y < 0.0 ||
+        point.x >= gray_image.cols || point.y >= gray_image.rows)
+      continue;
+
+    if (max_flow_error_ > 0.0) {
+      const double du = returned_points[ii].x - points[ii].x;
+      const double dv = returned_points[ii].y - points[ii].y;
+      if (!returned_status[ii] ||
+          std::sqrt(du*du + dv*dv) > max_flow_error_)
+        continue;
+    }
+
+    found[ii] = true;
+  }
+
+  return true;
+}
+
+void OpticalFlowTracker::ToGrayscale(const Image& image, cv::Mat& gray_image) {
+  image.ToCV(gray_image);
+  if (image.IsColor()) {
+    cv::cvtColor(gray_image, gray_image, CV_BGR2GRAY);
+  }
+}
+
+}  //\namespace bsfm
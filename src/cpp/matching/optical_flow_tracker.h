@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2015, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: Erik Nelson            ( eanelson@eecs.berkeley.edu )
+ *          David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// The OpticalFlowTracker class tracks features from one image into the next
+// with pyramidal Lucas-Kanade optical flow. This is much cheaper than
+// detecting, describing, and matching features in every image, and works well
+// while the motion between consecutive images is small.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef BSFM_MATCHING_OPTICAL_FLOW_TRACKER_H
+#define BSFM_MATCHING_OPTICAL_FLOW_TRACKER_H
+
+#include <opencv2/core/core.hpp>
+#include <vector>
+
+#include "feature.h"
+#include "../image/image.h"
+#include "../util/disallow_copy_and_assign.h"
+
+namespace bsfm {
+
+class OpticalFlowTracker {
+ public:
+  OpticalFlowTracker();
+  ~OpticalFlowTracker() {}
+
+  // Set tracking parameters.
+  // - window_size:       side length (pixels) of the patch tracked around each
+  //                      feature, at each pyramid level.
+  // - pyramid_levels:    number of pyramid levels above the full resolution
+  //                      image.
+  // - max_flow_error:    if positive, features are tracked back into the
+  //                      previous image, and are discarded if they do not
+  //                      return within this many pixels of where they started.
+  void SetOptions(unsigned int window_size, unsigned int pyramid_levels,
+                  double max_flow_error);
+
+  // Set the image that features will be tracked from.
+  void SetImage(const Image& image);
+
+  // Returns whether an image has been set to track features from.
+  bool HasImage() const;
+
+  // Track 'features' from the image passed to SetImage() into 'image'. Each
+  // feature's position in 'image' is stored in 'tracked_features', and
+  // 'found[ii]' is set if the feature was tracked successfully and lies within
+  // 'image'. Returns false if no image has been set to track from.
+  bool Track(const Image& image, const std::vector<Feature>& features,
+             std::vector<Feature>& tracked_features,
+             std::vector<bool>& found) const;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(OpticalFlowTracker)
+
+  // Convert an image to single channel OpenCV format.
+  static void ToGrayscale(const Image& image, cv::Mat& gray_image);
+
+  // The image that features are tracked from, in grayscale.
+  cv::Mat previous_image_;
+
+  // Tracking parameters. See 'SetOptions()' for descriptions.
+  unsigned int window_size_;
+  unsigned int pyramid_levels_;
+  double max_flow_error_;
+
+};  //\class OpticalFlowTracker
+
+}  //\namespace bsfm
+#endif
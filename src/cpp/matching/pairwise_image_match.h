@@ -56,6 +56,11 @@ struct PairwiseImageMatch {
   typedef std::shared_ptr<PairwiseImageMatch> Ptr;
   typedef std::shared_ptr<const PairwiseImageMatch> ConstPtr;
 
+  // Indices of the two matched images, in the order that they were added to
+  // the feature matcher.
+  int image_index1_ = -1;
+  int image_index2_ = -1;
+
   // The image-space locations of the matched features in each image.
   FeatureMatchList feature_matches_;
 
@@ -64,6 +69,9 @@ struct PairwiseImageMatch {
   std::vector<int> descriptor_indices1_;
   std::vector<int> descriptor_indices2_;
 
+  // Descriptor distance of each match. Smaller distances are better matches.
+  std::vector<double> distances_;
+
 };  //\class PairwiseImageMatch
 
 typedef std::vector<PairwiseImageMatch> PairwiseImageMatchList;
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2015, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: Erik Nelson            ( eanelson@eecs.berkeley.edu )
+ *          David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+#include "two_nearest_neighbors.h"
+
+namespace bsfm {
+
+bool IsDistinctiveMatch(const TwoNearestNeighbors& neighbors,
+                        double max_distance,
+                        const FeatureMatcherOptions& options) {
+  if (neighbors.best_index_ < 0 || !(neighbors.best_distance_ < max_distance))
+    return false;
+
+  // A lone match below the maximum distance is kept without a ratio test.
+  const bool has_second = neighbors.second_index_ >= 0 &&
+                          neighbors.second_distance_ < max_distance;
+  return !has_second || !options.use_lowes_ratio ||
+         neighbors.best_distance_ <
+             options.lowes_ratio * neighbors.second_distance_;
+}
+
+void OneWayMatches(const std::vector<TwoNearestNeighbors>& neighbors,
+                   double max_distance, const FeatureMatcherOptions& options,
+                   std::vector<LightFeatureMatch>& matches) {
+  matches.clear();
+  for (size_t ii = 0; ii < neighbors.size(); ++ii) {
+    if (IsDistinctiveMatch(neighbors[ii], max_distance, options)) {
+      matches.emplace_back(ii, neighbors[ii].best_index_,
+                           neighbors[ii].best_distance_);
+    }
+  }
+}
+
+void MutualMatches(const std::vector<TwoNearestNeighbors>& neighbors1,
+                   const std::vector<TwoNearestNeighbors>& neighbors2,
+                   double max_distance, const FeatureMatcherOptions& options,
+                   std::vector<LightFeatureMatch>& matches) {
+  matches.clear();
+  for (size_t ii = 0; ii < neighbors1.size(); ++ii) {
+    if (!IsDistinctiveMatch(neighbors1[ii], max_distance, options))
+      continue;
+
+    const int jj = neighbors1[ii].best_index_;
+    if (neighbors2[jj].best_index_ == static_cast<int>(ii) &&
+        IsDistinctiveMatch(neighbors2[jj], max_distance, options)) {
+      matches.emplace_back(ii, jj, neighbors1[ii].best_distance_);
+    }
+  }
+}
+
+}  //\namespace bsfm
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2015, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: Erik Nelson            ( eanelson@eecs.berkeley.edu )
+ *          David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// The TwoNearestNeighbors struct tracks the best two neighbors of a descriptor,
+// which is all that the Lowe's ratio test needs. The functions below turn the
+// neighbors found for each descriptor of one set (and, for mutual matching,
+// each descriptor of the other set) into feature matches.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef BSFM_MATCHING_TWO_NEAREST_NEIGHBORS_H
+#define BSFM_MATCHING_TWO_NEAREST_NEIGHBORS_H
+
+#include <limits>
+#include <vector>
+
+#include "feature_match.h"
+#include "feature_matcher_options.h"
+
+namespace bsfm {
+
+// The best two neighbors of a single query descriptor. An index of -1 means
+// that there is no such neighbor (i.e. there were fewer than two train rows).
+struct TwoNearestNeighbors {
+  TwoNearestNeighbors()
+      : best_index_(-1),
+        second_index_(-1),
+        best_distance_(std::numeric_limits<double>::max()),
+        second_distance_(std::numeric_limits<double>::max()) {}
+
+  // Consider a neighbor at the given distance. Ties keep the earlier neighbor
+  // in front.
+  void Add(int index, double distance) {
+    if (!(distance < second_distance_))
+      return;
+    if (distance < best_distance_) {
+      second_index_ = best_index_;
+      second_distance_ = best_distance_;
+      best_index_ = index;
+      best_distance_ = distance;
+    } else {
+      second_index_ = index;
+      second_distance_ = distance;
+    }
+  }
+
+  int best_index_;
+  int second_index_;
+  double best_distance_;
+  double second_distance_;
+};  //\struct TwoNearestNeighbors
+
+// Returns whether the best neighbor is a good enough match: it must be closer
+// than 'max_distance' and, if the Lowe's ratio test is enabled, sufficiently
+// closer than the second best neighbor. A second best neighbor that is not
+// closer than 'max_distance' is ignored.
+bool IsDistinctiveMatch(const TwoNearestNeighbors& neighbors,
+                        double max_distance,
+                        const FeatureMatcherOptions& options);
+
+// Create a match for every descriptor whose best neighbor is distinctive.
+// 'neighbors[ii]' holds the neighbors of descriptor ii of the first set among
+// the descriptors of the second set.
+void OneWayMatches(const std::vector<TwoNearestNeighbors>& neighbors,
+                   double max_distance, const FeatureMatcherOptions& options,
+                   std::vector<LightFeatureMatch>& matches);
+
+// Create a match for every pair of descriptors that are each other's
+// distinctive best neighbor. 'neighbors1' holds neighbors of the first set
+// among the second, and 'neighbors2' the neighbors of the second set among the
+// first. This gives the same matches as intersecting one-way matches in both
+// directions.
+void MutualMatches(const std::vector<TwoNearestNeighbors>& neighbors1,
+                   const std::vector<TwoNearestNeighbors>& neighbors2,
+                   double max_distance, const FeatureMatcherOptions& options,
+                   std::vector<LightFeatureMatch>& matches);
+
+}  //\namespace bsfm
+
+#endif
@@ -0,0 +1,478 @@
+/*
+ * Copyright (c) 2015, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: Erik Nelson            ( eanelson@eecs.berkeley.edu )
+ *          David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+#include "vocabulary_tree.h"
+#include "hamming_distance.h"
+
+#include <algorithm>
+#include <cmath>
+#include <glog/logging.h>
+#include <limits>
+
+namespace bsfm {
+
+namespace {
+
+// Maximum number of k-means iterations when splitting a node.
+const int kMaxKMeansIterations = 10;
+
+// Seed for k-means++ initialization, so that training is repeatable.
+const unsigned long kTrainingSeed = 0;
+
+// Squared distances used for clustering. Both descriptor types return the
+// square of their matching distance, so k-means++ seeds them consistently.
+double ClusterDistance(const Descriptor& descriptor1,
+                       const Descriptor& descriptor2) {
+  return (descriptor1 - descriptor2).squaredNorm();
+}
+
+double ClusterDistance(const BinaryDescriptor& descriptor1,
+                       const BinaryDescriptor& descriptor2) {
+  const double d =
+      static_cast<double>(HammingDistance(descriptor1, descriptor2));
+  return d * d;
+}
+
+// The center of a cluster of floating point descriptors is their mean.
+void ComputeCenter(const std::vector<const Descriptor*>& members,
+                   Descriptor& center) {
+  CHECK(!members.empty());
+  center = Descriptor::Zero(members[0]->size());
+  for (const auto& member : members)
+    center += *member;
+  center /= static_cast<double>(members.size());
+}
+
+// The center of a cluster of binary descriptors has each bit set if it is set
+// in at least half of the members (k-majority).
+void ComputeCenter(const std::vector<const BinaryDescriptor*>& members,
+                   BinaryDescriptor& center) {
+  CHECK(!members.empty());
+  const size_t num_bytes = members[0]->Bytes();
+  std::vector<int> bit_counts(8 * num_bytes, 0);
+  for (const auto& member : members) {
+    const unsigned char* bytes = member->Data();
+    for (size_t ii = 0; ii < bit_counts.size(); ++ii)
+      bit_counts[ii] += (bytes[ii / 8] >> (ii % 8)) & 1;
+  }
+
+  unsigned char bytes[BinaryDescriptor::kMaxBytes] = {0};
+  for (size_t ii = 0; ii < bit_counts.size(); ++ii) {
+    if (2 * bit_counts[ii] >= static_cast<int>(members.size()))
+      bytes[ii / 8] |= static_cast<unsigned char>(1 << (ii % 8));
+  }
+  center = BinaryDescriptor(bytes, num_bytes);
+}
+
+// Cluster 'points' into at most 'k' clusters with k-means++ initialization.
+// On return, 'assignments' holds the cluster index of each point.
+template <typename DescriptorType>
+void KMeans(const std::vector<const DescriptorType*>& points, unsigned int k,
+            math::RandomGenerator& rng, std::vector<DescriptorType>& centers,
+            std::vector<int>& assignments) {
+  const int num_points = static_cast<int>(points.size());
+  k = std::min(k, static_cast<unsigned int>(num_points));
+  centers.clear();
+  assignments.assign(num_points, 0);
+  if (k == 0)
+    return;
+
+  // k-means++: pick each new center with probability proportional to its
+  // squared distance from the closest existing center.
+  std::vector<double> min_distances(num_points,
+                                    std::numeric_limits<double>::max());
+  centers.push_back(*points[rng.IntegerUniform(0, num_points - 1)]);
+  while (centers.size() < k) {
+    double total = 0.0;
+    for (int ii = 0; ii < num_points; ++ii) {
+      min_distances[ii] = std::min(
+          min_distances[ii], ClusterDistance(*points[ii], centers.back()));
+      total += min_distances[ii];
+    }
+
+    // All remaining points coincide with a center.
+    if (total <= 0.0)
+      break;
+
+    double target = rng.Double() * total;
+    int chosen = num_points - 1;
+    for (int ii = 0; ii < num_points; ++ii) {
+      target -= min_distances[ii];
+      if (target <= 0.0 && min_distances[ii] > 0.0) {
+        chosen = ii;
+        break;
+      }
+    }
+    centers.push_back(*points[chosen]);
+  }
+
+  // Lloyd iterations.
+  std::vector<std::vector<const DescriptorType*> > members(centers.size());
+  for (int iteration = 0; iteration < kMaxKMeansIterations; ++iteration) {
+    bool changed = iteration == 0;
+    for (int ii = 0; ii < num_points; ++ii) {
+      int best = 0;
+      double best_distance = std::numeric_limits<double>::max();
+      for (size_t jj = 0; jj < centers.size(); ++jj) {
+        const double d = ClusterDistance(*points[ii], centers[jj]);
+        if (d < best_distance) {
+          best_distance = d;
+          best = jj;
+        }
+      }
+      if (assignments[ii] != best) {
+        assignments[ii] = best;
+        changed = true;
+      }
+    }
+    if (!changed)
+      break;
+
+    // Recompute centers. Empty clusters keep their previous center.
+    for (auto& cluster : members)
+      cluster.clear();
+    for (int ii = 0; ii < num_points; ++ii)
+      members[assignments[ii]].push_back(points[ii]);
+    for (size_t jj = 0; jj < centers.size(); ++jj) {
+      if (!members[jj].empty())
+        ComputeCenter(members[jj], centers[jj]);
+    }
+  }
+}
+
+}  //\namespace
+
+VocabularyTree::VocabularyTree()
+    : binary_(false), branching_(0), depth_(0) {}
+
+VocabularyTree::~VocabularyTree() {}
+
+bool VocabularyTree::Train(
+    const std::vector<std::vector<Descriptor> >& descriptors,
+    unsigned int branching, unsigned int depth) {
+  binary_ = false;
+  binary_centers_.clear();
+  return TrainTree(descriptors, branching, depth, centers_);
+}
+
+bool VocabularyTree::Train(
+    const std::vector<std::vector<BinaryDescriptor> >& descriptors,
+    unsigned int branching, unsigned int depth) {
+  binary_ = true;
+  centers_.clear();
+  return TrainTree(descriptors, branching, depth, binary_centers_);
+}
+
+bool VocabularyTree::IsTrained() const {
+  return !idf_.empty();
+}
+
+bool VocabularyTree::IsBinary() const {
+  return binary_;
+}
+
+size_t VocabularyTree::NumWords() const {
+  return idf_.size();
+}
+
+size_t VocabularyTree::NumImages() const {
+  return image_words_.size();
+}
+
+int VocabularyTree::Quantize(const Descriptor& descriptor) const {
+  CHECK(!binary_) << "Tree was trained on binary descriptors.";
+  return QuantizeDescriptor(descriptor, centers_);
+}
+
+int VocabularyTree::Quantize(const BinaryDescriptor& descriptor) const {
+  CHECK(binary_) << "Tree was trained on floating point descriptors.";
+  return QuantizeDescriptor(descriptor, binary_centers_);
+}
+
+int VocabularyTree::AddImage(const std::vector<Descriptor>& descriptors) {
+  CHECK(!binary_) << "Tree was trained on binary descriptors.";
+  WordVector words;
+  ComputeWordVector(descriptors, centers_, words);
+  return AddWordVector(words);
+}
+
+int VocabularyTree::AddImage(
+    const std::vector<BinaryDescriptor>& descriptors) {
+  CHECK(binary_) << "Tree was trained on floating point descriptors.";
+  WordVector words;
+  ComputeWordVector(descriptors, binary_centers_, words);
+  return AddWordVector(words);
+}
+
+void VocabularyTree::ClearImages() {
+  image_words_.clear();
+  inverted_file_.assign(idf_.size(), std::vector<std::pair<int, double> >());
+}
+
+void VocabularyTree::Query(int image_index, unsigned int k,
+                           std::vector<int>& image_indices) const {
+  CHECK_GE(image_index, 0);
+  CHECK_LT(image_index, static_cast<int>(image_words_.size()));
+  image_indices.clear();
+
+  // Accumulate dot products of the query's word vector with every database
+  // image that shares at least one word with it.
+  std::vector<double> scores(image_words_.size(), 0.0);
+  for (const auto& word : image_words_[image_index]) {
+    for (const auto& entry : inverted_file_[word.first])
+      scores[entry.first] += word.second * entry.second;
+  }
+
+  std::vector<std::pair<double, int> > candidates;
+  for (size_t ii = 0; ii < scores.size(); ++ii) {
+    if (static_cast<int>(ii) != image_index && scores[ii] > 0.0)
+      candidates.push_back(std::make_pair(-scores[ii], ii));
+  }
+
+  // Sort by decreasing score, breaking ties by image index.
+  const size_t num_out = std::min(static_cast<size_t>(k), candidates.size());
+  std::partial_sort(candidates.begin(), candidates.begin() + num_out,
+                    candidates.end());
+  for (size_t ii = 0; ii < num_out; ++ii)
+    image_indices.push_back(candidates[ii].second);
+}
+
+double VocabularyTree::Score(int image_index1, int image_index2) const {
+  CHECK_LT(image_index1, static_cast<int>(image_words_.size()));
+  CHECK_LT(image_index2, static_cast<int>(image_words_.size()));
+
+  // Both word vectors are sorted by word.
+  const WordVector& words1 = image_words_[image_index1];
+  const WordVector& words2 = image_words_[image_index2];
+  double score = 0.0;
+  auto iter1 = words1.begin();
+  auto iter2 = words2.begin();
+  while (iter1 != words1.end() && iter2 != words2.end()) {
+    if (iter1->first < iter2->first) {
+      ++iter1;
+    } else if (iter2->first < iter1->first) {
+      ++iter2;
+    } else {
+      score += iter1->second * iter2->second;
+      ++iter1;
+      ++iter2;
+    }
+  }
+  return score;
+}
+
+template <typename DescriptorType>
+void VocabularyTree::Split(
+    const std::vector<const DescriptorType*>& descriptors, int node_index,
+    unsigned int level, std::vector<DescriptorType>& centers,
+    math::RandomGenerator& rng) {
+  // Stop at the maximum depth, or when there are too few descriptors to split.
+  std::vector<DescriptorType> cluster_centers;
+  std::vector<int> assignments;
+  if (level < depth_ && descriptors.size() > branching_) {
+    KMeans(descriptors, branching_, rng, cluster_centers, assignments);
+  }
+
+  std::vector<std::vector<const DescriptorType*> > members(
+      cluster_centers.size());
+  for (size_t ii = 0; ii < assignments.size(); ++ii)
+    members[assignments[ii]].push_back(descriptors[ii]);
+
+  // Create a child for each non-empty cluster.
+  const int first_child = nodes_.size();
+  std::vector<size_t> child_clusters;
+  for (size_t ii = 0; ii < members.size(); ++ii) {
+    if (members[ii].empty())
+      continue;
+    Node child = {-1, 0, -1};
+    nodes_.push_back(child);
+    centers.push_back(cluster_centers[ii]);
+    child_clusters.push_back(ii);
+  }
+
+  // A single cluster would not split the descriptors, so make a leaf instead.
+  if (child_clusters.size() < 2) {
+    nodes_.resize(first_child);
+    centers.resize(first_child);
+    nodes_[node_index].word = idf_.size();
+    idf_.push_back(0.0);
+    return;
+  }
+
+  nodes_[node_index].first_child = first_child;
+  nodes_[node_index].num_children = child_clusters.size();
+  for (size_t ii = 0; ii < child_clusters.size(); ++ii) {
+    Split(members[child_clusters[ii]], first_child + ii, level + 1, centers,
+          rng);
+  }
+}
+
+template <typename DescriptorType>
+bool VocabularyTree::TrainTree(
+    const std::vector<std::vector<DescriptorType> >& descriptors,
+    unsigned int branching, unsigned int depth,
+    std::vector<DescriptorType>& centers) {
+  nodes_.clear();
+  centers.clear();
+  idf_.clear();
+  image_words_.clear();
+  inverted_file_.clear();
+
+  if (branching < 2 || depth == 0) {
+    LOG(WARNING) << "Vocabulary tree needs a branching factor of at least 2 "
+                    "and a depth of at least 1.";
+    return false;
+  }
+  branching_ = branching;
+  depth_ = depth;
+
+  std::vector<const DescriptorType*> all_descriptors;
+  for (const auto& image_descriptors : descriptors) {
+    for (const auto& descriptor : image_descriptors)
+      all_descriptors.push_back(&descriptor);
+  }
+  if (all_descriptors.empty()) {
+    LOG(WARNING) << "Cannot train a vocabulary tree without descriptors.";
+    return false;
+  }
+
+  // Build the tree from the root down. The root has no center, so store a
+  // placeholder to keep 'centers' aligned with 'nodes_'.
+  Node root = {-1, 0, -1};
+  nodes_.push_back(root);
+  centers.push_back(DescriptorType());
+  math::RandomGenerator rng(kTrainingSeed);
+  Split(all_descriptors, 0, 0, centers, rng);
+
+  // Compute the inverse document frequency of each word over the training
+  // images: idf = log((N + 1) / N_w), where N_w is the number of images that
+  // contain word w. The smoothing keeps words seen in every training image from
+  // getting zero weight, so that images can still be retrieved when the tree is
+  // trained on only a few images.
+  std::vector<int> document_counts(idf_.size(), 0);
+  std::vector<int> words;
+  for (const auto& image_descriptors : descriptors) {
+    words.clear();
+    for (const auto& descriptor : image_descriptors)
+      words.push_back(QuantizeDescriptor(descriptor, centers));
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+    for (const auto& word : words)
+      document_counts[word]++;
+  }
+  for (size_t ii = 0; ii < idf_.size(); ++ii) {
+    idf_[ii] = document_counts[ii] > 0
+                   ? std::log(static_cast<double>(descriptors.size() + 1) /
+                              document_counts[ii])
+                   : 0.0;
+  }
+
+  inverted_file_.resize(idf_.size());
+  return true;
+}
+
+template <typename DescriptorType>
+int VocabularyTree::QuantizeDescriptor(
+    const DescriptorType& descriptor,
+    const std::vector<DescriptorType>& centers) const {
+  CHECK(IsTrained()) << "Vocabulary tree has not been trained.";
+
+  // Descend to the closest child at each level.
+  int node_index = 0;
+  while (nodes_[node_index].num_children > 0) {
+    const Node& node = nodes_[node_index];
+    int best_child = node.first_child;
+    double best_distance = std::numeric_limits<double>::max();
+    for (int ii = node.first_child; ii < node.first_child + node.num_children;
+         ++ii) {
+      const double d = ClusterDistance(descriptor, centers[ii]);
+      if (d < best_distance) {
+        best_distance = d;
+        best_child = ii;
+      }
+    }
+    node_index = best_child;
+  }
+  return nodes_[node_index].word;
+}
+
+template <typename DescriptorType>
+void VocabularyTree::ComputeWordVector(
+    const std::vector<DescriptorType>& descriptors,
+    const std::vector<DescriptorType>& centers, WordVector& words) const {
+  words.clear();
+  if (descriptors.empty())
+    return;
+
+  // Term frequencies.
+  std::vector<int> word_indices;
+  word_indices.reserve(descriptors.size());
+  for (const auto& descriptor : descriptors)
+    word_indices.push_back(QuantizeDescriptor(descriptor, centers));
+  std::sort(word_indices.begin(), word_indices.end());
+
+  // Weight each word by tf * idf, and normalize.
+  double norm = 0.0;
+  for (size_t ii = 0; ii < word_indices.size();) {
+    size_t jj = ii;
+    while (jj < word_indices.size() && word_indices[jj] == word_indices[ii])
+      ++jj;
+    const double weight = static_cast<double>(jj - ii) /
+                          descriptors.size() * idf_[word_indices[ii]];
+    if (weight > 0.0) {
+      words.push_back(std::make_pair(word_indices[ii], weight));
+      norm += weight * weight;
+    }
+    ii = jj;
+  }
+
+  norm = std::sqrt(norm);
+  for (auto& word : words)
+    word.second /= norm;
+}
+
+int VocabularyTree::AddWordVector(const WordVector& words) {
+  const int image_index = image_words_.size();
+  image_words_.push_back(words);
+  for (const auto& word : words) {
+    inverted_file_[word.first].push_back(
+        std::make_pair(image_index, word.second));
+  }
+  return image_index;
+}
+
+}  //\namespace bsfm
@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2015, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: Erik Nelson            ( eanelson@eecs.berkeley.edu )
+ *          David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// The VocabularyTree class implements hierarchical k-means image retrieval
+// (Nister and Stewenius, "Scalable Recognition with a Vocabulary Tree", CVPR
+// 2006). Descriptors are quantized into visual words by descending a tree of
+// cluster centers, and each image is summarized as a TF-IDF weighted histogram
+// of its words. Images added to the database are stored in an inverted file,
+// so that the most similar images to a query can be found without comparing
+// against every image.
+//
+// Trees can be trained on floating point descriptors (clustered with k-means
+// under the L2 distance) or on packed binary descriptors (clustered with
+// k-majority under the Hamming distance).
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef BSFM_MATCHING_VOCABULARY_TREE_H
+#define BSFM_MATCHING_VOCABULARY_TREE_H
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "binary_descriptor.h"
+
+#include "../math/random_generator.h"
+#include "../util/disallow_copy_and_assign.h"
+#include "../util/types.h"
+
+namespace bsfm {
+
+class VocabularyTree {
+ public:
+  typedef std::shared_ptr<VocabularyTree> Ptr;
+  typedef std::shared_ptr<const VocabularyTree> ConstPtr;
+
+  VocabularyTree();
+  ~VocabularyTree();
+
+  // Train the tree from descriptors of a set of training images, with one list
+  // of descriptors per image. Each node is split into at most 'branching'
+  // clusters, down to 'depth' levels, giving up to branching^depth words.
+  // Inverse document frequency weights are computed over the training images.
+  // Any images in the database are removed.
+  bool Train(const std::vector<std::vector<Descriptor> >& descriptors,
+             unsigned int branching, unsigned int depth);
+  bool Train(const std::vector<std::vector<BinaryDescriptor> >& descriptors,
+             unsigned int branching, unsigned int depth);
+
+  // Accessors.
+  bool IsTrained() const;
+  bool IsBinary() const;
+  size_t NumWords() const;
+  size_t NumImages() const;
+
+  // Find the visual word for a descriptor. The descriptor type must match the
+  // descriptors that the tree was trained with.
+  int Quantize(const Descriptor& descriptor) const;
+  int Quantize(const BinaryDescriptor& descriptor) const;
+
+  // Add an image to the database. Returns the image's index in the database,
+  // which counts up from 0.
+  int AddImage(const std::vector<Descriptor>& descriptors);
+  int AddImage(const std::vector<BinaryDescriptor>& descriptors);
+
+  // Remove all images from the database.
+  void ClearImages();
+
+  // Find the (at most) 'k' database images that are most similar to database
+  // image 'image_index', excluding the image itself. Results are sorted by
+  // decreasing similarity, and images that share no words with the query are
+  // never returned.
+  void Query(int image_index, unsigned int k,
+             std::vector<int>& image_indices) const;
+
+  // Similarity between two database images, from 0 (no words in common) to 1
+  // (identical word histograms).
+  double Score(int image_index1, int image_index2) const;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(VocabularyTree)
+
+  // A sparse, L2-normalized TF-IDF vector of (word, weight) pairs sorted by
+  // word.
+  typedef std::vector<std::pair<int, double> > WordVector;
+
+  // A node in the tree. Children of a node are stored contiguously. Leaves
+  // have no children and store a word index.
+  struct Node {
+    int first_child;
+    int num_children;
+    int word;
+  };
+
+  // Recursively cluster descriptors under 'node_index', storing the cluster
+  // centers of new nodes in 'centers'.
+  template <typename DescriptorType>
+  void Split(const std::vector<const DescriptorType*>& descriptors,
+             int node_index, unsigned int level,
+             std::vector<DescriptorType>& centers,
+             math::RandomGenerator& rng);
+
+  template <typename DescriptorType>
+  bool TrainTree(const std::vector<std::vector<DescriptorType> >& descriptors,
+                 unsigned int branching, unsigned int depth,
+                 std::vector<DescriptorType>& centers);
+
+  template <typename DescriptorType>
+  int QuantizeDescriptor(const DescriptorType& descriptor,
+                         const std::vector<DescriptorType>& centers) const;
+
+  // Compute the TF-IDF vector of an image's descriptors.
+  template <typename DescriptorType>
+  void ComputeWordVector(const std::vector<DescriptorType>& descriptors,
+                         const std::vector<DescriptorType>& centers,
+                         WordVector& words) const;
+
+  // Add a word vector to the database.
+  int AddWordVector(const WordVector& words);
+
+  // Tree structure and cluster centers. centers_[ii] (or binary_centers_[ii])
+  // is the center of nodes_[ii]. The root has no center.
+  std::vector<Node> nodes_;
+  std::vector<Descriptor> centers_;
+  std::vector<BinaryDescriptor> binary_centers_;
+  bool binary_;
+  unsigned int branching_;
+  unsigned int depth_;
+
+  // Inverse document frequency of each word.
+  std::vector<double> idf_;
+
+  // The word vector of each database image, and the inverted file storing
+  // (image index, weight) for every image that contains each word.
+  std::vector<WordVector> image_words_;
+  std::vector<std::vector<std::pair<int, double> > > inverted_file_;
+};  //\class VocabularyTree
+
+}  //\namespace bsfm
+
+#endif
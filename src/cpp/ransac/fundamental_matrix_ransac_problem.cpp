@@ -75,17 +75,11 @@ double FundamentalMatrixRansacModel::Error() const {
   return error_;
 }
 
-// Evaluate model on a single data element and update error.
+// Test the squared Sampson distance of a single match against the tolerance.
 bool FundamentalMatrixRansacModel::IsGoodFit(
     const FeatureMatch& data_point,
     double error_tolerance) const {
-  const double error = EvaluateEpipolarCondition(data_point);
-
-  // Test squared error against the provided tolerance.
-  if (error * error < error_tolerance) {
-    return true;
-  }
-  return false;
+  return SampsonDistance(F_, data_point) < error_tolerance;
 }
 
 double FundamentalMatrixRansacModel::EvaluateEpipolarCondition(
@@ -108,44 +102,16 @@ FundamentalMatrixRansacProblem::FundamentalMatrixRansacProblem() {}
 // RansacProblem destructor.
 FundamentalMatrixRansacProblem::~FundamentalMatrixRansacProblem() {}
 
-// Subsample the data.
-std::vector<FeatureMatch> FundamentalMatrixRansacProblem::SampleData(
-    unsigned int num_samples) {
-  // Randomly shuffle the entire dataset and take the first elements.
-  std::random_shuffle(data_.begin(), data_.end());
-
-  // Make sure we don't over step.
-
-  if (static_cast<size_t>(num_samples) > data_.size()) {
-    VLOG(1) << "Requested more RANSAC data samples than are available. "
-               "Returning all data.";
-    num_samples = data_.size();
-  }
+void FundamentalMatrixRansacProblem::SetData(
+    const std::vector<FeatureMatch>& data) {
+  RansacProblem::SetData(data);
 
-  // Get samples.
-  std::vector<FeatureMatch> samples(
-      data_.begin(), data_.begin() + static_cast<size_t>(num_samples));
-
-  return samples;
-}
-
-// Return all data that was not sampled.
-std::vector<FeatureMatch> FundamentalMatrixRansacProblem::RemainingData(
-    unsigned int num_sampled_previously) const {
-  // In Sample(), the data was shuffled and we took the first
-  // 'num_sampled_previously' elements. Here, take the remaining elements.
-  if (num_sampled_previously >= data_.size()) {
-    VLOG(1) << "No remaining RANSAC data to sample.";
-    return std::vector<FeatureMatch>();
-  }
-
-  return std::vector<FeatureMatch>(
-      data_.begin() + num_sampled_previously, data_.end());
+  matches_.Set(data_);
 }
 
 // Fit a model to the provided data using the 8-point algorithm.
 FundamentalMatrixRansacModel FundamentalMatrixRansacProblem::FitModel(
-    const std::vector<FeatureMatch>& input_data) const {
+    const std::vector<int>& indices) const {
   // Create an empty fundamental matrix.
   Matrix3d F;
 
@@ -154,15 +120,22 @@ FundamentalMatrixRansacModel FundamentalMatrixRansacProblem::FitModel(
   FundamentalMatrixSolverOptions options;
   solver.SetOptions(options);
 
+  FeatureMatchList input_data;
+  input_data.reserve(indices.size());
+  for (const auto& index : indices)
+    input_data.push_back(data_[index]);
+
   if (solver.ComputeFundamentalMatrix(input_data, F)) {
     // Create a new RansacModel using the computed fundamental matrix.
     FundamentalMatrixRansacModel model_out(F);
 
-    // Record sum of squared error over all matches.
+    // Record sum of squared Sampson distances over all matches.
     model_out.error_ = 0.0;
-    for (const auto& feature_match : input_data) {
-      const double error = model_out.EvaluateEpipolarCondition(feature_match);
-      model_out.error_ += error * error;
+    for (const auto& index : indices) {
+      model_out.error_ += SampsonDistance(F, matches_.u1_[index],
+                                          matches_.v1_[index],
+                                          matches_.u2_[index],
+                                          matches_.v2_[index]);
     }
 
     return model_out;
@@ -173,4 +146,27 @@ FundamentalMatrixRansacModel FundamentalMatrixRansacProblem::FitModel(
   return model_out;
 }
 
+size_t FundamentalMatrixRansacProblem::FindInliers(
+    const FundamentalMatrixRansacModel& model, double error_tolerance,
+    InlierMask& inliers) const {
+  return SampsonInliers(model.F_, matches_, error_tolerance, inliers);
+}
+
+bool FundamentalMatrixRansacProblem::IsInlier(
+    const FundamentalMatrixRansacModel& model, double error_tolerance,
+    int index) const {
+  return SampsonDistance(model.F_, matches_.u1_[index], matches_.v1_[index],
+                         matches_.u2_[index],
+                         matches_.v2_[index]) < error_tolerance;
+}
+
+size_t FundamentalMatrixRansacProblem::CountInliers(
+    const FundamentalMatrixRansacModel& model, double error_tolerance,
+    const std::vector<int>& indices) const {
+  size_t num_inliers = 0;
+  for (const auto& index : indices)
+    num_inliers += IsInlier(model, error_tolerance, index);
+  return num_inliers;
+}
+
 }  //\namespace bsfm
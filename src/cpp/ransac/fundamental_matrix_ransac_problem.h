@@ -49,6 +49,7 @@
 #include <vector>
 
 #include "ransac_problem.h"
+#include "../geometry/sampson_distance.h"
 #include "../matching/feature_match.h"
 #include "../util/disallow_copy_and_assign.h"
 
@@ -69,7 +70,8 @@ struct FundamentalMatrixRansacModel : public RansacModel<FeatureMatch> {
   // Return model error.
   virtual double Error() const;
 
-  // Evaluate model on a single data element and update error.
+  // Returns whether the squared Sampson distance of 'data_point' is below
+  // 'error_tolerance' (in squared pixels).
   virtual bool IsGoodFit(const FeatureMatch& data_point,
                          double error_tolerance) const;
 
@@ -90,19 +92,37 @@ class FundamentalMatrixRansacProblem
   FundamentalMatrixRansacProblem();
   virtual ~FundamentalMatrixRansacProblem();
 
-  // Subsample the data.
-  virtual std::vector<FeatureMatch> SampleData(unsigned int num_samples);
+  // Set the data, and gather feature coordinates from it.
+  virtual void SetData(const std::vector<FeatureMatch>& data);
 
-  // Return the data that was not sampled.
-  virtual std::vector<FeatureMatch> RemainingData(
-      unsigned int num_sampled_previously) const;
+  // The methods below are final, so that Ransac calls them without virtual
+  // dispatch when it is given this problem.
 
-  // Fit a model to the provided data using the 8-point algorithm.
+  // Fit a model to the data at 'indices' using the 8-point algorithm.
   virtual FundamentalMatrixRansacModel FitModel(
-      const std::vector<FeatureMatch>& input_data) const;
+      const std::vector<int>& indices) const final;
+
+  // Mark matches whose squared Sampson distance under 'model' is below
+  // 'error_tolerance' (in squared pixels).
+  virtual size_t FindInliers(const FundamentalMatrixRansacModel& model,
+                             double error_tolerance,
+                             InlierMask& inliers) const final;
+
+  // Returns whether FindInliers() would mark the match at 'index'.
+  virtual bool IsInlier(const FundamentalMatrixRansacModel& model,
+                        double error_tolerance, int index) const final;
+
+  // Count the matches at 'indices' that FindInliers() would mark.
+  virtual size_t CountInliers(const FundamentalMatrixRansacModel& model,
+                              double error_tolerance,
+                              const std::vector<int>& indices) const final;
 
  private:
   DISALLOW_COPY_AND_ASSIGN(FundamentalMatrixRansacProblem)
+
+  // Coordinates of the features of each match, so that all matches can be
+  // scored in one batch.
+  FeatureMatchArrays matches_;
 };  //\class FundamentalMatrixRansacProblem
 
 } //\namespace bsfm
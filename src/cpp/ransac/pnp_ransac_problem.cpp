@@ -50,24 +50,24 @@ namespace bsfm {
 // Note: this should really never be used -- instead use the constructor below.
 PnPRansacModel::PnPRansacModel()
   : camera_(Camera()),
-    matches_(std::vector<Observation::Ptr>()),
-    error_(0.0) {}
+    error_(0.0),
+    world_to_camera_(Matrix34d::Identity()) {}
 
 // Constructor. Set parameters as given.
 // Use this constructor instead of the default.
-PnPRansacModel::PnPRansacModel(const Camera& camera,
-			       const std::vector<Observation::Ptr>& matches)
+PnPRansacModel::PnPRansacModel(const Camera& camera, double error)
   : camera_(camera),
-    matches_(matches),
-    error_(0.0) {}
+    error_(error),
+    world_to_camera_(
+        camera.Extrinsics().WorldToCamera().Get().topLeftCorner<3, 4>()) {}
 
 // Destructor.
 PnPRansacModel::~PnPRansacModel() {}
 
 // Return model error.
 double PnPRansacModel::Error() const {
-  // Evaluate reprojection error over all observations.
-  return ReprojectionError(matches_, camera_);
+  // Reprojection error was evaluated over all observations in FitModel().
+  return error_;
 }
 
 // Evaluate model on a single data element and update error.
@@ -87,61 +87,40 @@ void PnPRansacProblem::SetIntrinsics(CameraIntrinsics& intrinsics) {
   intrinsics_ = intrinsics;
 }
 
-// Subsample the data.
-std::vector<Observation::Ptr> PnPRansacProblem::SampleData(
-   unsigned int num_samples) {
+// Set the data, and gather features and landmark positions from it.
+void PnPRansacProblem::SetData(const std::vector<Observation::Ptr>& data) {
+  RansacProblem::SetData(data);
 
-  // Randomly shuffle the entire dataset and take the first elements.
-  std::random_shuffle(data_.begin(), data_.end());
-
-  // Make sure we don't over step.
-  if (static_cast<size_t>(num_samples) > data_.size()) {
-    VLOG(1) << "Requested more RANSAC data samples than are available. "
-	    << "Returning all data.";
-    num_samples = data_.size();
-  }
-
-  // Get samples.
-  std::vector<Observation::Ptr> samples(
-    data_.begin(), data_.begin() + static_cast<size_t>(num_samples));
+  points_2d_.clear();
+  points_3d_.clear();
+  points_2d_.reserve(data_.size());
+  points_3d_.reserve(data_.size());
+  for (const auto& observation : data_) {
+    CHECK_NOTNULL(observation.get());
 
-  return samples;
-}
+    // Extract feature and append.
+    points_2d_.push_back(observation->Feature());
 
-// Return the data that was not sampled.
-std::vector<Observation::Ptr> PnPRansacProblem::RemainingData(
-    unsigned int num_sampled_previously) const {
-  // In Sample(), the data was shuffled and we took the first
-  // 'num_sampled_previously' elements. Here, take the remaining elements.
-  if (num_sampled_previously >= data_.size()) {
-    VLOG(1) << "No remaining RANSAC data to sample.";
-    return std::vector<Observation::Ptr>();
+    // Extract landmark position and append.
+    Landmark::Ptr landmark = observation->GetLandmark();
+    CHECK_NOTNULL(landmark.get());
+    points_3d_.push_back(landmark->Position());
   }
-
-  return std::vector<Observation::Ptr>(
-    data_.begin() + num_sampled_previously, data_.end());
 }
 
-// Fit a model to the provided data using PoseEstimatorPnP.
+// Fit a model to the provided data using the linear solution of
+// PoseEstimator2D3D.
 PnPRansacModel PnPRansacProblem::FitModel(
-    const std::vector<Observation::Ptr>& input_data) const {
+    const std::vector<int>& indices) const {
 
-  // Extract a FeatureList and a Point3DList from input_data.
+  // Gather features and landmark positions at the given indices.
   FeatureList points_2d;
   Point3DList points_3d;
-  points_2d.reserve(input_data.size());
-  points_3d.reserve(input_data.size());
-
-  for (const auto& observation : input_data) {
-    CHECK_NOTNULL(observation.get());
-
-    // Extract feature and append.
-    points_2d.push_back(observation->Feature());
-
-    // Extract landmark position and append.
-    Landmark::Ptr landmark = observation->GetLandmark();
-    CHECK_NOTNULL(landmark.get());
-    points_3d.push_back(landmark->Position());
+  points_2d.reserve(indices.size());
+  points_3d.reserve(indices.size());
+  for (const auto& index : indices) {
+    points_2d.push_back(points_2d_[index]);
+    points_3d.push_back(points_3d_[index]);
   }
 
   // Set up solver.
@@ -150,17 +129,104 @@ PnPRansacModel PnPRansacProblem::FitModel(
 
   // Solve.
   Pose calculated_pose;
-  if (!solver.Solve(calculated_pose)) {
+  if (!solver.SolveLinear(calculated_pose)) {
     VLOG(1) << "Could not estimate a pose using the PnP solver. "
 	    << "Assuming identity pose.";
   }
 
-  // Generate a model from this Pose.
+  // Generate a model from this Pose, and evaluate its reprojection error over
+  // the data it was fit to.
   CameraExtrinsics extrinsics(calculated_pose);
   Camera camera(extrinsics, intrinsics_);
 
-  PnPRansacModel model(camera, input_data);
+  PnPRansacModel model(camera,
+                       ReprojectionError(points_2d, points_3d, camera));
   return model;
 }
 
+size_t PnPRansacProblem::FindInliers(const PnPRansacModel& model,
+                                     double error_tolerance,
+                                     InlierMask& inliers) const {
+  inliers.resize(data_.size());
+  size_t num_inliers = 0;
+  for (size_t ii = 0; ii < data_.size(); ++ii) {
+    inliers[ii] = SquaredReprojectionError(model, ii) <= error_tolerance;
+    num_inliers += inliers[ii];
+  }
+  return num_inliers;
+}
+
+bool PnPRansacProblem::IsInlier(const PnPRansacModel& model,
+                                double error_tolerance, int index) const {
+  return SquaredReprojectionError(model, index) <= error_tolerance;
+}
+
+size_t PnPRansacProblem::CountInliers(const PnPRansacModel& model,
+                                      double error_tolerance,
+                                      const std::vector<int>& indices) const {
+  size_t num_inliers = 0;
+  for (const auto& index : indices)
+    num_inliers += IsInlier(model, error_tolerance, index);
+  return num_inliers;
+}
+
+void PnPRansacProblem::RefineBestModel(const std::vector<int>& indices,
+                                       double error_tolerance,
+                                       PnPRansacModel& model) const {
+  // Gather features and landmark positions of the inliers.
+  FeatureList points_2d;
+  Point3DList points_3d;
+  points_2d.reserve(indices.size());
+  points_3d.reserve(indices.size());
+  for (const auto& index : indices) {
+    points_2d.push_back(points_2d_[index]);
+    points_3d.push_back(points_3d_[index]);
+  }
+
+  // Optimize the pose, starting from the linear solution.
+  PoseEstimator2D3D solver;
+  solver.Initialize(points_2d, points_3d, intrinsics_);
+  Pose refined_pose = model.camera_.Extrinsics().WorldToCamera();
+  if (!solver.OptimizePose(refined_pose)) {
+    VLOG(1) << "Failed to optimize the best PnP RANSAC pose. Continuing "
+            << "using the linear solution.";
+    return;
+  }
+
+  CameraExtrinsics extrinsics(refined_pose);
+  Camera camera(extrinsics, intrinsics_);
+  PnPRansacModel refined_model(
+      camera, ReprojectionError(points_2d, points_3d, camera));
+
+  // The optimization minimizes the error over the given inliers, which can
+  // push other observations past the error tolerance.
+  InlierMask inliers;
+  if (FindInliers(refined_model, error_tolerance, inliers) <
+      FindInliers(model, error_tolerance, inliers)) {
+    VLOG(1) << "The optimized PnP RANSAC pose has fewer inliers. Continuing "
+            << "using the linear solution.";
+    return;
+  }
+
+  model = refined_model;
+}
+
+double PnPRansacProblem::SquaredReprojectionError(const PnPRansacModel& model,
+                                                  int index) const {
+  const Point3D& point = points_3d_[index];
+  const Vector3d point_camera =
+      model.world_to_camera_ *
+      Eigen::Vector4d(point.X(), point.Y(), point.Z(), 1.0);
+
+  // Project into the camera, exactly as Camera::WorldToImage() would.
+  double u = 0.0, v = 0.0;
+  if (!intrinsics_.CameraToImage(point_camera(0), point_camera(1),
+                                 point_camera(2), &u, &v))
+    return std::numeric_limits<double>::max();
+
+  const double du = u - points_2d_[index].u_;
+  const double dv = v - points_2d_[index].v_;
+  return du*du + dv*dv;
+}
+
 } //\namespace bsfm
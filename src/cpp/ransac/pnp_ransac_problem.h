@@ -68,9 +68,9 @@ struct PnPRansacModel : public RansacModel<Observation::Ptr> {
   PnPRansacModel();
   virtual ~PnPRansacModel();
 
-  // Define an additional constructor specifically for this model.
-  PnPRansacModel(const Camera& camera,
-		 const std::vector<Observation::Ptr>& matches);
+  // Define an additional constructor specifically for this model, with the
+  // mean reprojection error of the data it was fit to.
+  PnPRansacModel(const Camera& camera, double error);
 
   // Return model error.
   virtual double Error() const;
@@ -81,8 +81,11 @@ struct PnPRansacModel : public RansacModel<Observation::Ptr> {
 
   // Model-specific member variables.
   Camera camera_;
-  std::vector<Observation::Ptr> matches_;
   double error_;
+
+  // The world-to-camera transformation of 'camera_', cached so that scoring
+  // does not have to copy it out of the camera for every data point.
+  Matrix34d world_to_camera_;
 };  //\struct PnPRansacModel
 
 
@@ -97,19 +100,49 @@ class PnPRansacProblem
   // Set intrinsics.
   void SetIntrinsics(CameraIntrinsics& intrinsics);
 
-  // Subsample the data.
-  virtual std::vector<Observation::Ptr> SampleData(unsigned int num_samples);
+  // Set the data, and gather features and landmark positions from it.
+  virtual void SetData(const std::vector<Observation::Ptr>& data);
+
+  // The methods below are final, so that Ransac calls them without virtual
+  // dispatch when it is given this problem.
+
+  // Fit a model to the data at 'indices' with the linear solution of
+  // PoseEstimator2D3D. Hypotheses are not refined with non-linear optimization.
+  virtual PnPRansacModel FitModel(const std::vector<int>& indices) const final;
+
+  // Mark observations whose squared reprojection error under 'model' is at
+  // most 'error_tolerance'.
+  virtual size_t FindInliers(const PnPRansacModel& model,
+                             double error_tolerance,
+                             InlierMask& inliers) const final;
 
-  // Return the data that was not sampled.
-  virtual std::vector<Observation::Ptr> RemainingData(
-      unsigned int num_sampled_previously) const;
+  // Returns whether FindInliers() would mark the observation at 'index'.
+  virtual bool IsInlier(const PnPRansacModel& model, double error_tolerance,
+                        int index) const final;
 
-  // Fit a model to the provided data using PoseEstimatorPnP.
-  virtual PnPRansacModel FitModel(
-      const std::vector<Observation::Ptr>& input_data) const;
+  // Count the observations at 'indices' that FindInliers() would mark.
+  virtual size_t CountInliers(const PnPRansacModel& model,
+                              double error_tolerance,
+                              const std::vector<int>& indices) const final;
+
+  // Refine the pose of the best model by non-linear optimization over its
+  // inliers at 'indices'. The linear solution is kept if the refined pose has
+  // fewer inliers within 'error_tolerance'.
+  virtual void RefineBestModel(const std::vector<int>& indices,
+                               double error_tolerance,
+                               PnPRansacModel& model) const final;
 
  private:
+  // Squared reprojection error of the observation at 'index' under 'model'.
+  double SquaredReprojectionError(const PnPRansacModel& model,
+                                  int index) const;
+
   CameraIntrinsics intrinsics_;
+
+  // The feature and landmark position of each observation.
+  FeatureList points_2d_;
+  Point3DList points_3d_;
+
   DISALLOW_COPY_AND_ASSIGN(PnPRansacProblem)
 };  //\class PnPRansacProblem
 
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2015, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: Erik Nelson            ( eanelson@eecs.berkeley.edu )
+ *          David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// This class draws RANSAC samples with PROSAC (Chum and Matas, "Matching with
+// PROSAC - Progressive Sample Consensus", CVPR 2005).
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "prosac_sampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace bsfm {
+
+ProsacSampler::ProsacSampler(unsigned int num_samples, size_t num_data,
+                             const std::vector<int>& order,
+                             unsigned int max_num_samples,
+                             std::mt19937* engine)
+    : num_samples_(num_samples),
+      num_data_(num_data),
+      order_(order),
+      engine_(engine),
+      t_(0),
+      n_(num_samples),
+      T_n_(max_num_samples),
+      T_n_prime_(1) {
+  // T_n = T_N * prod_{i = 0}^{m - 1} (n - i) / (N - i), for n = m.
+  for (unsigned int ii = 0; ii < num_samples_ && ii < num_data_; ++ii)
+    T_n_ *= static_cast<double>(num_samples_ - ii) / (num_data_ - ii);
+}
+
+ProsacSampler::~ProsacSampler() {}
+
+void ProsacSampler::Sample(std::vector<int>& indices) {
+  indices.clear();
+
+  if (num_data_ <= num_samples_) {
+    for (size_t ii = 0; ii < num_data_; ++ii)
+      indices.push_back(order_.empty() ? ii : order_[ii]);
+    return;
+  }
+
+  // Grow the set of top ranked data points once uniform sampling would have
+  // drawn as many samples from it as PROSAC has.
+  ++t_;
+  if (t_ == T_n_prime_ && n_ < num_data_) {
+    const double T_n_next = T_n_ * (n_ + 1) / (n_ + 1 - num_samples_);
+    T_n_prime_ += static_cast<unsigned int>(std::ceil(T_n_next - T_n_));
+    T_n_ = T_n_next;
+    ++n_;
+  }
+
+  // Until the next time the set grows, each sample contains its lowest ranked
+  // point and m - 1 others from the rest of the set. After that, samples are
+  // drawn uniformly from the whole set.
+  if (T_n_prime_ >= t_) {
+    for (unsigned int ii = 0; ii + 1 < num_samples_; ++ii)
+      indices.push_back(DrawDistinct(n_ - 1, indices));
+    indices.push_back(n_ - 1);
+  } else {
+    for (unsigned int ii = 0; ii < num_samples_; ++ii)
+      indices.push_back(DrawDistinct(n_, indices));
+  }
+
+  // Map ranks to data indices.
+  if (!order_.empty()) {
+    for (size_t ii = 0; ii < indices.size(); ++ii)
+      indices[ii] = order_[indices[ii]];
+  }
+}
+
+int ProsacSampler::DrawDistinct(size_t bound,
+                                const std::vector<int>& indices) const {
+  // Samples are small, so rejection sampling is cheap.
+  while (true) {
+    const int index = engine_ == nullptr
+        ? std::rand() % bound
+        : std::uniform_int_distribution<size_t>(0, bound - 1)(*engine_);
+    if (std::find(indices.begin(), indices.end(), index) == indices.end())
+      return index;
+  }
+}
+
+}  //\namespace bsfm
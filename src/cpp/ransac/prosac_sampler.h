@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2015, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: Erik Nelson            ( eanelson@eecs.berkeley.edu )
+ *          David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// This class draws RANSAC samples with PROSAC (Chum and Matas, "Matching with
+// PROSAC - Progressive Sample Consensus", CVPR 2005). Data points are ranked by
+// quality, and samples are drawn from a set of the top ranked data points that
+// grows at the rate at which uniform sampling would have drawn each of its
+// subsets. Good models are therefore typically found after very few samples if
+// the ranking is good, while after enough samples PROSAC behaves exactly like
+// uniform sampling.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef BSFM_RANSAC_PROSAC_SAMPLER_H
+#define BSFM_RANSAC_PROSAC_SAMPLER_H
+
+#include <random>
+#include <stddef.h>
+#include <vector>
+
+#include "../util/disallow_copy_and_assign.h"
+
+namespace bsfm {
+
+class ProsacSampler {
+ public:
+  // Sample 'num_samples' of 'num_data' data points. 'order' lists data indices
+  // from highest to lowest quality. If it is empty, data indices are assumed to
+  // already be sorted by quality. After 'max_num_samples' samples, all data
+  // points are sampled uniformly. Random numbers are drawn from 'engine', or
+  // from std::rand() if it is null.
+  ProsacSampler(unsigned int num_samples, size_t num_data,
+                const std::vector<int>& order,
+                unsigned int max_num_samples = 200000,
+                std::mt19937* engine = nullptr);
+  ~ProsacSampler();
+
+  // Draw the next sample of distinct data indices, or all of them if there are
+  // fewer data points than 'num_samples'. Indices are stored in 'indices'.
+  void Sample(std::vector<int>& indices);
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ProsacSampler)
+
+  // Draw a random position in [0, 'bound') that is not yet in 'indices'.
+  int DrawDistinct(size_t bound, const std::vector<int>& indices) const;
+
+  const unsigned int num_samples_;
+  const size_t num_data_;
+  const std::vector<int>& order_;
+  std::mt19937* engine_;
+
+  // Number of samples drawn so far.
+  unsigned int t_;
+
+  // Size of the set of top ranked data points that samples are drawn from.
+  size_t n_;
+
+  // Expected number of samples, out of 'max_num_samples', containing only
+  // points from the top n_ (T_n in the paper), and the number of samples after
+  // which the set grows (T'_n in the paper).
+  double T_n_;
+  unsigned int T_n_prime_;
+};  //\class ProsacSampler
+
+}  //\namespace bsfm
+
+#endif
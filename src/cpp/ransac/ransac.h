@@ -40,20 +40,80 @@
 // This class defines a generic RANSAC solver. The user may define a
 // RansacProblem derived class, and plug it in here.
 //
+// The solver is instantiated for the static type of the problem it is given,
+// so calls to methods that the problem declares 'final' (or that it hides) are
+// bound at compile time and can be inlined into the RANSAC loops. Passing the
+// problem as a RansacProblem reference runs the same code with virtual calls.
+//
 ///////////////////////////////////////////////////////////////////////////////
 
 
 #ifndef BSFM_RANSAC_RANSAC_H
 #define BSFM_RANSAC_RANSAC_H
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <limits>
+#include <random>
+#include <thread>
+#include <type_traits>
+#include <vector>
 #include <glog/logging.h>
 
+#include "prosac_sampler.h"
 #include "ransac_options.h"
 #include "ransac_problem.h"
+#include "sequential_probability_ratio_test.h"
 
 namespace bsfm {
 
+// Returns the number of RANSAC iterations needed to draw at least one sample of
+// 'num_samples' inliers with probability 'confidence', when a fraction
+// 'inlier_ratio' of all data points are inliers. If models fit to inliers are
+// only accepted with probability 'acceptance_probability' (e.g. by the
+// sequential probability ratio test), more iterations are needed.
+inline unsigned int RequiredRansacIterations(
+    double inlier_ratio, unsigned int num_samples, double confidence,
+    double acceptance_probability = 1.0) {
+  const double p_all_inliers =
+      std::pow(inlier_ratio, num_samples) * acceptance_probability;
+  if (p_all_inliers >= 1.0)
+    return 1;
+
+  const double iterations =
+      std::ceil(std::log(1.0 - confidence) / std::log1p(-p_all_inliers));
+  if (!(iterations < std::numeric_limits<unsigned int>::max()))
+    return std::numeric_limits<unsigned int>::max();
+  return std::max(1u, static_cast<unsigned int>(iterations));
+}
+
+// Draw 'num_samples' distinct entries of 'permutation' uniformly at random
+// using 'engine', by partially shuffling it. Entries are stored in 'indices'.
+inline void SampleUniformly(unsigned int num_samples, std::mt19937& engine,
+                            std::vector<int>& permutation,
+                            std::vector<int>& indices) {
+  const size_t num_data = permutation.size();
+  num_samples = std::min(static_cast<size_t>(num_samples), num_data);
+
+  indices.resize(num_samples);
+  for (size_t ii = 0; ii < num_samples; ++ii) {
+    std::uniform_int_distribution<size_t> distribution(ii, num_data - 1);
+    std::swap(permutation[ii], permutation[distribution(engine)]);
+    indices[ii] = permutation[ii];
+  }
+}
+
+// Store the indices of the data points marked in 'inliers' in 'indices'.
+inline void InlierIndices(const InlierMask& inliers,
+                          std::vector<int>& indices) {
+  indices.clear();
+  for (size_t ii = 0; ii < inliers.size(); ++ii) {
+    if (inliers[ii])
+      indices.push_back(ii);
+  }
+}
+
 template <typename DataType, typename ModelType>
 class Ransac {
  public:
@@ -65,11 +125,76 @@ class Ransac {
 
   // Run RANSAC using the user's input data (stored in 'problem'). Save the best
   // model that RANSAC finds after options_.iterations iterations in the
-  // problem. This returns false if RANSAC does not find any solution.
-  inline bool Run(RansacProblem<DataType, ModelType>& problem) const;
+  // problem, or fewer if 'options_.adaptive_iterations' is set. This returns
+  // false if RANSAC does not find any solution. 'Problem' must derive from
+  // RansacProblem<DataType, ModelType>.
+  template <typename Problem>
+  inline bool Run(Problem& problem) const;
+
+  // Same as above, but stop once 'deadline' has passed, and keep the best model
+  // found by then. 'options_.time_limit' is ignored.
+  template <typename Problem>
+  inline bool Run(Problem& problem,
+                  const std::chrono::steady_clock::time_point& deadline) const;
 
  private:
-      RansacOptions options_;
+  // The best model found by one thread of RANSAC iterations.
+  struct Result {
+    ModelType model_;
+    InlierMask inliers_;
+    double error_ = std::numeric_limits<double>::max();
+    bool solution_found_ = false;
+    unsigned int iterations_ = 0;
+  };
+
+  // Run up to 'max_iterations' iterations of RANSAC, drawing samples by calling
+  // 'sample'. With adaptive iterations, this thread only runs its share of the
+  // iterations needed, out of 'num_threads' threads. With the sequential
+  // probability ratio test, data points are verified in 'verification_order'.
+  // Local optimization draws random numbers from 'engine'. The best model is
+  // stored in 'result'.
+  template <typename Problem, typename Sampler>
+  inline void RunIterations(
+      const Problem& problem, Sampler& sample, std::mt19937& engine,
+      unsigned int max_iterations, unsigned int num_threads,
+      const std::vector<int>& verification_order,
+      const std::chrono::steady_clock::time_point& deadline,
+      Result& result) const;
+
+  // Check 'model' against the data points in 'order' one at a time with
+  // 'sprt', marking inliers in 'inliers' and counting them in 'num_inliers'.
+  // Returns false if the test rejects the model before checking all of them.
+  template <typename Problem>
+  inline bool VerifyModel(const Problem& problem, const ModelType& model,
+                          const std::vector<int>& order,
+                          SequentialProbabilityRatioTest& sprt,
+                          InlierMask& inliers, size_t& num_inliers) const;
+
+  // Generate all hypotheses, and then score them on growing blocks of data,
+  // discarding the worse half after each block (see 'options_.preemptive').
+  template <typename Problem>
+  inline void RunPreemptive(
+      Problem& problem, const std::chrono::steady_clock::time_point& deadline,
+      Result& result) const;
+
+  // Locally optimize the model whose 'num_inliers' inliers are marked in
+  // 'inliers' (see 'options_.use_local_optimization'). 'inliers' is replaced by
+  // the inliers of the best locally optimized model if it has more, and their
+  // number is returned.
+  template <typename Problem>
+  inline size_t LocallyOptimize(const Problem& problem, std::mt19937& engine,
+                                size_t num_inliers, InlierMask& inliers) const;
+
+  // Refit a model to the data points marked in 'inliers', and keep the inliers
+  // that are still a good fit under it. The refit model is stored in 'result'
+  // if it has the lowest error so far. 'inlier_indices' and 'refined_inliers'
+  // are buffers reused between calls.
+  template <typename Problem>
+  inline void RefineModel(const Problem& problem, const InlierMask& inliers,
+                          std::vector<int>& inlier_indices,
+                          InlierMask& refined_inliers, Result& result) const;
+
+  RansacOptions options_;
 };  //\class Ransac
 
 // -------------------- Implementation -------------------- //
@@ -80,72 +205,381 @@ void Ransac<DataType, ModelType>::SetOptions(const RansacOptions& options) {
 }
 
 template <typename DataType, typename ModelType>
+template <typename Problem>
+bool Ransac<DataType, ModelType>::Run(Problem& problem) const {
+  std::chrono::steady_clock::time_point deadline =
+      std::chrono::steady_clock::time_point::max();
+  if (options_.time_limit > 0.0) {
+    deadline = std::chrono::steady_clock::now() +
+               std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                   std::chrono::duration<double>(options_.time_limit));
+  }
+  return Run(problem, deadline);
+}
+
+template <typename DataType, typename ModelType>
+template <typename Problem>
 bool Ransac<DataType, ModelType>::Run(
-    RansacProblem<DataType, ModelType>& problem) const {
+    Problem& problem,
+    const std::chrono::steady_clock::time_point& deadline) const {
+  static_assert(
+      std::is_base_of<RansacProblem<DataType, ModelType>, Problem>::value,
+      "RANSAC problems must derive from RansacProblem.");
+
   // By default, a valid model has not been found.
   problem.SetSolutionFound(false);
 
-  // Set the initial error to something very large.
-  double best_error = std::numeric_limits<double>::max();
+  const size_t num_data = problem.NumData();
+  unsigned int num_threads = options_.num_threads;
+  if (num_threads == 0)
+    num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  num_threads = std::max(1u, std::min(num_threads, options_.iterations));
+  if (options_.preemptive)
+    num_threads = 1;
+
+  // With the sequential probability ratio test, every thread verifies models
+  // against the data in the same random order.
+  std::vector<int> verification_order;
+  if (options_.use_sprt && !options_.preemptive) {
+    std::mt19937 engine(options_.seed);
+    std::vector<int> permutation(num_data);
+    for (size_t ii = 0; ii < num_data; ++ii)
+      permutation[ii] = ii;
+    SampleUniformly(num_data, engine, permutation, verification_order);
+  }
+
+  std::vector<Result> results(num_threads);
+  if (options_.preemptive) {
+    RunPreemptive(problem, deadline, results[0]);
+  } else {
+    // Each thread draws samples from its own random number stream, seeded by
+    // its index, so results only depend on the seed and the number of threads.
+    // With PROSAC, samples are drawn from the highest quality data points
+    // first.
+    auto run_thread = [&](unsigned int thread) {
+      std::seed_seq seed{options_.seed, thread};
+      std::mt19937 engine(seed);
+
+      ProsacSampler prosac_sampler(options_.num_samples, num_data,
+                                   problem.QualityOrder(),
+                                   options_.prosac_max_iterations, &engine);
+      std::vector<int> permutation(num_data);
+      for (size_t ii = 0; ii < num_data; ++ii)
+        permutation[ii] = ii;
+      auto sample = [&](std::vector<int>& indices) {
+        if (options_.use_prosac)
+          prosac_sampler.Sample(indices);
+        else
+          SampleUniformly(options_.num_samples, engine, permutation, indices);
+      };
+
+      const unsigned int max_iterations =
+          options_.iterations / num_threads +
+          (thread < options_.iterations % num_threads);
+      RunIterations(problem, sample, engine, max_iterations, num_threads,
+                    verification_order, deadline, results[thread]);
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads - 1);
+    for (unsigned int ii = 1; ii < num_threads; ++ii)
+      threads.emplace_back(run_thread, ii);
+    run_thread(0);
+    for (auto& thread : threads)
+      thread.join();
+  }
+
+  // Keep the best model over all threads. Ties go to the lowest thread index,
+  // so that the result does not depend on scheduling.
+  const Result* best = nullptr;
+  unsigned int iterations = 0;
+  for (const auto& result : results) {
+    iterations += result.iterations_;
+    if (result.solution_found_ &&
+        (best == nullptr || result.error_ < best->error_))
+      best = &result;
+  }
+
+  // See if RANSAC found a solution.
+  if (best == nullptr) {
+    VLOG(1) << "RANSAC failed to find a solution in " << iterations
+            << " iterations.";
+    return false;
+  }
+
+  // Refine the best model once, with the problem's most expensive fitting.
+  // Refinement can move data points across the error tolerance, so inliers are
+  // found again under the refined model.
+  ModelType model = best->model_;
+  std::vector<int> inlier_indices;
+  InlierIndices(best->inliers_, inlier_indices);
+  problem.RefineBestModel(inlier_indices, options_.acceptable_error, model);
+
+  InlierMask inliers;
+  problem.FindInliers(model, options_.acceptable_error, inliers);
+  problem.SetModel(model);
+  problem.SetInliers(inliers);
+  problem.SetSolutionFound(true);
+
+  return true;
+}
+
+template <typename DataType, typename ModelType>
+template <typename Problem, typename Sampler>
+void Ransac<DataType, ModelType>::RunIterations(
+    const Problem& problem, Sampler& sample, std::mt19937& engine,
+    unsigned int max_iterations, unsigned int num_threads,
+    const std::vector<int>& verification_order,
+    const std::chrono::steady_clock::time_point& deadline,
+    Result& result) const {
+  SequentialProbabilityRatioTest sprt(
+      options_.sprt_epsilon, options_.sprt_delta, options_.sprt_fit_cost);
+
+  // Buffers reused across iterations. Data points are referred to by index,
+  // and inlier sets are masks over the data, so iterations do not copy data.
+  const size_t num_data = problem.NumData();
+  std::vector<int> indices;
+  std::vector<int> inlier_indices;
+  inlier_indices.reserve(num_data);
+  InlierMask inliers, refined_inliers;
+
+  // Proceed for 'max_iterations' iterations of RANSAC. With adaptive
+  // iterations, this bound shrinks as models with more inliers are found.
+  const unsigned int iterations_cap = max_iterations;
+  size_t max_num_inliers = 0;
+  size_t best_num_inliers = 0;
+  unsigned int iter = 0;
+  for (; iter < max_iterations; ++iter) {
+    // Stop at the deadline with the best model found so far.
+    if (iter > 0 && std::chrono::steady_clock::now() >= deadline)
+      break;
 
-  // Proceed for options_.iterations iterations of RANSAC.
-  for (unsigned int iter = 0; iter < options_.iterations; ++iter) {
     // Sample data points.
-    std::vector<DataType> sampled = problem.SampleData(options_.num_samples);
+    sample(indices);
 
     // Fit a model to the sampled data points.
-    ModelType initial_model = problem.FitModel(sampled);
+    ModelType initial_model = problem.FitModel(indices);
 
-    // Get an initial set of inliers from the sampled points.
-    std::vector<DataType> inliers;
-    for (const auto& data_point : sampled) {
-      if (initial_model.IsGoodFit(data_point, options_.acceptable_error)) {
-        inliers.push_back(data_point);
-      }
+    // Find all data points that are inliers under this model. The sequential
+    // probability ratio test gives up early on models that are likely bad.
+    size_t num_inliers = 0;
+    if (options_.use_sprt) {
+      if (!VerifyModel(problem, initial_model, verification_order, sprt,
+                       inliers, num_inliers))
+        continue;
+    } else {
+      num_inliers = problem.FindInliers(initial_model,
+                                        options_.acceptable_error, inliers);
     }
 
-    // Which of the remaining points are also inliers under this model?
-    std::vector<DataType> unsampled = problem.RemainingData(options_.num_samples);
-    for (const auto& not_sampled_data_point : unsampled) {
-      if (initial_model.IsGoodFit(not_sampled_data_point,
-                                  options_.acceptable_error)) {
-        inliers.push_back(not_sampled_data_point);
-      }
+    // With local optimization, only models with more inliers than any before
+    // them are optimized, and only those can be accepted.
+    if (options_.use_local_optimization) {
+      if (num_inliers <= best_num_inliers || num_inliers < indices.size())
+        continue;
+      num_inliers = LocallyOptimize(problem, engine, num_inliers, inliers);
+      best_num_inliers = num_inliers;
     }
 
     // Check if we have enough inliers to consider this a good model.
-    if (inliers.size() >= options_.minimum_num_inliers) {
+    if (num_inliers >= options_.minimum_num_inliers) {
 
-      // Test how good this model is.
-      ModelType better_model = problem.FitModel(inliers);
-
-      // Only keep the inliers that are still a good fit under the new model.
-      std::vector<DataType> refined_inliers;
-      for (const auto& inlier : inliers)
-        if (better_model.IsGoodFit(inlier, options_.acceptable_error))
-          refined_inliers.push_back(inlier);
-
-      // Is this the best model yet?
-      const double this_error = better_model.Error();
-      if (this_error < best_error && !refined_inliers.empty()) {
-        best_error = this_error;
-        problem.SetModel(better_model);
-        problem.SetInliers(refined_inliers);
-        problem.SetSolutionFound(true);
+      // Update the number of iterations needed from the largest fraction of
+      // inliers seen so far. Each thread runs its share of them.
+      if (options_.adaptive_iterations && num_inliers > max_num_inliers) {
+        max_num_inliers = num_inliers;
+        const double inlier_ratio =
+            static_cast<double>(max_num_inliers) / num_data;
+        const double acceptance_probability =
+            options_.use_sprt ? sprt.AcceptanceProbability() : 1.0;
+        const unsigned int required_iterations = std::max(
+            options_.min_iterations,
+            RequiredRansacIterations(inlier_ratio, indices.size(),
+                                     options_.confidence,
+                                     acceptance_probability));
+        max_iterations = std::min(
+            iterations_cap,
+            required_iterations / num_threads +
+                (required_iterations % num_threads != 0));
       }
+
+      // Test how good this model is.
+      RefineModel(problem, inliers, inlier_indices, refined_inliers, result);
     }
   }
+  result.iterations_ = iter;
+}
 
-  // See if RANSAC found a solution.
-  if (!problem.SolutionFound()) {
-    VLOG(1) << "RANSAC failed to find a solution in " << options_.iterations
-            << " iterations.";
-    return false;
+template <typename DataType, typename ModelType>
+template <typename Problem>
+bool Ransac<DataType, ModelType>::VerifyModel(
+    const Problem& problem, const ModelType& model,
+    const std::vector<int>& order, SequentialProbabilityRatioTest& sprt,
+    InlierMask& inliers, size_t& num_inliers) const {
+  inliers.assign(order.size(), 0);
+  num_inliers = 0;
+
+  sprt.Start();
+  for (size_t ii = 0; ii < order.size(); ++ii) {
+    const bool inlier =
+        problem.IsInlier(model, options_.acceptable_error, order[ii]);
+    inliers[order[ii]] = inlier;
+    num_inliers += inlier;
+    if (!sprt.Update(inlier)) {
+      sprt.Reject(num_inliers, ii + 1);
+      return false;
+    }
   }
 
+  sprt.Accept(static_cast<double>(num_inliers) / order.size());
   return true;
 }
 
+template <typename DataType, typename ModelType>
+template <typename Problem>
+void Ransac<DataType, ModelType>::RunPreemptive(
+    Problem& problem, const std::chrono::steady_clock::time_point& deadline,
+    Result& result) const {
+  const size_t num_data = problem.NumData();
+
+  // Generate all hypotheses up front, or as many as fit before the deadline.
+  // Random numbers come from the same stream as the first thread's in Run().
+  std::seed_seq seed{options_.seed, 0u};
+  std::mt19937 engine(seed);
+  std::vector<int> permutation(num_data);
+  for (size_t ii = 0; ii < num_data; ++ii)
+    permutation[ii] = ii;
+  ProsacSampler prosac_sampler(options_.num_samples, num_data,
+                               problem.QualityOrder(),
+                               options_.prosac_max_iterations, &engine);
+  std::vector<ModelType> hypotheses;
+  hypotheses.reserve(options_.iterations);
+  std::vector<int> indices;
+  while (hypotheses.size() < std::max(1u, options_.iterations)) {
+    if (!hypotheses.empty() && std::chrono::steady_clock::now() >= deadline)
+      break;
+
+    if (options_.use_prosac)
+      prosac_sampler.Sample(indices);
+    else
+      SampleUniformly(options_.num_samples, engine, permutation, indices);
+    hypotheses.push_back(problem.FitModel(indices));
+  }
+  result.iterations_ = hypotheses.size();
+
+  // Score the remaining hypotheses on one block of data points at a time, in
+  // random order, and discard the worse half after each block. Remaining
+  // hypotheses are kept sorted by score, with ties going to the earlier one.
+  std::vector<int> order;
+  SampleUniformly(num_data, engine, permutation, order);
+
+  std::vector<size_t> scores(hypotheses.size(), 0);
+  std::vector<int> remaining(hypotheses.size());
+  for (size_t ii = 0; ii < remaining.size(); ++ii)
+    remaining[ii] = ii;
+
+  const size_t block_size = std::max(1u, options_.preemption_block_size);
+  std::vector<int> block;
+  for (size_t first = 0; first < num_data && remaining.size() > 1;
+       first += block_size) {
+    if (std::chrono::steady_clock::now() >= deadline)
+      break;
+
+    block.assign(order.begin() + first,
+                 order.begin() + std::min(first + block_size, num_data));
+    for (const auto& hypothesis : remaining) {
+      scores[hypothesis] += problem.CountInliers(
+          hypotheses[hypothesis], options_.acceptable_error, block);
+    }
+
+    std::stable_sort(remaining.begin(), remaining.end(),
+                     [&scores](int lhs, int rhs) {
+                       return scores[lhs] > scores[rhs];
+                     });
+    remaining.resize((remaining.size() + 1) / 2);
+  }
+
+  // Refit the best hypothesis to its inliers among all of the data.
+  std::vector<int> inlier_indices;
+  InlierMask inliers, refined_inliers;
+  const size_t num_inliers = problem.FindInliers(
+      hypotheses[remaining.front()], options_.acceptable_error, inliers);
+  if (num_inliers >= options_.minimum_num_inliers)
+    RefineModel(problem, inliers, inlier_indices, refined_inliers, result);
+}
+
+template <typename DataType, typename ModelType>
+template <typename Problem>
+size_t Ransac<DataType, ModelType>::LocallyOptimize(
+    const Problem& problem, std::mt19937& engine, size_t num_inliers,
+    InlierMask& inliers) const {
+  std::vector<int> inlier_indices, sample;
+  InlierMask candidate_inliers;
+
+  for (unsigned int ii = 0; ii < options_.lo_inner_iterations; ++ii) {
+    // Fit a model to a random subset of the best inliers so far.
+    InlierIndices(inliers, inlier_indices);
+    SampleUniformly(options_.lo_sample_size, engine, inlier_indices, sample);
+    ModelType model = problem.FitModel(sample);
+
+    // Refit the model to its inliers under a shrinking threshold.
+    for (unsigned int jj = 0; jj < options_.lo_iterations; ++jj) {
+      const double multiplier =
+          options_.lo_iterations > 1
+              ? options_.lo_threshold_multiplier -
+                    (options_.lo_threshold_multiplier - 1.0) * jj /
+                        (options_.lo_iterations - 1)
+              : 1.0;
+      problem.FindInliers(model, multiplier * options_.acceptable_error,
+                          candidate_inliers);
+      InlierIndices(candidate_inliers, inlier_indices);
+      if (inlier_indices.size() < options_.num_samples)
+        break;
+      SampleUniformly(options_.lo_sample_size, engine, inlier_indices, sample);
+      model = problem.FitModel(sample);
+    }
+
+    // Keep the inliers of the model if it has more than any so far.
+    const size_t num_candidate_inliers = problem.FindInliers(
+        model, options_.acceptable_error, candidate_inliers);
+    if (num_candidate_inliers > num_inliers) {
+      num_inliers = num_candidate_inliers;
+      inliers.swap(candidate_inliers);
+    }
+  }
+
+  return num_inliers;
+}
+
+template <typename DataType, typename ModelType>
+template <typename Problem>
+void Ransac<DataType, ModelType>::RefineModel(
+    const Problem& problem, const InlierMask& inliers,
+    std::vector<int>& inlier_indices, InlierMask& refined_inliers,
+    Result& result) const {
+  const size_t num_data = problem.NumData();
+  InlierIndices(inliers, inlier_indices);
+  ModelType better_model = problem.FitModel(inlier_indices);
+
+  // Only keep the inliers that are still a good fit under the new model.
+  problem.FindInliers(better_model, options_.acceptable_error,
+                      refined_inliers);
+  size_t num_refined_inliers = 0;
+  for (size_t ii = 0; ii < num_data; ++ii) {
+    refined_inliers[ii] &= inliers[ii];
+    num_refined_inliers += refined_inliers[ii];
+  }
+
+  // Is this the best model yet?
+  const double this_error = better_model.Error();
+  if (this_error < result.error_ && num_refined_inliers > 0) {
+    result.error_ = this_error;
+    result.model_ = better_model;
+    result.inliers_.swap(refined_inliers);
+    result.solution_found_ = true;
+  }
+}
+
 }  //\namespace bsfm
 
 #endif
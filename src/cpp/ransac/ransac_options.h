@@ -51,9 +51,79 @@ namespace bsfm {
 
 struct RansacOptions {
 
-  // Number of iterations to run RANSAC for.
+  // Number of iterations to run RANSAC for. If 'adaptive_iterations' is true,
+  // this is the maximum number of iterations.
   unsigned int iterations = 100;
 
+  // Stop early once enough iterations have run to have drawn at least one
+  // sample of only inliers with probability 'confidence'. The fraction of
+  // inliers is estimated from the best model found so far, and the number of
+  // iterations needed is updated whenever it improves. At least
+  // 'min_iterations' iterations are always run.
+  bool adaptive_iterations = false;
+  double confidence = 0.99;
+  unsigned int min_iterations = 1;
+
+  // Draw samples with PROSAC instead of uniformly at random. PROSAC draws from
+  // a progressively growing set of the highest quality data points (see
+  // RansacProblem::SetQuality()), falling back to uniform sampling once it has
+  // grown to include all of the data. If no quality is set, the data is assumed
+  // to already be sorted from best to worst. 'prosac_max_iterations' is the
+  // number of samples after which PROSAC behaves like uniform sampling.
+  bool use_prosac = false;
+  unsigned int prosac_max_iterations = 200000;
+
+  // The number of threads that generate and score hypotheses concurrently. If
+  // this is 0, one thread is used per hardware core. Iterations are split
+  // evenly between threads, and each thread samples from its own random number
+  // generator, seeded from 'seed' and the thread's index. Results are then
+  // reproducible for a given seed and number of threads.
+  unsigned int num_threads = 1;
+  unsigned int seed = 0;
+
+  // Score hypotheses preemptively (Nister, "Preemptive RANSAC for Live
+  // Structure and Motion Estimation", ICCV 2003). 'iterations' hypotheses are
+  // generated up front, then scored on successive blocks of
+  // 'preemption_block_size' data points taken in random order. After each
+  // block, the worse half of the remaining hypotheses is discarded. The last
+  // one standing is refit to its inliers. The cost of scoring is then bounded
+  // by roughly twice the cost of scoring every hypothesis on one block.
+  // 'adaptive_iterations' and 'num_threads' are not used in this mode.
+  bool preemptive = false;
+  unsigned int preemption_block_size = 100;
+
+  // Verify hypotheses with Wald's sequential probability ratio test (Matas and
+  // Chum, "Randomized RANSAC with Sequential Probability Ratio Test", ICCV
+  // 2005). Data points are checked in random order, and a hypothesis is
+  // rejected as soon as it is likely to be bad, usually after a few data
+  // points. 'sprt_epsilon' and 'sprt_delta' are initial estimates of the
+  // fraction of data points consistent with a good and a bad model. Both are
+  // re-estimated as RANSAC runs. 'sprt_fit_cost' is the time it takes to fit a
+  // model, relative to checking one data point. Not used in preemptive mode.
+  bool use_sprt = false;
+  double sprt_epsilon = 0.1;
+  double sprt_delta = 0.01;
+  double sprt_fit_cost = 200.0;
+
+  // Locally optimize models that have more inliers than any model before them
+  // (Chum et al., "Locally Optimized RANSAC", DAGM 2003, with the iterative
+  // scheme of Lebeda et al., "Fixing the Locally Optimized RANSAC", BMVC 2012).
+  // The model is refit 'lo_inner_iterations' times to random subsets of at
+  // most 'lo_sample_size' of the best inliers found so far. Each refit model is
+  // then refit 'lo_iterations' times to its inliers under a threshold that
+  // shrinks from 'lo_threshold_multiplier' times 'acceptable_error' down to
+  // 'acceptable_error'. Other models are not refit at all, so the full refit
+  // only runs when the best model improves. Not used in preemptive mode.
+  bool use_local_optimization = false;
+  unsigned int lo_inner_iterations = 10;
+  unsigned int lo_iterations = 4;
+  unsigned int lo_sample_size = 50;
+  double lo_threshold_multiplier = 4.0;
+
+  // If greater than zero, RANSAC stops after this many seconds, and keeps the
+  // best model found by then. At least one hypothesis is always generated.
+  double time_limit = 0.0;
+
   // In order to be considered an inlier, a data point must fit the RANSAC model
   // to at least this error. This value is extremely arbitrary - tweak it for
   // the specific problem!
@@ -40,7 +40,9 @@
 // This class defines an abstract base class for RANSAC problems.
 // Structs/classes deriving from the RansacProblem and RansacModel interfaces
 // will provide the specific details and model type that the the specific RANSAC
-// problem will use.
+// problem will use. Ransac is instantiated for the derived problem type, so
+// derived classes can declare their methods final to have them called without
+// virtual dispatch.
 //
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -48,12 +50,18 @@
 #ifndef BSFM_RANSAC_RANSAC_PROBLEM_H
 #define BSFM_RANSAC_RANSAC_PROBLEM_H
 
+#include <algorithm>
+#include <cstdlib>
 #include <vector>
+#include <glog/logging.h>
 
 #include "../util/disallow_copy_and_assign.h"
 
 namespace bsfm {
 
+// One entry per data point, set to 1 for inliers and 0 for outliers.
+typedef std::vector<unsigned char> InlierMask;
+
 // Derive from this struct when defining a specific RANSAC problem!
 template <typename DataType>
 struct RansacModel {
@@ -66,7 +74,10 @@ struct RansacModel {
                          double error_tolerance) const = 0;
 };  //\struct RansacModel
 
-// Derive from this class when defining a specific RANSAC problem!
+// Derive from this class when defining a specific RANSAC problem! RANSAC
+// refers to data points by their index in the data, so derived classes should
+// gather whatever they need from the data into contiguous arrays once, in
+// SetData(), rather than on every iteration.
 template <typename DataType, typename ModelType>
 class RansacProblem {
  public:
@@ -79,16 +90,59 @@ class RansacProblem {
   virtual inline void SetInliers(
       const std::vector<DataType>& inliers);
 
+  // Set the inliers to the data points marked in 'inliers'.
+  virtual inline void SetInliers(const InlierMask& inliers);
+
   virtual inline void SetSolutionFound(bool solution_found);
   virtual inline bool SolutionFound();
   virtual inline const ModelType& Model() const;
   virtual inline const std::vector<DataType>& Inliers() const;
 
+  // Returns the number of data points.
+  inline size_t NumData() const;
+
+  // Set a quality score for each data point, where higher is better (e.g. the
+  // negated descriptor distance of a match). Must be called after SetData().
+  virtual inline void SetQuality(const std::vector<double>& quality);
+
+  // Returns data indices sorted from highest to lowest quality. Empty if no
+  // quality has been set since the last call to SetData().
+  inline const std::vector<int>& QualityOrder() const;
+
+  // Draw 'num_samples' distinct data indices uniformly at random, or all of
+  // them if there are fewer data points. Indices are stored in 'indices'.
+  virtual inline void SampleIndices(unsigned int num_samples,
+                                    std::vector<int>& indices);
+
   // ----- Define these remaining methods in a derived class! ----- //
-  virtual std::vector<DataType> SampleData(unsigned int num_samples) = 0;
-  virtual std::vector<DataType> RemainingData(
-      unsigned int num_sampled_previously) const = 0;
-  virtual ModelType FitModel(const std::vector<DataType>& input_data) const = 0;
+  // Fit a model to the data points at 'indices'.
+  virtual ModelType FitModel(const std::vector<int>& indices) const = 0;
+
+  // Mark the data points that 'model' fits to within 'error_tolerance' in
+  // 'inliers', which is resized to NumData(). Returns the number of inliers.
+  virtual size_t FindInliers(const ModelType& model, double error_tolerance,
+                             InlierMask& inliers) const = 0;
+
+  // Returns whether 'model' fits the data point at 'index' to within
+  // 'error_tolerance'. This is used to verify hypotheses one data point at a
+  // time. By default, it calls RansacModel::IsGoodFit().
+  virtual inline bool IsInlier(const ModelType& model, double error_tolerance,
+                               int index) const;
+
+  // Returns the number of data points at 'indices' that 'model' fits to within
+  // 'error_tolerance'. This is used to score hypotheses on blocks of data. By
+  // default, it tests each data point with IsInlier().
+  virtual inline size_t CountInliers(const ModelType& model,
+                                     double error_tolerance,
+                                     const std::vector<int>& indices) const;
+
+  // Refine 'model', the best model that RANSAC found, using its inliers at
+  // 'indices' within 'error_tolerance'. This runs once per call to
+  // Ransac::Run(), so it is the place for refinement that is too expensive to
+  // run on every hypothesis. By default, the model is left as it is.
+  virtual inline void RefineBestModel(const std::vector<int>& indices,
+                                      double error_tolerance,
+                                      ModelType& model) const;
 
  protected:
   std::vector<DataType> data_;
@@ -98,6 +152,13 @@ class RansacProblem {
 
  private:
   DISALLOW_COPY_AND_ASSIGN(RansacProblem)
+
+  // A permutation of all data indices. Samples are drawn by partially
+  // shuffling it, so that sampling does not allocate.
+  std::vector<int> permutation_;
+
+  // Data indices sorted by decreasing quality.
+  std::vector<int> quality_order_;
 };  //\class RansacProblem
 
 // -------------------- Implementation -------------------- //
@@ -115,6 +176,10 @@ template <typename DataType, typename ModelType>
 void RansacProblem<DataType, ModelType>::SetData(
     const std::vector<DataType>& data) {
   data_ = data;
+  permutation_.resize(data_.size());
+  for (size_t ii = 0; ii < permutation_.size(); ++ii)
+    permutation_[ii] = ii;
+  quality_order_.clear();
 }
 
 template <typename DataType, typename ModelType>
@@ -123,6 +188,16 @@ void RansacProblem<DataType, ModelType>::SetInliers(
   inliers_ = inliers;
 }
 
+template <typename DataType, typename ModelType>
+void RansacProblem<DataType, ModelType>::SetInliers(
+    const InlierMask& inliers) {
+  inliers_.clear();
+  for (size_t ii = 0; ii < inliers.size() && ii < data_.size(); ++ii) {
+    if (inliers[ii])
+      inliers_.push_back(data_[ii]);
+  }
+}
+
 template <typename DataType, typename ModelType>
 void RansacProblem<DataType, ModelType>::SetSolutionFound(bool solution_found) {
   solution_found_ = solution_found;
@@ -144,6 +219,70 @@ const std::vector<DataType>& RansacProblem<DataType, ModelType>::Inliers()
   return inliers_;
 }
 
+template <typename DataType, typename ModelType>
+size_t RansacProblem<DataType, ModelType>::NumData() const {
+  return data_.size();
+}
+
+template <typename DataType, typename ModelType>
+void RansacProblem<DataType, ModelType>::SetQuality(
+    const std::vector<double>& quality) {
+  CHECK_EQ(data_.size(), quality.size());
+  quality_order_.resize(quality.size());
+  for (size_t ii = 0; ii < quality_order_.size(); ++ii)
+    quality_order_[ii] = ii;
+
+  // Keep the data order among data points of equal quality.
+  std::stable_sort(quality_order_.begin(), quality_order_.end(),
+                   [&quality](int lhs, int rhs) {
+                     return quality[lhs] > quality[rhs];
+                   });
+}
+
+template <typename DataType, typename ModelType>
+const std::vector<int>& RansacProblem<DataType, ModelType>::QualityOrder()
+    const {
+  return quality_order_;
+}
+
+template <typename DataType, typename ModelType>
+bool RansacProblem<DataType, ModelType>::IsInlier(const ModelType& model,
+                                                  double error_tolerance,
+                                                  int index) const {
+  return model.IsGoodFit(data_[index], error_tolerance);
+}
+
+template <typename DataType, typename ModelType>
+size_t RansacProblem<DataType, ModelType>::CountInliers(
+    const ModelType& model, double error_tolerance,
+    const std::vector<int>& indices) const {
+  size_t num_inliers = 0;
+  for (const auto& index : indices)
+    num_inliers += IsInlier(model, error_tolerance, index);
+  return num_inliers;
+}
+
+template <typename DataType, typename ModelType>
+void RansacProblem<DataType, ModelType>::RefineBestModel(
+    const std::vector<int>& indices, double error_tolerance,
+    ModelType& model) const {}
+
+template <typename DataType, typename ModelType>
+void RansacProblem<DataType, ModelType>::SampleIndices(
+    unsigned int num_samples, std::vector<int>& indices) {
+  const size_t num_data = permutation_.size();
+  num_samples = std::min(static_cast<size_t>(num_samples), num_data);
+
+  // Partial Fisher-Yates shuffle. The first 'num_samples' entries of the
+  // permutation become a uniformly random sample without replacement.
+  indices.resize(num_samples);
+  for (size_t ii = 0; ii < num_samples; ++ii) {
+    const size_t jj = ii + std::rand() % (num_data - ii);
+    std::swap(permutation_[ii], permutation_[jj]);
+    indices[ii] = permutation_[ii];
+  }
+}
+
 }  //\namespace bsfm
 
 #endif
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2015, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: Erik Nelson            ( eanelson@eecs.berkeley.edu )
+ *          David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// This class implements Wald's sequential probability ratio test for verifying
+// RANSAC hypotheses (Matas and Chum, "Randomized RANSAC with Sequential
+// Probability Ratio Test", ICCV 2005).
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "sequential_probability_ratio_test.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace bsfm {
+
+namespace {
+
+// Estimates of epsilon and delta are kept away from 0 and 1 so that the
+// likelihood ratio stays finite.
+const double kMinProbability = 1e-4;
+const double kMaxProbability = 1.0 - 1e-4;
+
+// The test is only restarted with a new estimate of delta if it has changed by
+// more than this fraction of its current value, so that the threshold is not
+// recomputed after every rejected model.
+const double kDeltaTolerance = 0.05;
+
+// Minimum number of data points checked against rejected models before delta
+// is estimated from them.
+const size_t kMinRejectedChecked = 100;
+
+}  //\namespace
+
+SequentialProbabilityRatioTest::SequentialProbabilityRatioTest(
+    double epsilon, double delta, double fit_cost)
+    : epsilon_(std::min(std::max(epsilon, kMinProbability), kMaxProbability)),
+      delta_(std::min(std::max(delta, kMinProbability), kMaxProbability)),
+      fit_cost_(fit_cost),
+      likelihood_ratio_(1.0),
+      num_rejected_checked_(0),
+      num_rejected_consistent_(0) {
+  UpdateThreshold();
+}
+
+SequentialProbabilityRatioTest::~SequentialProbabilityRatioTest() {}
+
+void SequentialProbabilityRatioTest::Reject(size_t num_consistent,
+                                            size_t num_checked) {
+  num_rejected_consistent_ += num_consistent;
+  num_rejected_checked_ += num_checked;
+  if (num_rejected_checked_ < kMinRejectedChecked)
+    return;
+
+  const double delta = std::min(
+      std::max(static_cast<double>(num_rejected_consistent_) /
+                   num_rejected_checked_,
+               kMinProbability),
+      kMaxProbability);
+  if (std::abs(delta - delta_) > kDeltaTolerance * delta_) {
+    delta_ = delta;
+    UpdateThreshold();
+  }
+}
+
+void SequentialProbabilityRatioTest::Accept(double inlier_ratio) {
+  if (inlier_ratio > epsilon_) {
+    epsilon_ = std::min(inlier_ratio, kMaxProbability);
+    UpdateThreshold();
+  }
+}
+
+double SequentialProbabilityRatioTest::AcceptanceProbability() const {
+  // A good model is falsely rejected with probability at most 1 / threshold.
+  return 1.0 - 1.0 / threshold_;
+}
+
+void SequentialProbabilityRatioTest::UpdateThreshold() {
+  consistent_ratio_ = delta_ / epsilon_;
+  inconsistent_ratio_ = (1.0 - delta_) / (1.0 - epsilon_);
+
+  // Bad models can not be told apart from good ones unless good models are
+  // consistent with more data. Never reject in that case.
+  if (epsilon_ <= delta_) {
+    threshold_ = std::numeric_limits<double>::infinity();
+    return;
+  }
+
+  // The optimal threshold A solves A = fit_cost * C + 1 + log(A), where C is
+  // the expected information gained from checking one data point against a
+  // bad model. Iterate to a fixed point starting from A = fit_cost * C + 1.
+  const double C = (1.0 - delta_) * std::log(inconsistent_ratio_) +
+                   delta_ * std::log(consistent_ratio_);
+  const double K = fit_cost_ * C + 1.0;
+  threshold_ = K;
+  for (int ii = 0; ii < 10; ++ii)
+    threshold_ = K + std::log(threshold_);
+}
+
+}  //\namespace bsfm
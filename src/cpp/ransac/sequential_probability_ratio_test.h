@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2015, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: Erik Nelson            ( eanelson@eecs.berkeley.edu )
+ *          David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// This class implements Wald's sequential probability ratio test for verifying
+// RANSAC hypotheses (Matas and Chum, "Randomized RANSAC with Sequential
+// Probability Ratio Test", ICCV 2005). Data points are checked against a model
+// one at a time, and the model is rejected as soon as the likelihood ratio
+// between it being bad and it being good exceeds a threshold. The threshold is
+// chosen to minimize the expected running time of RANSAC, given the fraction
+// of data points consistent with a good model (epsilon), the fraction
+// consistent with a bad model (delta), and the cost of fitting a model. Both
+// fractions are estimated as RANSAC runs.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef BSFM_RANSAC_SEQUENTIAL_PROBABILITY_RATIO_TEST_H
+#define BSFM_RANSAC_SEQUENTIAL_PROBABILITY_RATIO_TEST_H
+
+#include <stddef.h>
+
+namespace bsfm {
+
+class SequentialProbabilityRatioTest {
+ public:
+  // Initialize the test with estimates of 'epsilon' and 'delta', and the cost
+  // of fitting a model relative to checking one data point.
+  SequentialProbabilityRatioTest(double epsilon, double delta,
+                                 double fit_cost);
+  ~SequentialProbabilityRatioTest();
+
+  // Start testing a new model.
+  void Start() { likelihood_ratio_ = 1.0; }
+
+  // Update the likelihood ratio with whether the next data point is consistent
+  // with the model. Returns false once the model should be rejected.
+  bool Update(bool consistent) {
+    likelihood_ratio_ *= consistent ? consistent_ratio_ : inconsistent_ratio_;
+    return likelihood_ratio_ <= threshold_;
+  }
+
+  // Record that a model was rejected after 'num_checked' data points, of which
+  // 'num_consistent' were consistent with it. This refines the estimate of
+  // delta.
+  void Reject(size_t num_consistent, size_t num_checked);
+
+  // Record that a model was accepted with a fraction 'inlier_ratio' of the
+  // data consistent with it. If this is the best model so far, it refines the
+  // estimate of epsilon.
+  void Accept(double inlier_ratio);
+
+  // Returns the probability that a good model passes the test.
+  double AcceptanceProbability() const;
+
+  double Epsilon() const { return epsilon_; }
+  double Delta() const { return delta_; }
+  double Threshold() const { return threshold_; }
+
+ private:
+  // Recompute the decision threshold and the likelihood ratio factors from the
+  // current estimates of epsilon and delta.
+  void UpdateThreshold();
+
+  double epsilon_;
+  double delta_;
+  const double fit_cost_;
+
+  // Decision threshold, and the factors that the likelihood ratio is multiplied
+  // by for each consistent and inconsistent data point.
+  double threshold_;
+  double consistent_ratio_;
+  double inconsistent_ratio_;
+  double likelihood_ratio_;
+
+  // Data points checked against rejected models, and how many of those were
+  // consistent, used to estimate delta.
+  size_t num_rejected_checked_;
+  size_t num_rejected_consistent_;
+};  //\class SequentialProbabilityRatioTest
+
+}  //\namespace bsfm
+
+#endif
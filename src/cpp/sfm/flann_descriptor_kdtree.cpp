@@ -37,83 +37,162 @@
 
 #include "flann_descriptor_kdtree.h"
 
+#include <algorithm>
+#include <thread>
+
 namespace bsfm {
 
-FlannDescriptorKDTree::FlannDescriptorKDTree() {}
+FlannDescriptorKDTree::FlannDescriptorKDTree(unsigned int num_trees)
+    : num_trees_(std::max(num_trees, 1u)), checks_(0) {}
 
-FlannDescriptorKDTree::~FlannDescriptorKDTree() {
-  // Free memory from descriptors in the kd tree.
-  if (index_ != nullptr) {
-    for (size_t ii = 0; ii < index_->size(); ++ii) {
-      double* descriptor = index_->getPoint(ii);
-      delete[] descriptor;
-    }
-  }
+FlannDescriptorKDTree::~FlannDescriptorKDTree() {}
+
+// Add descriptors to the index.
+void FlannDescriptorKDTree::AddDescriptor(const Descriptor& descriptor) {
+  AddDescriptors(std::vector<Descriptor>(1, descriptor));
 }
 
 // Add descriptors to the index.
-void FlannDescriptorKDTree::AddDescriptor(Descriptor& descriptor) {
+void FlannDescriptorKDTree::AddDescriptors(
+    const std::vector<Descriptor>& descriptors) {
+  if (descriptors.empty())
+    return;
 
-  // Copy the input descriptor into FLANN's Matrix type.
-  const size_t cols = descriptor.size();
-  flann::Matrix<double> flann_descriptor(new double[cols], 1, cols);
-  for (size_t ii = 0; ii < cols; ++ii) {
-    flann_descriptor[0][ii] = descriptor(ii);
-  }
+  // Copy the input descriptors into one buffer and wrap it in FLANN's Matrix
+  // type.
+  const size_t cols =
+      index_ == nullptr ? descriptors[0].size() : index_->veclen();
+  points_.push_back(std::vector<float>());
+  ToFloatBuffer(descriptors, cols, points_.back());
+  flann::Matrix<float> flann_descriptors(points_.back().data(),
+                                         descriptors.size(), cols);
 
-  // If this is the first point in the index, create the index and exit.
+  // If these are the first points in the index, create the index and exit.
   if (index_ == nullptr) {
-    // Single kd-tree. No approximation.
-    const int kNumRandomizedKDTrees = 1;
-    index_.reset(new flann::Index<flann::L2<double> >(
-        flann_descriptor, flann::KDTreeIndexParams(kNumRandomizedKDTrees)));
+    index_.reset(new flann::Index<flann::L2<float> >(
+        flann_descriptors, flann::KDTreeIndexParams(num_trees_)));
     index_->buildIndex();
     return;
   }
 
-  // If the index is already created, add the data point to the index. Rebuild
+  // If the index is already created, add the data points to the index. Rebuild
   // every time the index doubles in size to occasionally rebalance the kd tree.
-  const int kRebuildThreshold = 2;
-  index_->addPoints(flann_descriptor, kRebuildThreshold);
+  const float kRebuildThreshold = 2.f;
+  index_->addPoints(flann_descriptors, kRebuildThreshold);
 }
 
-// Add descriptors to the index.
-void FlannDescriptorKDTree::AddDescriptors(
-    std::vector<Descriptor>& descriptors) {
-  for (auto& descriptor : descriptors) {
-    AddDescriptor(descriptor);
-  }
+// Number of descriptors in the index.
+size_t FlannDescriptorKDTree::Size() const {
+  return index_ == nullptr ? 0 : index_->size();
+}
+
+// Set the maximum number of leaves checked per query.
+void FlannDescriptorKDTree::SetSearchChecks(int checks) {
+  checks_ = checks;
 }
 
 // Queries the kd tree for the nearest neighbor of 'query'.
-bool FlannDescriptorKDTree::NearestNeighbor(Descriptor& query, int& nn_index,
-                                            double& nn_distance) {
+bool FlannDescriptorKDTree::NearestNeighbor(const Descriptor& query,
+                                            int& nn_index,
+                                            double& nn_distance) const {
+  std::vector<std::vector<int> > query_match_indices;
+  std::vector<std::vector<double> > query_distances;
+  const int kOneNearestNeighbor = 1;
+  if (!KNearestNeighbors(std::vector<Descriptor>(1, query), kOneNearestNeighbor,
+                         query_match_indices, query_distances))
+    return false;
+
+  // If we found a nearest neighbor, assign output.
+  if (query_match_indices[0].empty())
+    return false;
+
+  nn_index = query_match_indices[0][0];
+  nn_distance = query_distances[0][0];
+  return true;
+}
+
+// Queries the kd tree for the k nearest neighbors of each query.
+bool FlannDescriptorKDTree::KNearestNeighbors(
+    const std::vector<Descriptor>& queries, unsigned int k,
+    std::vector<std::vector<int> >& nn_indices,
+    std::vector<std::vector<double> >& nn_distances,
+    unsigned int num_threads) const {
+  nn_indices.clear();
+  nn_distances.clear();
   if (index_ == nullptr) {
     VLOG(1) << "Index has not been built. Descriptors must be added before "
                "querying the kd tree";
     return false;
   }
 
-  // Convert the input descriptor to the FLANN format. We can use Eigen's memory
-  // here, since we will have our answer before leaving function scope.
-  flann::Matrix<double> flann_query(query.data(), 1, index_->veclen());
+  nn_indices.resize(queries.size());
+  nn_distances.resize(queries.size());
+  k = std::min(k, static_cast<unsigned int>(index_->size()));
+  if (queries.empty() || k == 0)
+    return true;
+
+  // Convert the queries to the FLANN format, and allocate space for results.
+  const size_t cols = index_->veclen();
+  std::vector<float> query_buffer;
+  ToFloatBuffer(queries, cols, query_buffer);
+  std::vector<int> index_buffer(queries.size() * k, -1);
+  std::vector<float> distance_buffer(queries.size() * k);
+
+  flann::SearchParams params(checks_ > 0 ? checks_
+                                         : flann::FLANN_CHECKS_UNLIMITED);
+
+  // Each thread searches a contiguous block of queries, writing into its own
+  // rows of the result buffers.
+  if (num_threads == 0)
+    num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  num_threads = std::min(num_threads, static_cast<unsigned int>(queries.size()));
+  const size_t block_size = (queries.size() + num_threads - 1) / num_threads;
+
+  auto search_block = [&](size_t first) {
+    const size_t rows = std::min(block_size, queries.size() - first);
+    flann::Matrix<float> flann_queries(&query_buffer[first * cols], rows, cols);
+    flann::Matrix<int> flann_indices(&index_buffer[first * k], rows, k);
+    flann::Matrix<float> flann_distances(&distance_buffer[first * k], rows, k);
+    index_->knnSearch(flann_queries, flann_indices, flann_distances, k, params);
+  };
+
+  if (num_threads == 1) {
+    search_block(0);
+  } else {
+    std::vector<std::thread> threads;
+    for (size_t first = 0; first < queries.size(); first += block_size)
+      threads.emplace_back(search_block, first);
+    for (auto& thread : threads)
+      thread.join();
+  }
 
-  // Search the kd tree for the nearest neighbor to the query.
-  std::vector< std::vector<int> > query_match_indices;
-  std::vector< std::vector<double> > query_distances;
+  // Copy results, skipping any neighbors that an approximate search did not
+  // find.
+  for (size_t ii = 0; ii < queries.size(); ++ii) {
+    nn_indices[ii].reserve(k);
+    nn_distances[ii].reserve(k);
+    for (size_t jj = 0; jj < k; ++jj) {
+      const int index = index_buffer[ii * k + jj];
+      if (index < 0 || static_cast<size_t>(index) >= index_->size())
+        continue;
+      nn_indices[ii].push_back(index);
+      nn_distances[ii].push_back(distance_buffer[ii * k + jj]);
+    }
+  }
 
-  const int kOneNearestNeighbor = 1;
-  int num_neighbors_found = index_->knnSearch(
-      flann_query, query_match_indices, query_distances, kOneNearestNeighbor,
-      flann::SearchParams(flann::FLANN_CHECKS_UNLIMITED) /* no approx */);
+  return true;
+}
 
-  // If we found a nearest neighbor, assign output.
-  if (num_neighbors_found > 0) {
-    nn_index = query_match_indices[0][0];
-    nn_distance = query_distances[0][0];
+// Copy descriptors into a contiguous row-major float buffer.
+void FlannDescriptorKDTree::ToFloatBuffer(
+    const std::vector<Descriptor>& descriptors, size_t cols,
+    std::vector<float>& buffer) {
+  buffer.resize(descriptors.size() * cols);
+  for (size_t ii = 0; ii < descriptors.size(); ++ii) {
+    CHECK_EQ(cols, static_cast<size_t>(descriptors[ii].size()));
+    Eigen::Map<Eigen::VectorXf>(&buffer[ii * cols], cols) =
+        descriptors[ii].cast<float>();
   }
-
-  return num_neighbors_found > 0;
 }
 
 }  //\namespace bsfm
@@ -44,12 +44,20 @@
 // queries in log(n) time, where n is the number of dimensions in the
 // descriptor.
 //
+// Descriptors are stored in single precision, one contiguous buffer per call
+// to AddDescriptors(). Searches are exact by default. Setting a check budget
+// with SetSearchChecks() bounds the number of leaves visited per query, which
+// trades accuracy for speed.
+//
 ///////////////////////////////////////////////////////////////////////////////
 
 #ifndef BSFM_SFM_FLANN_DESCRIPTOR_KDTREE_H
 #define BSFM_SFM_FLANN_DESCRIPTOR_KDTREE_H
 
-#include <flann/flann.h>
+#include <deque>
+#include <flann/flann.hpp>
+#include <memory>
+#include <vector>
 
 #include "../matching/distance_metric.h"
 #include "../util/disallow_copy_and_assign.h"
@@ -59,23 +67,57 @@ namespace bsfm {
 
 class FlannDescriptorKDTree {
  public:
-  FlannDescriptorKDTree();
+  // Build 'num_trees' randomized kd trees. More than one tree only helps
+  // approximate searches.
+  explicit FlannDescriptorKDTree(unsigned int num_trees = 1);
   ~FlannDescriptorKDTree();
 
-  // Add descriptors to the index.
-  void AddDescriptor(Descriptor& descriptor);
-  void AddDescriptors(std::vector<Descriptor>& descriptors);
+  // Add descriptors to the index. All descriptors must have the same length.
+  // Adding many descriptors in one call is much faster than adding them one at
+  // a time, since the index is only extended (and occasionally rebuilt) once.
+  void AddDescriptor(const Descriptor& descriptor);
+  void AddDescriptors(const std::vector<Descriptor>& descriptors);
+
+  // Number of descriptors in the index.
+  size_t Size() const;
+
+  // Set the maximum number of leaves checked per query. If this is 0 or
+  // negative (the default), searches are exact.
+  void SetSearchChecks(int checks);
 
   // Queries the kd tree for the nearest neighbor of 'query'. Returns whether or
   // not a nearest neighbor was found, and if it was found, the index and
   // distance to the nearest neighbor. Index is based on the order in which
-  // descriptors were added with AddDescriptor() and AddDescriptors().
-  bool NearestNeighbor(Descriptor& query, int& nn_index, double& nn_distance);
+  // descriptors were added with AddDescriptor() and AddDescriptors(). Distances
+  // are squared L2 distances.
+  bool NearestNeighbor(const Descriptor& query, int& nn_index,
+                       double& nn_distance) const;
+
+  // Queries the kd tree for the (at most) 'k' nearest neighbors of every
+  // descriptor in 'queries', sorted by increasing distance, e.g. k = 2 for the
+  // Lowes ratio test. Queries are split across 'num_threads' threads. If this
+  // is 0, one thread is used per hardware core. Returns false if the index is
+  // empty.
+  bool KNearestNeighbors(const std::vector<Descriptor>& queries,
+                         unsigned int k,
+                         std::vector<std::vector<int> >& nn_indices,
+                         std::vector<std::vector<double> >& nn_distances,
+                         unsigned int num_threads = 1) const;
 
  private:
   DISALLOW_COPY_AND_ASSIGN(FlannDescriptorKDTree)
 
-  std::shared_ptr< flann::Index<flann::L2<double> > > index_;
+  // Copy descriptors into a contiguous row-major float buffer.
+  static void ToFloatBuffer(const std::vector<Descriptor>& descriptors,
+                            size_t cols, std::vector<float>& buffer);
+
+  unsigned int num_trees_;
+  int checks_;
+
+  // FLANN does not copy points, so the index refers to these buffers. They
+  // are stored in a deque so that adding a buffer never moves the others.
+  std::deque<std::vector<float> > points_;
+  std::shared_ptr< flann::Index<flann::L2<float> > > index_;
 
 };  //\class FlannDescriptorKDTree
 }  //\namespace bsfm
@@ -187,6 +187,35 @@ void View::GetFeaturesAndDescriptors(
   }
 }
 
+bool View::CreateAndAddObservations(
+    const std::vector<Feature>& features,
+    const std::vector<BinaryDescriptor>& descriptors) {
+  if (features.size() != descriptors.size()) {
+    LOG(WARNING) << "Number of features and descriptors does not match.";
+    return false;
+  }
+
+  View::Ptr this_view = GetView(this->Index());
+  for (size_t ii = 0; ii < features.size(); ++ii)
+    Observation::Create(this_view, features[ii], descriptors[ii]);
+
+  return true;
+}
+
+void View::GetFeaturesAndDescriptors(
+    std::vector<Feature>* features,
+    std::vector<BinaryDescriptor>* descriptors) const {
+  CHECK_NOTNULL(features);
+  CHECK_NOTNULL(descriptors);
+  features->clear();
+  descriptors->clear();
+
+  for (const auto& observation : observations_) {
+    features->emplace_back(observation->Feature());
+    descriptors->emplace_back(observation->BinaryDescriptor());
+  }
+}
+
 bool View::HasObservedLandmark(LandmarkIndex landmark_index) const {
   return landmarks_.count(landmark_index);
 }
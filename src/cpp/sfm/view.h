@@ -118,10 +118,16 @@ class View {
   // pair.
   bool CreateAndAddObservations(const std::vector<Feature>& features,
                                 const std::vector<Descriptor>& descriptors);
+  bool CreateAndAddObservations(
+      const std::vector<Feature>& features,
+      const std::vector<BinaryDescriptor>& descriptors);
 
   // Populate a list of features and descriptors from observations in this view.
   void GetFeaturesAndDescriptors(std::vector<Feature>* features,
                                  std::vector<Descriptor>* descriptors) const;
+  void GetFeaturesAndDescriptors(
+      std::vector<Feature>* features,
+      std::vector<BinaryDescriptor>* descriptors) const;
 
   // Report whether one of the observations in this view has been matched with a
   // specific landmark.
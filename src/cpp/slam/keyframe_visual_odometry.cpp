@@ -35,6 +35,7 @@
  *          David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
  */
 
+#include <chrono>
 #include <set>
 #include <string>
 #include <unordered_set>
@@ -43,6 +44,7 @@
 #include "../file/csv_writer.h"
 #include "../geometry/essential_matrix_solver.h"
 #include "../matching/feature_match.h"
+#include "../matching/motion_statistics_filter.h"
 #include "../matching/naive_matcher_2d2d.h"
 #include "../matching/naive_matcher_2d3d.h"
 #include "../matching/pairwise_image_match.h"
@@ -59,7 +61,8 @@ KeyframeVisualOdometry::KeyframeVisualOdometry(
     const VisualOdometryOptions& options, const CameraIntrinsics& intrinsics)
     : initialize_new_keyframe_(false),
       options_(options),
-      current_keyframe_(kInvalidView) {
+      current_keyframe_(kInvalidView),
+      frame_deadline_(std::chrono::steady_clock::time_point::max()) {
   // Use input options to specify member variable settings.
   keypoint_detector_.SetDetector(options_.feature_type);
   if (options_.use_grid_filter) {
@@ -68,13 +71,14 @@ KeyframeVisualOdometry::KeyframeVisualOdometry(
   }
 
   descriptor_extractor_.SetDescriptor(options_.descriptor_type);
-
-  DistanceMetric& distance = DistanceMetric::Instance();
-  distance.SetMetric(options_.matcher_options.distance_metric);
-  if (options_.matcher_options.enforce_maximum_descriptor_distance) {
-    distance.SetMaximumDistance(
-        options_.matcher_options.maximum_descriptor_distance);
+  if (options_.use_optical_flow) {
+    flow_tracker_.SetOptions(options_.optical_flow_window_size,
+                             options_.optical_flow_pyramid_levels,
+                             options_.optical_flow_max_error);
   }
+  landmark_descriptors_.SetMetric(options_.matcher_options.distance_metric);
+
+  metric_ = DistanceMetric::Parse(options_.matcher_options.distance_metric);
 
   // Store camera intrinsics.
   intrinsics_ = intrinsics;
@@ -83,6 +87,28 @@ KeyframeVisualOdometry::KeyframeVisualOdometry(
 KeyframeVisualOdometry::~KeyframeVisualOdometry() {}
 
 Status KeyframeVisualOdometry::Update(const Image& image) {
+  // Pose estimation must finish within the frame's time budget.
+  frame_deadline_ = std::chrono::steady_clock::time_point::max();
+  if (options_.max_frame_time > 0.0) {
+    frame_deadline_ =
+        std::chrono::steady_clock::now() +
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(options_.max_frame_time));
+  }
+
+  // Set the annotator's image.
+  if (options_.draw_tracks || options_.draw_features) {
+    annotator_.SetImage(image);
+  }
+
+  // Between keyframes, optionally track features from the last view with
+  // optical flow rather than detecting and matching them again.
+  if (options_.use_optical_flow && view_indices_.size() >= 2 &&
+      !initialize_new_keyframe_ &&
+      NumEstimatedTracks() >= options_.min_num_feature_tracks) {
+    return UpdateWithOpticalFlow(image);
+  }
+
   // Extract keypoints from the frame.
   std::vector<Keypoint> keypoints;
   Status status = GetKeypoints(image, &keypoints);
@@ -91,27 +117,28 @@ Status KeyframeVisualOdometry::Update(const Image& image) {
   // Extract features and descriptors from the keypoints.
   std::vector<Feature> features;
   std::vector<Descriptor> descriptors;
-  status = GetDescriptors(image, &keypoints, &features, &descriptors);
+  std::vector<BinaryDescriptor> binary_descriptors;
+  status = GetDescriptors(image, &keypoints, &features, &descriptors,
+                          &binary_descriptors);
   if (!status.ok()) return status;
 
-  // Set the annotator's image.
-  if (options_.draw_tracks || options_.draw_features) {
-    annotator_.SetImage(image);
-  }
-
   // Initialize the very first view if we don't have one yet.
   if (current_keyframe_ == kInvalidView) {
     Landmark::SetRequiredObservations(2);
-    InitializeFirstView(features, descriptors);
+    InitializeFirstView(features, descriptors, binary_descriptors);
+    if (options_.use_optical_flow)
+      flow_tracker_.SetImage(image);
     return Status::Ok();
   }
 
   // Initialize the second view if we don't have one yet using 2D<-->2D
   // matching.
   if (view_indices_.size() == 1) {
-    status = InitializeSecondView(features, descriptors);
+    status = InitializeSecondView(features, descriptors, binary_descriptors);
     if (status.ok()) {
       Landmark::SetRequiredObservations(options_.num_observations_to_triangulate);
+      if (options_.use_optical_flow)
+        flow_tracker_.SetImage(image);
     }
     return status;
   }
@@ -132,6 +159,7 @@ Status KeyframeVisualOdometry::Update(const Image& image) {
   // Update feature tracks and add matched features to the view.
   status = UpdateFeatureTracks(features,
                                descriptors,
+                               binary_descriptors,
                                new_view->Index(),
                                is_keyframe);
   if (!status.ok()) {
@@ -145,6 +173,8 @@ Status KeyframeVisualOdometry::Update(const Image& image) {
     View::DeleteMostRecentView();
   } else {
     view_indices_.push_back(new_view->Index());
+    if (options_.use_optical_flow)
+      flow_tracker_.SetImage(image);
   }
 
   if (is_keyframe && options_.perform_bundle_adjustment) {
@@ -169,6 +199,45 @@ Status KeyframeVisualOdometry::Update(const Image& image) {
   return status;
 }
 
+Status KeyframeVisualOdometry::UpdateWithOpticalFlow(const Image& image) {
+  // Create a camera with an unknown pose.
+  Camera camera;
+  camera.SetIntrinsics(intrinsics_);
+  View::Ptr new_view = View::Create(camera);
+
+  // Track features into the new view.
+  Status status = TrackFeatures(image, new_view->Index());
+  if (!status.ok()) {
+    View::DeleteMostRecentView();
+    return status;
+  }
+
+  // Compute the new camera pose.
+  status = EstimatePose(new_view->Index());
+  if (!status.ok()) {
+    View::DeleteMostRecentView();
+  } else {
+    view_indices_.push_back(new_view->Index());
+    flow_tracker_.SetImage(image);
+  }
+
+  // Annotate tracks and tracked features.
+  if (options_.draw_features) {
+    std::vector<Feature> features;
+    for (const auto& observation : new_view->Observations())
+      features.push_back(observation->Feature());
+    annotator_.AnnotateFeatures(features);
+  }
+  if (options_.draw_tracks) {
+    annotator_.AnnotateTracks(tracks_);
+  }
+  if (options_.draw_tracks || options_.draw_features) {
+    annotator_.Draw();
+  }
+
+  return status;
+}
+
 void KeyframeVisualOdometry::GetAnnotatedImage(Image* image) const {
   annotator_.GetImageCopy(image);
 }
@@ -270,14 +339,13 @@ Status KeyframeVisualOdometry::WriteMapToFile(
 
 void KeyframeVisualOdometry::InitializeFirstView(
     const std::vector<Feature>& features,
-    const std::vector<Descriptor>& descriptors) {
-  CHECK_EQ(features.size(), descriptors.size());
-
+    const std::vector<Descriptor>& descriptors,
+    const std::vector<BinaryDescriptor>& binary_descriptors) {
   // Create the first view at identity.
   Camera first_camera;
   first_camera.SetIntrinsics(intrinsics_);
   View::Ptr first_view = View::Create(first_camera);
-  first_view->CreateAndAddObservations(features, descriptors);
+  AddObservations(first_view, features, descriptors, binary_descriptors);
 
   // Annotate tracks only in the first frame.
   if (options_.draw_tracks) {
@@ -292,21 +360,28 @@ void KeyframeVisualOdometry::InitializeFirstView(
 
 Status KeyframeVisualOdometry::InitializeSecondView(
     const std::vector<Feature>& features,
-    const std::vector<Descriptor>& descriptors) {
-  CHECK_EQ(features.size(), descriptors.size());
-
+    const std::vector<Descriptor>& descriptors,
+    const std::vector<BinaryDescriptor>& binary_descriptors) {
   // Try to match features and descriptors from the first image against those
   // from this image.
   View::Ptr first_view = View::GetView(current_keyframe_);
   CHECK_NOTNULL(first_view.get());
 
   std::vector<Feature> old_features;
-  std::vector<Descriptor> old_descriptors;
-  first_view->GetFeaturesAndDescriptors(&old_features, &old_descriptors);
-
   NaiveMatcher2D2D feature_matcher;
-  feature_matcher.AddImageFeatures(old_features, old_descriptors);
-  feature_matcher.AddImageFeatures(features, descriptors);
+  if (descriptor_extractor_.IsBinary()) {
+    CHECK_EQ(features.size(), binary_descriptors.size());
+    std::vector<BinaryDescriptor> old_descriptors;
+    first_view->GetFeaturesAndDescriptors(&old_features, &old_descriptors);
+    feature_matcher.AddImageFeatures(old_features, old_descriptors);
+    feature_matcher.AddImageFeatures(features, binary_descriptors);
+  } else {
+    CHECK_EQ(features.size(), descriptors.size());
+    std::vector<Descriptor> old_descriptors;
+    first_view->GetFeaturesAndDescriptors(&old_features, &old_descriptors);
+    feature_matcher.AddImageFeatures(old_features, old_descriptors);
+    feature_matcher.AddImageFeatures(features, descriptors);
+  }
 
   // Use all matches for 2D to 2D feature matching (not just the best n).
   const bool kTempOption = options_.matcher_options.only_keep_best_matches;
@@ -333,6 +408,15 @@ Status KeyframeVisualOdometry::InitializeSecondView(
   FundamentalMatrixRansacProblem f_problem;
   f_problem.SetData(feature_matches);
 
+  // Rank matches by descriptor distance, so that PROSAC samples the most
+  // distinctive matches first.
+  if (options_.fundamental_matrix_ransac_options.use_prosac) {
+    std::vector<double> quality;
+    for (const double distance : image_match.distances_)
+      quality.push_back(-distance);
+    f_problem.SetQuality(quality);
+  }
+
   Ransac<FeatureMatch, FundamentalMatrixRansacModel> f_solver;
   f_solver.SetOptions(options_.fundamental_matrix_ransac_options);
   f_solver.Run(f_problem);
@@ -361,7 +445,7 @@ Status KeyframeVisualOdometry::InitializeSecondView(
   camera2.SetExtrinsics(extrinsics);
   camera2.SetIntrinsics(intrinsics_);
   View::Ptr second_view = View::Create(camera2);
-  second_view->CreateAndAddObservations(features, descriptors);
+  AddObservations(second_view, features, descriptors, binary_descriptors);
 
   // Initialize tracks for all observations in the second view.
   tracks_.clear();
@@ -376,7 +460,7 @@ Status KeyframeVisualOdometry::InitializeSecondView(
       if (feature_match.feature2_ == observation->Feature()) {
         for (const auto& old_observation : first_view->Observations()) {
           if (feature_match.feature1_ == old_observation->Feature()) {
-            track->IncorporateObservation(old_observation);
+            IncorporateObservation(track, old_observation);
             found_matched_observation = true;
             break;
           }
@@ -386,13 +470,14 @@ Status KeyframeVisualOdometry::InitializeSecondView(
     }
 
     // Now add the observation from the second view.
-    if (track->IncorporateObservation(observation)) {
+    if (IncorporateObservation(track, observation)) {
       if (found_matched_observation) {
         CHECK(track->IsEstimated());
         triangulated_count++;
       }
     }
     track->SetDescriptor(observation->Descriptor());
+    track->SetDescriptor(observation->BinaryDescriptor());
     tracks_.push_back(track->Index());
   }
   printf("triangulated %d\n", triangulated_count);
@@ -411,6 +496,7 @@ Status KeyframeVisualOdometry::InitializeSecondView(
   if (triangulated_count < options_.num_landmarks_to_initialize) {
     // Delete all landmarks and return false.
     Landmark::ResetLandmarks();
+    landmark_descriptors_.Clear();
     tracks_.clear();
     return Status::Cancelled("Did not triangulate enough landmarks to initialize.");
   }
@@ -423,18 +509,62 @@ Status KeyframeVisualOdometry::InitializeSecondView(
 
 Status KeyframeVisualOdometry::UpdateFeatureTracks(
     const std::vector<Feature>& features,
-    const std::vector<Descriptor>& descriptors, ViewIndex view_index,
-    bool is_keyframe) {
-  CHECK_EQ(features.size(), descriptors.size());
-
+    const std::vector<Descriptor>& descriptors,
+    const std::vector<BinaryDescriptor>& binary_descriptors,
+    ViewIndex view_index, bool is_keyframe) {
   // Add all features and descriptors to the view as observations.
   View::Ptr view = View::GetView(view_index);
   CHECK_NOTNULL(view.get());
-  view->CreateAndAddObservations(features, descriptors);
-
-  // Match observations seen by this view with existing tracks.
+  AddObservations(view, features, descriptors, binary_descriptors);
+
+  // Match observations seen by this view with existing tracks. If using a
+  // motion model, estimated tracks are first matched near their projection into
+  // the predicted camera.
+  // Landmark descriptors are kept normalized in the descriptor store, which is
+  // updated below as tracks change. Bring it up to date with any changes made
+  // elsewhere (e.g. during initialization) before matching.
+  landmark_descriptors_.Update(tracks_);
   NaiveMatcher2D3D feature_matcher;
-  if (!feature_matcher.Match(options_.matcher_options, view_index, tracks_)) {
+  feature_matcher.SetLandmarkDescriptorStore(&landmark_descriptors_);
+  bool matched = false;
+  std::vector<LandmarkIndex> unpredicted_tracks = tracks_;
+  Camera predicted_camera;
+  if (options_.use_motion_model && PredictCamera(&predicted_camera)) {
+    std::vector<LandmarkIndex> predicted_tracks;
+    std::vector<Feature> predicted_features;
+    unpredicted_tracks.clear();
+    for (const auto& track_index : tracks_) {
+      Landmark::Ptr track = Landmark::GetLandmark(track_index);
+      CHECK_NOTNULL(track.get());
+
+      double u = 0.0, v = 0.0;
+      if (track->IsEstimated() &&
+          predicted_camera.WorldToImage(track->Position().X(),
+                                        track->Position().Y(),
+                                        track->Position().Z(), &u, &v)) {
+        predicted_tracks.push_back(track_index);
+        predicted_features.push_back(Feature(u, v));
+      } else {
+        unpredicted_tracks.push_back(track_index);
+      }
+    }
+
+    FeatureMatcherOptions predicted_options = options_.matcher_options;
+    predicted_options.threshold_image_distance = true;
+    predicted_options.maximum_image_distance =
+        options_.motion_model_search_radius;
+    matched = feature_matcher.Match(predicted_options, view_index,
+                                    predicted_tracks, predicted_features);
+  }
+
+  // Match all remaining tracks against their most recent observations.
+  if (!unpredicted_tracks.empty() &&
+      feature_matcher.Match(options_.matcher_options, view_index,
+                            unpredicted_tracks)) {
+    matched = true;
+  }
+
+  if (!matched) {
     return Status::Cancelled(
         "Failed to match 2D descriptors with existing landmarks.");
   }
@@ -449,8 +579,10 @@ Status KeyframeVisualOdometry::UpdateFeatureTracks(
 
       Landmark::Ptr track = Landmark::GetLandmark(index);
       CHECK_NOTNULL(track.get());
-      track->IncorporateObservation(observation);
+      IncorporateObservation(track, observation);
       track->SetDescriptor(observation->Descriptor());
+      track->SetDescriptor(observation->BinaryDescriptor());
+      landmark_descriptors_.Update(index);
     }
   }
 
@@ -458,6 +590,103 @@ Status KeyframeVisualOdometry::UpdateFeatureTracks(
   view->MatchedObservations(&test);
   printf("(1) have %lu matches here.\n", test.size());
 
+  // Remove tracks that were not matched, and have not been seen recently.
+  RemoveLostTracks(matched_tracks);
+
+  view->MatchedObservations(&test);
+  printf("(2) have %lu matches here.\n", test.size());
+
+  if (is_keyframe) {
+    printf("Was a keyframe.\n");
+    // Add all unmatched features as new tracks.
+    current_keyframe_ = view_index;
+
+    for (const auto& observation : view->Observations()) {
+      CHECK_NOTNULL(observation.get());
+
+      if (!observation->IsMatched()) {
+        Landmark::Ptr track = Landmark::Create();
+        IncorporateObservation(track, observation);
+        tracks_.push_back(track->Index());
+        landmark_descriptors_.Update(track->Index());
+      }
+    }
+  }
+
+  view->MatchedObservations(&test);
+  printf("(3) have %lu matches here.\n", test.size());
+
+  return Status::Ok();
+}
+
+Status KeyframeVisualOdometry::TrackFeatures(const Image& image,
+                                             ViewIndex view_index) {
+  View::Ptr view = View::GetView(view_index);
+  CHECK_NOTNULL(view.get());
+  const ViewIndex previous_view_index = view_indices_.back();
+
+  // Find where each track was observed in the previous view. Tracks that were
+  // not observed there cannot be tracked.
+  std::vector<LandmarkIndex> track_indices;
+  std::vector<Observation::Ptr> previous_observations;
+  std::vector<Feature> previous_features;
+  for (const auto& track_index : tracks_) {
+    Landmark::Ptr track = Landmark::GetLandmark(track_index);
+    CHECK_NOTNULL(track.get());
+
+    const auto& track_observations = track->Observations();
+    for (auto it = track_observations.rbegin(); it != track_observations.rend();
+         ++it) {
+      if ((*it)->GetViewIndex() == previous_view_index) {
+        track_indices.push_back(track_index);
+        previous_observations.push_back(*it);
+        previous_features.push_back((*it)->Feature());
+        break;
+      }
+    }
+  }
+
+  std::vector<Feature> features;
+  std::vector<bool> found;
+  if (!flow_tracker_.Track(image, previous_features, features, found)) {
+    return Status::Cancelled("Failed to track features with optical flow.");
+  }
+
+  // Add an observation of each tracked feature to the view, carrying over the
+  // descriptor from the previous observation, and add it to its track.
+  std::set<LandmarkIndex> matched_tracks;
+  for (size_t ii = 0; ii < features.size(); ++ii) {
+    if (!found[ii])
+      continue;
+
+    Observation::Ptr observation;
+    if (descriptor_extractor_.IsBinary()) {
+      observation = Observation::Create(
+          view, features[ii], previous_observations[ii]->BinaryDescriptor());
+    } else {
+      observation = Observation::Create(
+          view, features[ii], previous_observations[ii]->Descriptor());
+    }
+    observation->SetMatchedLandmark(track_indices[ii]);
+    matched_tracks.insert(track_indices[ii]);
+
+    Landmark::Ptr track = Landmark::GetLandmark(track_indices[ii]);
+    IncorporateObservation(track, observation);
+    landmark_descriptors_.Update(track_indices[ii]);
+  }
+
+  if (matched_tracks.empty()) {
+    return Status::Cancelled("Failed to track any features with optical flow.");
+  }
+
+  // Remove tracks that were lost, and have not been seen recently.
+  RemoveLostTracks(matched_tracks);
+
+  return Status::Ok();
+}
+
+void KeyframeVisualOdometry::RemoveLostTracks(
+    const std::set<LandmarkIndex>& matched_tracks) {
   // Get a list of tracks that were not matched with.
   std::set<size_t> unmatched_track_inds;
   for (size_t ii = 0; ii < tracks_.size(); ++ii) {
@@ -481,32 +710,9 @@ Status KeyframeVisualOdometry::UpdateFeatureTracks(
     if (track->IsEstimated())
       frozen_landmarks_.push_back(track->Index());
 
+    landmark_descriptors_.Remove(tracks_[*it]);
     tracks_.erase(tracks_.begin() + *it);
   }
-
-  view->MatchedObservations(&test);
-  printf("(2) have %lu matches here.\n", test.size());
-
-  if (is_keyframe) {
-    printf("Was a keyframe.\n");
-    // Add all unmatched features as new tracks.
-    current_keyframe_ = view_index;
-
-    for (const auto& observation : view->Observations()) {
-      CHECK_NOTNULL(observation.get());
-
-      if (!observation->IsMatched()) {
-        Landmark::Ptr track = Landmark::Create();
-        track->IncorporateObservation(observation);
-        tracks_.push_back(track->Index());
-      }
-    }
-  }
-
-  view->MatchedObservations(&test);
-  printf("(3) have %lu matches here.\n", test.size());
-
-  return Status::Ok();
 }
 
 Status KeyframeVisualOdometry::EstimatePose(ViewIndex view_index) {
@@ -528,12 +734,29 @@ Status KeyframeVisualOdometry::EstimatePose(ViewIndex view_index) {
     if (observation->GetLandmark()->IsEstimated())
       valid_observations.push_back(observation);
   }
+
+  // Discard 2D<-->3D matches that did not move coherently with their
+  // neighbors since each landmark's previous observation.
+  if (options_.matcher_options.use_motion_statistics_filter)
+    FilterByMotionStatistics(view_index, &valid_observations);
+
   pnp_problem.SetData(valid_observations);
   printf("valid observations: %lu\n", valid_observations.size());
 
+  // Rank 2D<-->3D matches by descriptor distance for PROSAC.
+  if (options_.pnp_ransac_options.use_prosac) {
+    std::vector<double> quality;
+    for (const auto& observation : valid_observations)
+      quality.push_back(-observation->MatchDistance());
+    pnp_problem.SetQuality(quality);
+  }
+
   Ransac<Observation::Ptr, PnPRansacModel> pnp_solver;
   pnp_solver.SetOptions(options_.pnp_ransac_options);
-  pnp_solver.Run(pnp_problem);
+  if (options_.max_frame_time > 0.0)
+    pnp_solver.Run(pnp_problem, frame_deadline_);
+  else
+    pnp_solver.Run(pnp_problem);
 
   // If RANSAC fails, set that the next frame should be a keyframe and return.
   if (!pnp_problem.SolutionFound()) {
@@ -562,6 +785,61 @@ Status KeyframeVisualOdometry::EstimatePose(ViewIndex view_index) {
   return Status::Ok();
 }
 
+void KeyframeVisualOdometry::FilterByMotionStatistics(
+    ViewIndex view_index, std::vector<Observation::Ptr>* observations) const {
+  CHECK_NOTNULL(observations);
+
+  // Pair each observation with the most recent observation of its landmark
+  // from another view. Observations of landmarks that have not been seen from
+  // another view are kept as they are.
+  std::vector<Observation::Ptr> kept_observations, paired_observations;
+  std::vector<Feature> previous_features, features;
+  for (const auto& observation : *observations) {
+    const auto& track_observations = observation->GetLandmark()->Observations();
+    auto it = track_observations.rbegin();
+    while (it != track_observations.rend() &&
+           (*it)->GetViewIndex() == view_index)
+      ++it;
+
+    if (it == track_observations.rend()) {
+      kept_observations.push_back(observation);
+    } else {
+      paired_observations.push_back(observation);
+      previous_features.push_back((*it)->Feature());
+      features.push_back(observation->Feature());
+    }
+  }
+
+  std::vector<int> inliers;
+  MotionStatisticsFilter filter(
+      options_.matcher_options.motion_statistics_grid_size,
+      options_.matcher_options.motion_statistics_threshold);
+  filter.Filter(previous_features, features, inliers);
+  for (const auto& inlier : inliers)
+    kept_observations.push_back(paired_observations[inlier]);
+
+  observations->swap(kept_observations);
+}
+
+bool KeyframeVisualOdometry::PredictCamera(Camera* camera) const {
+  CHECK_NOTNULL(camera);
+  if (view_indices_.size() < 2)
+    return false;
+
+  View::Ptr view1 = View::GetView(view_indices_[view_indices_.size() - 2]);
+  View::Ptr view2 = View::GetView(view_indices_.back());
+  CHECK_NOTNULL(view1.get());
+  CHECK_NOTNULL(view2.get());
+
+  // With world to camera transformations T1 and T2, the constant velocity
+  // prediction is (T2 * T1^-1) * T2 = T2 * T1.Delta(T2).
+  const Pose T1 = view1->Camera().Extrinsics().WorldToCamera();
+  const Pose T2 = view2->Camera().Extrinsics().WorldToCamera();
+  camera->SetExtrinsics(CameraExtrinsics(T2 * T1.Delta(T2)));
+  camera->SetIntrinsics(intrinsics_);
+  return true;
+}
+
 Status KeyframeVisualOdometry::GetKeypoints(const Image& image,
                                             std::vector<Keypoint>* keypoints) {
   CHECK_NOTNULL(keypoints)->clear();
@@ -576,19 +854,61 @@ Status KeyframeVisualOdometry::GetKeypoints(const Image& image,
 
 Status KeyframeVisualOdometry::GetDescriptors(
     const Image& image, std::vector<Keypoint>* keypoints,
-    std::vector<Feature>* features, std::vector<Descriptor>* descriptors) {
+    std::vector<Feature>* features, std::vector<Descriptor>* descriptors,
+    std::vector<BinaryDescriptor>* binary_descriptors) {
   CHECK_NOTNULL(features)->clear();
   CHECK_NOTNULL(descriptors)->clear();
+  CHECK_NOTNULL(binary_descriptors)->clear();
 
   // TODO: Seed descriptor matching with track information.
-  if (!descriptor_extractor_.DescribeFeatures(image, *keypoints, *features,
-                                              *descriptors)) {
+  const bool described =
+      descriptor_extractor_.IsBinary()
+          ? descriptor_extractor_.DescribeFeatures(image, *keypoints, *features,
+                                                   *binary_descriptors)
+          : descriptor_extractor_.DescribeFeatures(image, *keypoints, *features,
+                                                   *descriptors);
+  if (!described) {
     return Status::Cancelled("Failed to describe features.");
   }
-  printf("got %lu descriptors\n", descriptors->size());
+  printf("got %lu descriptors\n", features->size());
   return Status::Ok();
 }
 
+void KeyframeVisualOdometry::AddObservations(
+    const View::Ptr& view, const std::vector<Feature>& features,
+    const std::vector<Descriptor>& descriptors,
+    const std::vector<BinaryDescriptor>& binary_descriptors) {
+  CHECK_NOTNULL(view.get());
+  if (descriptor_extractor_.IsBinary()) {
+    CHECK_EQ(features.size(), binary_descriptors.size());
+    view->CreateAndAddObservations(features, binary_descriptors);
+  } else {
+    CHECK_EQ(features.size(), descriptors.size());
+    view->CreateAndAddObservations(features, descriptors);
+  }
+}
+
+bool KeyframeVisualOdometry::IncorporateObservation(
+    const Landmark::Ptr& track, const Observation::Ptr& observation) const {
+  CHECK_NOTNULL(track.get());
+  if (!options_.matcher_options.enforce_maximum_descriptor_distance) {
+    return track->IncorporateObservation(observation);
+  }
+
+  const double max_distance =
+      options_.matcher_options.maximum_descriptor_distance;
+  switch (metric_) {
+    case DistanceMetric::SCALED_L2:
+      return track->IncorporateObservation(observation, ScaledL2Metric(),
+                                           max_distance);
+    case DistanceMetric::HAMMING:
+      return track->IncorporateObservation(observation, HammingMetric(),
+                                           max_distance);
+    // No default to catch incompatible types at compile time.
+  }
+  return false;
+}
+
 unsigned int KeyframeVisualOdometry::NumEstimatedTracks() const {
   unsigned int estimated_count = 0;
   for (const auto& track_index : tracks_) {
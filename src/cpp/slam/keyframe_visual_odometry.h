@@ -48,6 +48,10 @@
 #ifndef BSFM_SLAM_KEYFRAME_VISUAL_ODOMETRY_H
 #define BSFM_SLAM_KEYFRAME_VISUAL_ODOMETRY_H
 
+#include <chrono>
+#include <set>
+
+#include "landmark_descriptor_store.h"
 #include "visual_odometry_annotator.h"
 #include "visual_odometry_options.h"
 
@@ -55,6 +59,7 @@
 #include "../image/image.h"
 #include "../matching/keypoint_detector.h"
 #include "../matching/descriptor_extractor.h"
+#include "../matching/optical_flow_tracker.h"
 #include "../sfm/view.h"
 #include "../util/disallow_copy_and_assign.h"
 #include "../util/status.h"
@@ -86,35 +91,80 @@ class KeyframeVisualOdometry {
  private:
   DISALLOW_COPY_AND_ASSIGN(KeyframeVisualOdometry)
 
-  // Create the very first view. This will not initialize any tracks yet.
-  void InitializeFirstView(const std::vector<Feature>& features,
-                           const std::vector<Descriptor>& descriptors);
+  // Create the very first view. This will not initialize any tracks yet. For
+  // binary descriptor types 'descriptors' is empty and 'binary_descriptors'
+  // holds one packed descriptor per feature, and vice versa.
+  void InitializeFirstView(
+      const std::vector<Feature>& features,
+      const std::vector<Descriptor>& descriptors,
+      const std::vector<BinaryDescriptor>& binary_descriptors);
 
   // Use 2D<-->2D matches to initialize the position of the second camera (which
   // will be a keyframe). If the view is successfully localized, new tracks will
   // be initialized.
-  Status InitializeSecondView(const std::vector<Feature>& features,
-                              const std::vector<Descriptor>& descriptors);
-
-  Status UpdateFeatureTracks(const std::vector<Feature>& features,
-                             const std::vector<Descriptor>& descriptors,
-                             ViewIndex view_index,
-                             bool is_keyframe);
+  Status InitializeSecondView(
+      const std::vector<Feature>& features,
+      const std::vector<Descriptor>& descriptors,
+      const std::vector<BinaryDescriptor>& binary_descriptors);
+
+  Status UpdateFeatureTracks(
+      const std::vector<Feature>& features,
+      const std::vector<Descriptor>& descriptors,
+      const std::vector<BinaryDescriptor>& binary_descriptors,
+      ViewIndex view_index, bool is_keyframe);
+
+  // Update the camera and landmark estimates between keyframes by tracking
+  // features from the last view into 'image' with optical flow, skipping
+  // feature detection and matching.
+  Status UpdateWithOpticalFlow(const Image& image);
+
+  // Track features observed in the last view into 'image', adding them to the
+  // view at 'view_index' as observations of their tracks.
+  Status TrackFeatures(const Image& image, ViewIndex view_index);
+
+  // Remove tracks that are not in 'matched_tracks' and have not been seen by
+  // any view in the sliding window.
+  void RemoveLostTracks(const std::set<LandmarkIndex>& matched_tracks);
+
+  // Add features and whichever descriptors were extracted to the view as
+  // observations.
+  void AddObservations(const View::Ptr& view,
+                       const std::vector<Feature>& features,
+                       const std::vector<Descriptor>& descriptors,
+                       const std::vector<BinaryDescriptor>& binary_descriptors);
 
   // Use 2D<-->3D matching against landmarks in the filter to determine the
   // camera's pose.
   Status EstimatePose(ViewIndex view_index);
 
+  // Remove observations in 'view_index' whose motion since the previous
+  // observation of their landmark is not supported by nearby observations.
+  void FilterByMotionStatistics(
+      ViewIndex view_index, std::vector<Observation::Ptr>* observations) const;
+
+  // Predict the pose of the next camera by applying the relative motion between
+  // the last two views to the last view. Returns false if there are fewer than
+  // two views.
+  bool PredictCamera(Camera* camera) const;
+
   // Detect keypoints from the input image. Returns false with an error status if
   // feature extraction fails. Non-const method because the detector is adaptive.
   Status GetKeypoints(const Image& image, std::vector<Keypoint>* keypoints);
 
   // Extract descriptors around the input keypoints. Non-const method because
-  // OpenCV's descriptor extractor is non-const.
+  // OpenCV's descriptor extractor is non-const. Binary descriptor types are
+  // packed into 'binary_descriptors', and all others go into 'descriptors'.
   Status GetDescriptors(const Image& image,
                         std::vector<Keypoint>* keypoints,
                         std::vector<Feature>* features,
-                        std::vector<Descriptor>* descriptors);
+                        std::vector<Descriptor>* descriptors,
+                        std::vector<BinaryDescriptor>* binary_descriptors);
+
+  // Add an observation to a track. If the matcher options enforce a maximum
+  // descriptor distance, the observation must also match with the track's
+  // descriptor under the chosen distance metric.
+  bool IncorporateObservation(const Landmark::Ptr& track,
+                              const Observation::Ptr& observation) const;
 
   // Return the number of feature tracks that have a triangulated 3D position.
   unsigned int NumEstimatedTracks() const;
@@ -146,6 +196,13 @@ class KeyframeVisualOdometry {
   // we can visualize the map after VO finishes.
   std::vector<LandmarkIndex> frozen_landmarks_;
 
+  // Normalized descriptors of all landmarks in 'tracks_', kept up to date as
+  // tracks are added, removed, and matched.
+  LandmarkDescriptorStore landmark_descriptors_;
+
+  // The distance metric named by the matcher options.
+  DistanceMetric::Metric metric_;
+
   // The index of the current keyframe.
   ViewIndex current_keyframe_;
 
@@ -158,6 +215,13 @@ class KeyframeVisualOdometry {
   KeypointDetector keypoint_detector_;
   DescriptorExtractor descriptor_extractor_;
 
+  // Optical flow tracker for tracking features between keyframes, holding the
+  // image of the last view.
+  OpticalFlowTracker flow_tracker_;
+
+  // The time by which pose estimation for the current frame must finish.
+  std::chrono::steady_clock::time_point frame_deadline_;
+
   // The name of the OpenCV window for drawing.
   const std::string window_name = "Keyframe Visual Odometry";
 
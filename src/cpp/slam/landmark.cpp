@@ -37,9 +37,11 @@
 
 #include "landmark.h"
 
+#include <limits>
 #include <numeric>
 
 #include "../geometry/rotation.h"
+#include "../matching/distance_metric.h"
 #include "../sfm/view.h"
 
 namespace bsfm {
@@ -47,6 +49,7 @@ namespace bsfm {
 // Declaration of static member variables.
 std::unordered_map<LandmarkIndex, Landmark::Ptr> Landmark::landmark_registry_;
 LandmarkIndex Landmark::current_landmark_index_ = 0;
+uint64_t Landmark::current_descriptor_version_ = 0;
 unsigned int Landmark::required_observations_ = 2;
 double Landmark::min_triangulation_angle_ = D2R(1.0);
 
@@ -127,6 +130,14 @@ void Landmark::SetPosition(const Point3D& position) {
 // Set the landmark's descriptor.
 void Landmark::SetDescriptor(const ::bsfm::Descriptor& descriptor) {
   descriptor_ = descriptor;
+  descriptor_is_normalized_ = ScaledL2Metric::IsNormalized(descriptor);
+  descriptor_version_ = NextDescriptorVersion();
+}
+
+// Set the landmark's binary descriptor.
+void Landmark::SetDescriptor(const ::bsfm::BinaryDescriptor& descriptor) {
+  binary_descriptor_ = descriptor;
+  descriptor_version_ = NextDescriptorVersion();
 }
 
 // Remove all existing observations of the landmark.
@@ -144,6 +155,25 @@ const ::bsfm::Descriptor& Landmark::Descriptor() const {
   return descriptor_;
 }
 
+// Get binary descriptor.
+const ::bsfm::BinaryDescriptor& Landmark::BinaryDescriptor() const {
+  return binary_descriptor_;
+}
+
+bool Landmark::HasBinaryDescriptor() const {
+  return !binary_descriptor_.Empty();
+}
+
+// Returns whether or not the floating point descriptor has unit length.
+bool Landmark::HasNormalizedDescriptor() const {
+  return descriptor_is_normalized_;
+}
+
+// Get the descriptor version.
+uint64_t Landmark::DescriptorVersion() const {
+  return descriptor_version_;
+}
+
 // Get observations.
 std::vector<Observation::Ptr>& Landmark::Observations() {
   return observations_;
@@ -177,34 +207,62 @@ double* Landmark::PositionData() {
   return position_.Get().data();
 }
 
-// Add a new observation of the landmark. The landmark's position will be
-// retriangulated from all observations of it.
-bool Landmark::IncorporateObservation(const Observation::Ptr& observation) {
+// Add a new observation of the landmark, if its descriptor matches with our own.
+template <typename Metric>
+bool Landmark::IncorporateObservation(const Observation::Ptr& observation,
+                                      const Metric& distance,
+                                      double max_distance) {
   CHECK_NOTNULL(observation.get());
 
   // Does the landmark descriptor match with the observation's descriptor?
-  if (!observations_.empty()) {
-    DistanceMetric& distance = DistanceMetric::Instance();
-    if (distance.Max() != std::numeric_limits<double>::max()) {
+  if (!observations_.empty() &&
+      max_distance != std::numeric_limits<double>::max()) {
+    double descriptor_distance = 0.0;
+    if (HasBinaryDescriptor() && observation->HasBinaryDescriptor()) {
+      descriptor_distance =
+          HammingMetric()(binary_descriptor_, observation->BinaryDescriptor());
+    } else if (!Metric::kNormalizes || (descriptor_is_normalized_ &&
+                                        observation->HasNormalizedDescriptor())) {
+      descriptor_distance = distance(descriptor_, observation->Descriptor());
+    } else {
       std::vector<::bsfm::Descriptor> descriptors;
       descriptors.push_back(descriptor_);
       descriptors.push_back(observation->Descriptor());
-      distance.MaybeNormalizeDescriptors(descriptors);
+      distance.NormalizeDescriptors(descriptors);
+      descriptor_distance = distance(descriptors[0], descriptors[1]);
+    }
 
-      if (distance(descriptors[0], descriptors[1]) > distance.Max()) {
-        VLOG(1) << "Observation was not matched to landmark "
-            << this->Index();
-        return false;
-      }
+    if (descriptor_distance > max_distance) {
+      VLOG(1) << "Observation was not matched to landmark "
+          << this->Index();
+      return false;
     }
   }
 
+  return IncorporateObservation(observation);
+}
+
+template bool Landmark::IncorporateObservation<ScaledL2Metric>(
+    const Observation::Ptr& observation, const ScaledL2Metric& distance,
+    double max_distance);
+template bool Landmark::IncorporateObservation<HammingMetric>(
+    const Observation::Ptr& observation, const HammingMetric& distance,
+    double max_distance);
+
+// Add a new observation of the landmark. The landmark's position will be
+// retriangulated from all observations of it.
+bool Landmark::IncorporateObservation(const Observation::Ptr& observation) {
+  CHECK_NOTNULL(observation.get());
+
   // If we don't have enough observations to triangulate the landmark yet,
   // continually store them until we do.
   if (observations_.size() < RequiredObservations() - 1) {
     observation->SetIncorporatedLandmark(this->Index());
     observations_.push_back(observation);
     descriptor_ = observation->Descriptor();
+    descriptor_is_normalized_ = observation->HasNormalizedDescriptor();
+    binary_descriptor_ = observation->BinaryDescriptor();
+    descriptor_version_ = NextDescriptorVersion();
     return true;
   }
 
@@ -233,6 +291,9 @@ bool Landmark::IncorporateObservation(const Observation::Ptr& observation) {
     observation->SetIncorporatedLandmark(this->Index());
     observations_.push_back(observation);
     descriptor_ = observation->Descriptor();
+    descriptor_is_normalized_ = observation->HasNormalizedDescriptor();
+    binary_descriptor_ = observation->BinaryDescriptor();
+    descriptor_version_ = NextDescriptorVersion();
 
     return false;
   }
@@ -246,6 +307,9 @@ bool Landmark::IncorporateObservation(const Observation::Ptr& observation) {
   observation->SetIncorporatedLandmark(this->Index());
   observations_.push_back(observation);
   descriptor_ = observation->Descriptor();
+  descriptor_is_normalized_ = observation->HasNormalizedDescriptor();
+  binary_descriptor_ = observation->BinaryDescriptor();
+  descriptor_version_ = NextDescriptorVersion();
 
   return is_estimated_;
 }
@@ -313,6 +377,8 @@ void Landmark::SetMinTriangulationAngle(double min_triangulation_angle) {
 Landmark::Landmark()
     : position_(Point3D(0.0, 0.0, 0.0)),
       landmark_index_(NextLandmarkIndex()),
+      descriptor_is_normalized_(false),
+      descriptor_version_(NextDescriptorVersion()),
       is_estimated_(false) {}
 
 // Static method for determining the next index across all Landmarks constructed
@@ -321,4 +387,10 @@ LandmarkIndex Landmark::NextLandmarkIndex() {
   return current_landmark_index_++;
 }
 
+// Static method for stamping descriptor changes. Versions are never reused, even
+// after landmarks are reset.
+uint64_t Landmark::NextDescriptorVersion() {
+  return current_descriptor_version_++;
+}
+
 }  //\namespace bsfm
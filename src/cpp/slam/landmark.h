@@ -47,6 +47,7 @@
 #define BSFM_SLAM_LANDMARK_H
 
 #include <Eigen/Core>
+#include <cstdint>
 #include <memory>
 #include <unordered_map>
 #include <utility>
@@ -107,15 +108,28 @@ class Landmark {
   // Setters.
   void SetPosition(const Point3D& position);
   void SetDescriptor(const ::bsfm::Descriptor& descriptor);
+  void SetDescriptor(const ::bsfm::BinaryDescriptor& descriptor);
   void ClearObservations();
 
   // Accessors.
   const Point3D& Position() const;
   const ::bsfm::Descriptor& Descriptor() const;
+  const ::bsfm::BinaryDescriptor& BinaryDescriptor() const;
+  bool HasBinaryDescriptor() const;
   std::vector<Observation::Ptr>& Observations();
   const std::vector<Observation::Ptr>& Observations() const;
   bool IsEstimated() const;
 
+  // Returns whether or not the floating point descriptor has unit length, as
+  // required by the SCALED_L2 metric. This is tracked as the descriptor is
+  // assigned, so that matchers do not need to normalize copies of it.
+  bool HasNormalizedDescriptor() const;
+
+  // Returns a stamp that changes every time the landmark's descriptor changes.
+  // Stamps are unique across all landmarks, so caches of landmark descriptors
+  // can use them to detect stale entries.
+  uint64_t DescriptorVersion() const;
+
   // Removes the observation originating from the provided view.
   void RemoveObservationFromView(ViewIndex view_index);
 
@@ -126,11 +140,19 @@ class Landmark {
 
   // Add a new observation of the landmark. The landmark's position will be
   // retriangulated from all observations of it if it has enough. This will
-  // return false if the observation's descriptor does not match with our own
-  // descriptor, or if we fail to retriangulate the landmark after incorporating
+  // return false if we fail to retriangulate the landmark after incorporating
   // the new observation.
   bool IncorporateObservation(const Observation::Ptr& observation);
 
+  // Same as above, but first checks that the observation's descriptor matches
+  // with our own descriptor, returning false if their distance under the metric
+  // functor 'distance' (ScaledL2Metric or HammingMetric) exceeds
+  // 'max_distance'. Packed binary descriptors are always compared with the
+  // Hamming distance.
+  template <typename Metric>
+  bool IncorporateObservation(const Observation::Ptr& observation,
+                              const Metric& distance, double max_distance);
+
   // Get the view that first saw this landmark.
   std::shared_ptr<View> SourceView() const;
 
@@ -164,6 +186,9 @@ class Landmark {
   // constructed so far. This is called in the Landmark constructor.
   static LandmarkIndex NextLandmarkIndex();
 
+  // Static method for stamping a descriptor change.
+  static uint64_t NextDescriptorVersion();
+
   // The landmark's 3D position.
   Point3D position_;
 
@@ -182,9 +207,22 @@ class Landmark {
   // first observation added to the landmark.
   ::bsfm::Descriptor descriptor_;
 
+  // Whether 'descriptor_' has unit length.
+  bool descriptor_is_normalized_;
+
+  // The packed binary descriptor associated with this 3D point, for binary
+  // descriptor types. Assigned in the same way as 'descriptor_'.
+  ::bsfm::BinaryDescriptor binary_descriptor_;
+
+  // Stamp of the most recent descriptor change.
+  uint64_t descriptor_version_;
+
   // The maximum index assigned to any landmark created so far.
   static LandmarkIndex current_landmark_index_;
 
+  // The next descriptor version stamp.
+  static uint64_t current_descriptor_version_;
+
   // True if the landmark has been triangulated.
   bool is_estimated_;
 
@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2015, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: Erik Nelson            ( eanelson@eecs.berkeley.edu )
+ *          David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+#include "landmark_descriptor_store.h"
+#include "landmark.h"
+
+#include <unordered_set>
+#include <utility>
+
+namespace bsfm {
+
+namespace {
+
+// Normalize the descriptors in 'slots' in place.
+void NormalizeSlots(const DistanceMetric& distance,
+                    const std::vector<size_t>& slots,
+                    std::vector<Descriptor>& descriptors) {
+  if (slots.empty())
+    return;
+
+  // Move descriptors out and back in to avoid copying them.
+  std::vector<Descriptor> dirty;
+  dirty.reserve(slots.size());
+  for (const auto& slot : slots)
+    dirty.push_back(std::move(descriptors[slot]));
+  distance.MaybeNormalizeDescriptors(dirty);
+  for (size_t ii = 0; ii < slots.size(); ++ii)
+    descriptors[slots[ii]] = std::move(dirty[ii]);
+}
+
+}  //\namespace
+
+LandmarkDescriptorStore::LandmarkDescriptorStore() {}
+
+LandmarkDescriptorStore::~LandmarkDescriptorStore() {}
+
+void LandmarkDescriptorStore::SetMetric(const std::string& metric) {
+  const DistanceMetric::Metric previous_metric = distance_.GetMetric();
+  distance_.SetMetric(metric);
+  if (distance_.GetMetric() != previous_metric)
+    Clear();
+}
+
+DistanceMetric::Metric LandmarkDescriptorStore::GetMetric() const {
+  return distance_.GetMetric();
+}
+
+void LandmarkDescriptorStore::Update(
+    const std::vector<LandmarkIndex>& landmark_indices) {
+  // Remove landmarks that are no longer listed. Iterate backwards so that the
+  // slots moved into removed positions have already been checked.
+  const std::unordered_set<LandmarkIndex> listed(landmark_indices.begin(),
+                                                 landmark_indices.end());
+  for (size_t ii = landmark_indices_.size(); ii-- > 0;) {
+    if (listed.count(landmark_indices_[ii]) == 0)
+      Remove(landmark_indices_[ii]);
+  }
+
+  // Store landmarks that are new or have changed.
+  std::vector<size_t> dirty_slots;
+  for (const auto& landmark_index : landmark_indices) {
+    const auto iter = slots_.find(landmark_index);
+    if (iter == slots_.end()) {
+      const size_t slot = landmark_indices_.size();
+      if (Store(landmark_index, slot))
+        dirty_slots.push_back(slot);
+      continue;
+    }
+
+    const Landmark::Ptr landmark = Landmark::GetLandmark(landmark_index);
+    CHECK_NOTNULL(landmark.get());
+    if (landmark->DescriptorVersion() != versions_[iter->second]) {
+      if (Store(landmark_index, iter->second))
+        dirty_slots.push_back(iter->second);
+    }
+  }
+
+  NormalizeSlots(distance_, dirty_slots, descriptors_);
+}
+
+void LandmarkDescriptorStore::Update(LandmarkIndex landmark_index) {
+  const auto iter = slots_.find(landmark_index);
+  const size_t slot =
+      (iter == slots_.end()) ? landmark_indices_.size() : iter->second;
+
+  const Landmark::Ptr landmark = Landmark::GetLandmark(landmark_index);
+  CHECK_NOTNULL(landmark.get());
+  if (slot < versions_.size() && landmark->DescriptorVersion() == versions_[slot])
+    return;
+
+  if (Store(landmark_index, slot))
+    NormalizeSlots(distance_, std::vector<size_t>(1, slot), descriptors_);
+}
+
+void LandmarkDescriptorStore::Remove(LandmarkIndex landmark_index) {
+  const auto iter = slots_.find(landmark_index);
+  if (iter == slots_.end())
+    return;
+
+  // Move the last slot into the removed one.
+  const size_t slot = iter->second;
+  const size_t last = landmark_indices_.size() - 1;
+  slots_.erase(iter);
+  if (slot != last) {
+    landmark_indices_[slot] = landmark_indices_[last];
+    descriptors_[slot] = std::move(descriptors_[last]);
+    binary_descriptors_[slot] = binary_descriptors_[last];
+    versions_[slot] = versions_[last];
+    slots_[landmark_indices_[slot]] = slot;
+  }
+
+  landmark_indices_.pop_back();
+  descriptors_.pop_back();
+  binary_descriptors_.pop_back();
+  versions_.pop_back();
+}
+
+void LandmarkDescriptorStore::Clear() {
+  landmark_indices_.clear();
+  descriptors_.clear();
+  binary_descriptors_.clear();
+  versions_.clear();
+  slots_.clear();
+}
+
+size_t LandmarkDescriptorStore::Size() const {
+  return landmark_indices_.size();
+}
+
+int LandmarkDescriptorStore::Slot(LandmarkIndex landmark_index) const {
+  const auto iter = slots_.find(landmark_index);
+  return (iter == slots_.end()) ? -1 : static_cast<int>(iter->second);
+}
+
+const std::vector<LandmarkIndex>& LandmarkDescriptorStore::LandmarkIndices()
+    const {
+  return landmark_indices_;
+}
+
+const std::vector<Descriptor>& LandmarkDescriptorStore::Descriptors() const {
+  return descriptors_;
+}
+
+const std::vector<BinaryDescriptor>&
+LandmarkDescriptorStore::BinaryDescriptors() const {
+  return binary_descriptors_;
+}
+
+bool LandmarkDescriptorStore::Store(LandmarkIndex landmark_index,
+                                    size_t slot) {
+  const Landmark::Ptr landmark = Landmark::GetLandmark(landmark_index);
+  CHECK_NOTNULL(landmark.get());
+
+  if (slot == landmark_indices_.size()) {
+    landmark_indices_.push_back(landmark_index);
+    descriptors_.push_back(landmark->Descriptor());
+    binary_descriptors_.push_back(landmark->BinaryDescriptor());
+    versions_.push_back(landmark->DescriptorVersion());
+    slots_[landmark_index] = slot;
+  } else {
+    CHECK_LT(slot, landmark_indices_.size());
+    CHECK_EQ(landmark_index, landmark_indices_[slot]);
+    descriptors_[slot] = landmark->Descriptor();
+    binary_descriptors_[slot] = landmark->BinaryDescriptor();
+    versions_[slot] = landmark->DescriptorVersion();
+  }
+
+  return !landmark->HasNormalizedDescriptor();
+}
+
+}  //\namespace bsfm
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2015, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: Erik Nelson            ( eanelson@eecs.berkeley.edu )
+ *          David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// The LandmarkDescriptorStore class keeps a persistent copy of the descriptors
+// of a set of landmarks, normalized for a distance metric and stored
+// contiguously, so that 2D<-->3D matching does not need to gather and
+// re-normalize every landmark descriptor each frame. The store is brought up to
+// date with Update(), which only copies descriptors of landmarks that are new
+// or whose descriptor has changed since they were last stored.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef BSFM_SLAM_LANDMARK_DESCRIPTOR_STORE_H
+#define BSFM_SLAM_LANDMARK_DESCRIPTOR_STORE_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../matching/binary_descriptor.h"
+#include "../matching/distance_metric.h"
+#include "../util/disallow_copy_and_assign.h"
+#include "../util/types.h"
+
+namespace bsfm {
+
+class LandmarkDescriptorStore {
+ public:
+  LandmarkDescriptorStore();
+  ~LandmarkDescriptorStore();
+
+  // Set the distance metric that descriptors are normalized for. Changing the
+  // metric empties the store.
+  void SetMetric(const std::string& metric);
+  DistanceMetric::Metric GetMetric() const;
+
+  // Make the store hold exactly the landmarks in 'landmark_indices'. Landmarks
+  // that are new or have changed descriptors are copied from the landmark
+  // registry, and landmarks that are not listed are removed.
+  void Update(const std::vector<LandmarkIndex>& landmark_indices);
+
+  // Add or refresh a single landmark, or remove it from the store.
+  void Update(LandmarkIndex landmark_index);
+  void Remove(LandmarkIndex landmark_index);
+
+  // Remove all landmarks.
+  void Clear();
+
+  // Number of stored landmarks.
+  size_t Size() const;
+
+  // Returns the position of a landmark in the arrays below, or -1 if it is not
+  // stored. Positions change when landmarks are removed.
+  int Slot(LandmarkIndex landmark_index) const;
+
+  // Stored landmarks and their descriptors, in slot order. Floating point
+  // descriptors are normalized for the distance metric. Binary descriptors are
+  // empty for landmarks that do not have one.
+  const std::vector<LandmarkIndex>& LandmarkIndices() const;
+  const std::vector<Descriptor>& Descriptors() const;
+  const std::vector<BinaryDescriptor>& BinaryDescriptors() const;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(LandmarkDescriptorStore)
+
+  // Copy a landmark's descriptors into a slot, appending a new slot if 'slot'
+  // is equal to Size(). Does not normalize. Returns false if the landmark's
+  // descriptor already has unit length, in which case it never needs to be
+  // normalized.
+  bool Store(LandmarkIndex landmark_index, size_t slot);
+
+  // Distance metric used to normalize descriptors.
+  DistanceMetric distance_;
+
+  // Per-slot landmark indices, descriptors, and the landmark's descriptor
+  // version at the time it was stored.
+  std::vector<LandmarkIndex> landmark_indices_;
+  std::vector<Descriptor> descriptors_;
+  std::vector<BinaryDescriptor> binary_descriptors_;
+  std::vector<uint64_t> versions_;
+
+  // Map from landmark index to slot.
+  std::unordered_map<LandmarkIndex, size_t> slots_;
+};  //\class LandmarkDescriptorStore
+
+}  //\namespace bsfm
+
+#endif
@@ -51,6 +51,15 @@ Observation::Ptr Observation::Create(const std::shared_ptr<View>& view_ptr,
   return observation;
 }
 
+// Factory method for observations with binary descriptors.
+Observation::Ptr Observation::Create(
+    const std::shared_ptr<View>& view_ptr, const ::bsfm::Feature& feature,
+    const ::bsfm::BinaryDescriptor& descriptor) {
+  Observation::Ptr observation(new Observation(view_ptr, feature, descriptor));
+  view_ptr->AddObservation(observation);
+  return observation;
+}
+
 Observation::~Observation() {}
 
 // Get the view that this observation was seen from.
@@ -91,10 +100,17 @@ LandmarkIndex Observation::GetLandmarkIndex() const {
 
 // Sets the landmark as a potential match for this observation. The observation
 // still has not been incorporated into the landmark.
-void Observation::SetMatchedLandmark(LandmarkIndex landmark_index) {
+void Observation::SetMatchedLandmark(LandmarkIndex landmark_index,
+                                     double match_distance) {
   CHECK_NE(kInvalidLandmark, landmark_index);
   landmark_index_ = landmark_index;
   is_matched_ = true;
+  match_distance_ = match_distance;
+}
+
+// Get the descriptor distance of the match set by SetMatchedLandmark().
+double Observation::MatchDistance() const {
+  return match_distance_;
 }
 
 // Returns whether or not the observation has been matched with a landmark. If
@@ -134,6 +150,21 @@ const ::bsfm::Descriptor& Observation::Descriptor() const {
   return descriptor_;
 }
 
+// Get the packed binary descriptor corresponding to this observation's feature.
+const ::bsfm::BinaryDescriptor& Observation::BinaryDescriptor() const {
+  return binary_descriptor_;
+}
+
+// Returns whether or not this observation carries a binary descriptor.
+bool Observation::HasBinaryDescriptor() const {
+  return !binary_descriptor_.Empty();
+}
+
+// Returns whether or not the floating point descriptor has unit length.
+bool Observation::HasNormalizedDescriptor() const {
+  return descriptor_is_normalized_;
+}
+
 // Constructor is private to enforce usage of factory method. Initialize an
 // observation with the view that it came from, an image-space feature
 // coordinate pair, and an associated descriptor. Implicitly initializes the
@@ -144,12 +175,28 @@ Observation::Observation(const View::Ptr& view_ptr,
                          const ::bsfm::Descriptor& descriptor)
     : landmark_index_(kInvalidLandmark),
       is_matched_(false),
+      match_distance_(0.0),
       is_incorporated_(false),
       feature_(feature),
-      descriptor_(descriptor) {
+      descriptor_(descriptor),
+      descriptor_is_normalized_(ScaledL2Metric::IsNormalized(descriptor)) {
   // Store the view's index to access it later.
   CHECK_NOTNULL(view_ptr.get());
   view_index_ = view_ptr->Index();
 }
 
+Observation::Observation(const View::Ptr& view_ptr,
+                         const ::bsfm::Feature& feature,
+                         const ::bsfm::BinaryDescriptor& descriptor)
+    : landmark_index_(kInvalidLandmark),
+      is_matched_(false),
+      match_distance_(0.0),
+      is_incorporated_(false),
+      feature_(feature),
+      descriptor_is_normalized_(false),
+      binary_descriptor_(descriptor) {
+  CHECK_NOTNULL(view_ptr.get());
+  view_index_ = view_ptr->Index();
+}
+
 }  //\namespace bsfm
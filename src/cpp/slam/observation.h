@@ -51,6 +51,7 @@
 #include <glog/logging.h>
 #include <memory>
 
+#include "../matching/binary_descriptor.h"
 #include "../matching/distance_metric.h"
 #include "../matching/feature.h"
 #include "../util/types.h"
@@ -71,6 +72,12 @@ class Observation {
   static Observation::Ptr Create(const std::shared_ptr<View>& view_ptr,
                                  const ::bsfm::Feature& feature,
                                  const ::bsfm::Descriptor& descriptor);
+
+  // Factory method for observations with a packed binary descriptor. The
+  // floating point descriptor of such an observation is left empty.
+  static Observation::Ptr Create(const std::shared_ptr<View>& view_ptr,
+                                 const ::bsfm::Feature& feature,
+                                 const ::bsfm::BinaryDescriptor& descriptor);
   ~Observation();
 
   // Get the view that this observation was seen from.
@@ -88,8 +95,13 @@ class Observation {
   LandmarkIndex GetLandmarkIndex() const;
 
   // Sets a landmark as a potential match for this observation. The observation
-  // has still not been incorporated into the landmark.
-  void SetMatchedLandmark(LandmarkIndex landmark_index);
+  // has still not been incorporated into the landmark. 'match_distance' is the
+  // descriptor distance between the observation and the landmark, if known.
+  void SetMatchedLandmark(LandmarkIndex landmark_index,
+                          double match_distance = 0.0);
+
+  // Get the descriptor distance of the match set by SetMatchedLandmark().
+  double MatchDistance() const;
 
   // Returns whether or not the observation has been matched with a landmark. If
   // this returns false, 'GetLandmark()' will return a null pointer.
@@ -112,6 +124,18 @@ class Observation {
   // Get the descriptor corresponding to this observation's feature.
   const ::bsfm::Descriptor& Descriptor() const;
 
+  // Get the packed binary descriptor corresponding to this observation's
+  // feature. Empty unless the observation was created with one.
+  const ::bsfm::BinaryDescriptor& BinaryDescriptor() const;
+
+  // Returns whether or not this observation carries a binary descriptor.
+  bool HasBinaryDescriptor() const;
+
+  // Returns whether or not the floating point descriptor has unit length, as
+  // required by the SCALED_L2 metric. This is checked once on construction, so
+  // that matchers do not need to normalize copies of the descriptor.
+  bool HasNormalizedDescriptor() const;
+
  private:
   // No default constructor.
   Observation();
@@ -124,6 +148,9 @@ class Observation {
   Observation(const std::shared_ptr<View>& view_ptr,
               const ::bsfm::Feature& feature,
               const ::bsfm::Descriptor& descriptor);
+  Observation(const std::shared_ptr<View>& view_ptr,
+              const ::bsfm::Feature& feature,
+              const ::bsfm::BinaryDescriptor& descriptor);
 
   // The index corresponding to the view that this feature was observed from.
   ViewIndex view_index_;
@@ -136,6 +163,9 @@ class Observation {
   // been matched with a 3D point landmark.
   bool is_matched_;
 
+  // Descriptor distance between this observation and its matched landmark.
+  double match_distance_;
+
   // A boolean flag describing whether or not this observation of a feature has
   // been incorporated into its landmark, and used to triangulate that
   // landmark's position.
@@ -146,6 +176,13 @@ class Observation {
 
   // A descriptor associated with the feature.
   ::bsfm::Descriptor descriptor_;
+
+  // Whether 'descriptor_' has unit length.
+  bool descriptor_is_normalized_;
+
+  // A packed binary descriptor associated with the feature, used in place of
+  // 'descriptor_' for binary descriptor types.
+  ::bsfm::BinaryDescriptor binary_descriptor_;
 };  //\class Observation
 
 }  //\namespace bsfm
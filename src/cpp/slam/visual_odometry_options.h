@@ -109,6 +109,34 @@ struct VisualOdometryOptions {
   // The minimum rotation (on any axis) needed to initialize a new keyframe.
   double min_keyframe_rotation = 10.0 * 3.1415926535/ 180.0;
 
+  // Predict the pose of each new camera from the motion between the previous
+  // two cameras (a constant velocity model), and match estimated landmarks only
+  // against features within 'motion_model_search_radius' pixels of their
+  // projection into the predicted camera. Landmarks that have not been
+  // estimated yet are matched as usual, against the position of their most
+  // recent observation.
+  bool use_motion_model = false;
+  double motion_model_search_radius = 15.0;
+
+  // Track features between keyframes with pyramidal Lucas-Kanade optical flow
+  // instead of detecting, describing, and matching features in every image.
+  // Features are only detected and matched at keyframes. Tracking uses a
+  // 'optical_flow_window_size' pixel square patch at each of
+  // 'optical_flow_pyramid_levels' pyramid levels above full resolution, and
+  // discards features that do not return within 'optical_flow_max_error'
+  // pixels of their starting point when tracked back into the previous image
+  // (this check is skipped if the error is not positive).
+  bool use_optical_flow = false;
+  unsigned int optical_flow_window_size = 21;
+  unsigned int optical_flow_pyramid_levels = 3;
+  double optical_flow_max_error = 1.0;
+
+  // If greater than zero, PnP RANSAC stops this many seconds after Update() is
+  // called for a frame, and estimates the camera pose from the best model found
+  // by then. Enable 'pnp_ransac_options.preemptive' to make sure that model has
+  // been scored against the data when time runs out.
+  double max_frame_time = 0.0;
+
   // ---------------------- DRAWING OPTIONS ---------------------- //
   // If any of the drawing features below are enabled, an OpenCV window will be
   // displayed with the selected options overlaid on the current frame.
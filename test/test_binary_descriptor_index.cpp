@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2015, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: Erik Nelson            ( eanelson@eecs.berkeley.edu )
+ *          David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include <matching/binary_descriptor.h>
+#include <matching/binary_descriptor_index.h>
+#include <matching/hamming_distance.h>
+#include <math/random_generator.h>
+
+#include <gtest/gtest.h>
+
+namespace bsfm {
+
+namespace {
+
+math::RandomGenerator rng(0);
+
+// Make a random binary descriptor with the given number of bytes.
+BinaryDescriptor RandomBinaryDescriptor(size_t num_bytes) {
+  unsigned char bytes[BinaryDescriptor::kMaxBytes];
+  for (size_t ii = 0; ii < num_bytes; ++ii)
+    bytes[ii] = static_cast<unsigned char>(rng.IntegerUniform(0, 255));
+  return BinaryDescriptor(bytes, num_bytes);
+}
+
+// Copy a descriptor and flip up to 'num_flips' random bits.
+BinaryDescriptor Perturb(const BinaryDescriptor& descriptor, int num_flips) {
+  unsigned char bytes[BinaryDescriptor::kMaxBytes];
+  std::copy(descriptor.Data(), descriptor.Data() + descriptor.Bytes(), bytes);
+  for (int ii = 0; ii < num_flips; ++ii) {
+    const int bit = rng.IntegerUniform(0, descriptor.Bits() - 1);
+    bytes[bit / 8] ^= 1 << (bit % 8);
+  }
+  return BinaryDescriptor(bytes, descriptor.Bytes());
+}
+
+// Make clusters of nearby descriptors, as with repeated observations of the
+// same landmark.
+std::vector<BinaryDescriptor> ClusteredDescriptors(size_t num_bytes,
+                                                   int num_clusters,
+                                                   int cluster_size) {
+  std::vector<BinaryDescriptor> descriptors;
+  for (int ii = 0; ii < num_clusters; ++ii) {
+    const BinaryDescriptor center = RandomBinaryDescriptor(num_bytes);
+    for (int jj = 0; jj < cluster_size; ++jj)
+      descriptors.push_back(Perturb(center, 20));
+  }
+  return descriptors;
+}
+
+// Sorted (distance, index) pairs for every descriptor, by brute force.
+std::vector<std::pair<int, int> > BruteForce(
+    const BinaryDescriptor& query,
+    const std::vector<BinaryDescriptor>& descriptors) {
+  std::vector<std::pair<int, int> > neighbors;
+  for (size_t ii = 0; ii < descriptors.size(); ++ii)
+    neighbors.push_back(
+        std::make_pair(HammingDistance(query, descriptors[ii]), ii));
+  std::sort(neighbors.begin(), neighbors.end());
+  return neighbors;
+}
+
+}  //\namespace
+
+TEST(BinaryDescriptorIndex, TestKNearestNeighbors) {
+  const unsigned int kSubstringBits[] = {8, 16, 32};
+  for (const unsigned int substring_bits : kSubstringBits) {
+    const std::vector<BinaryDescriptor> descriptors =
+        ClusteredDescriptors(32, 200, 10);
+
+    // Add descriptors in two batches to check incremental insertion.
+    BinaryDescriptorIndex index(substring_bits);
+    index.AddDescriptors(std::vector<BinaryDescriptor>(
+        descriptors.begin(), descriptors.begin() + 1000));
+    index.AddDescriptors(std::vector<BinaryDescriptor>(
+        descriptors.begin() + 1000, descriptors.end()));
+    EXPECT_EQ(descriptors.size(), index.Size());
+
+    // Query with both noisy copies of indexed descriptors and random
+    // descriptors that are far from everything.
+    for (int ii = 0; ii < 50; ++ii) {
+      const BinaryDescriptor query =
+          (ii % 2 == 0) ? Perturb(descriptors[ii * 37], 10)
+                        : RandomBinaryDescriptor(32);
+      const std::vector<std::pair<int, int> > expected =
+          BruteForce(query, descriptors);
+
+      std::vector<int> nn_indices, nn_distances;
+      index.KNearestNeighbors(query, 5, nn_indices, nn_distances);
+      ASSERT_EQ(5u, nn_indices.size());
+      ASSERT_EQ(5u, nn_distances.size());
+      for (size_t jj = 0; jj < nn_indices.size(); ++jj) {
+        EXPECT_EQ(expected[jj].first, nn_distances[jj]);
+        EXPECT_EQ(expected[jj].second, nn_indices[jj]);
+      }
+
+      int nn_index = -1, nn_distance = -1;
+      EXPECT_TRUE(index.NearestNeighbor(query, nn_index, nn_distance));
+      EXPECT_EQ(expected[0].second, nn_index);
+      EXPECT_EQ(expected[0].first, nn_distance);
+    }
+  }
+}
+
+TEST(BinaryDescriptorIndex, TestRadiusSearch) {
+  const std::vector<BinaryDescriptor> descriptors =
+      ClusteredDescriptors(64, 100, 10);
+  BinaryDescriptorIndex index;
+  index.AddDescriptors(descriptors);
+
+  const int kRadii[] = {0, 30, 60, 200};
+  for (const int radius : kRadii) {
+    for (int ii = 0; ii < 20; ++ii) {
+      const BinaryDescriptor query = Perturb(descriptors[ii * 47], 5);
+      const std::vector<std::pair<int, int> > all =
+          BruteForce(query, descriptors);
+
+      std::vector<int> nn_indices, nn_distances;
+      index.RadiusSearch(query, radius, nn_indices, nn_distances);
+      ASSERT_EQ(nn_indices.size(), nn_distances.size());
+
+      size_t num_expected = 0;
+      while (num_expected < all.size() && all[num_expected].first <= radius)
+        ++num_expected;
+      ASSERT_EQ(num_expected, nn_indices.size());
+      for (size_t jj = 0; jj < num_expected; ++jj) {
+        EXPECT_EQ(all[jj].first, nn_distances[jj]);
+        EXPECT_EQ(all[jj].second, nn_indices[jj]);
+      }
+    }
+  }
+}
+
+TEST(BinaryDescriptorIndex, TestEmpty) {
+  BinaryDescriptorIndex index;
+  std::vector<int> nn_indices, nn_distances;
+  index.KNearestNeighbors(RandomBinaryDescriptor(32), 2, nn_indices,
+                          nn_distances);
+  EXPECT_TRUE(nn_indices.empty());
+
+  int nn_index, nn_distance;
+  EXPECT_FALSE(index.NearestNeighbor(RandomBinaryDescriptor(32), nn_index,
+                                     nn_distance));
+}
+
+}  //\namespace bsfm
@@ -40,6 +40,8 @@
 #include <util/types.h>
 
 #include <Eigen/Core>
+#include <bitset>
+#include <limits>
 #include <gtest/gtest.h>
 
 namespace bsfm {
@@ -55,7 +57,7 @@ namespace bsfm {
 
 TEST(DistanceMetric, TestSymmetryScaledL2) {
   // Set the distance metric type.
-  DistanceMetric& distance = DistanceMetric::Instance();
+  DistanceMetric distance;
   distance.SetMetric(DistanceMetric::Metric::SCALED_L2);
 
   Descriptor descriptor1(64);
@@ -72,7 +74,7 @@ TEST(DistanceMetric, TestSymmetryScaledL2) {
 
 TEST(DistanceMetric, TestPositiveDefinitenessScaledL2) {
   // Set the distance metric type.
-  DistanceMetric& distance = DistanceMetric::Instance();
+  DistanceMetric distance;
   distance.SetMetric(DistanceMetric::Metric::SCALED_L2);
 
   Descriptor descriptor1(64);
@@ -86,7 +88,7 @@ TEST(DistanceMetric, TestPositiveDefinitenessScaledL2) {
 
 TEST(DistanceMetric, TestValueScaledL2) {
   // Set the distance metric type.
-  DistanceMetric& distance = DistanceMetric::Instance();
+  DistanceMetric distance;
   distance.SetMetric(DistanceMetric::Metric::SCALED_L2);
 
   Descriptor descriptor1(64);
@@ -105,7 +107,7 @@ TEST(DistanceMetric, TestValueScaledL2) {
 // distance when they match exactly.
 TEST(DistanceMetric, TestSymmetryHamming) {
   // Set the distance metric type.
-  DistanceMetric& distance = DistanceMetric::Instance();
+  DistanceMetric distance;
   distance.SetMetric(DistanceMetric::Metric::HAMMING);
 
   Descriptor descriptor1(32);
@@ -122,7 +124,7 @@ TEST(DistanceMetric, TestSymmetryHamming) {
 
 TEST(DistanceMetric, TestValueHamming) {
   // Set the distance metric type.
-  DistanceMetric& distance = DistanceMetric::Instance();
+  DistanceMetric distance;
   distance.SetMetric(DistanceMetric::Metric::HAMMING);
 
   Descriptor descriptor1(32);
@@ -135,7 +137,7 @@ TEST(DistanceMetric, TestValueHamming) {
     for (int jj = 0; jj < 32; ++jj) {
       unsigned char d1 = static_cast<unsigned char>(descriptor1(jj));
       unsigned char d2 = static_cast<unsigned char>(descriptor2(jj));
-      expected_dist += d1 ^ d2;
+      expected_dist += std::bitset<8>(d1 ^ d2).count();
     }
     EXPECT_EQ(expected_dist, distance(descriptor1, descriptor2));
   }
@@ -153,4 +155,88 @@ TEST(DistanceMetric, TestValueHamming) {
   EXPECT_EQ(0, distance(descriptor1, descriptor2));
 }
 
+TEST(DistanceMetric, TestValueHammingBinary) {
+  // Set the distance metric type.
+  DistanceMetric distance;
+  distance.SetMetric(DistanceMetric::Metric::HAMMING);
+
+  // Packed descriptors should give the same distance as unpacked ones.
+  Descriptor descriptor1(32);
+  Descriptor descriptor2(32);
+  for (int ii = 0; ii < 1000; ++ii) {
+    descriptor1.setRandom();
+    descriptor2.setRandom();
+
+    const BinaryDescriptor binary1 = BinaryDescriptor::FromDescriptor(descriptor1);
+    const BinaryDescriptor binary2 = BinaryDescriptor::FromDescriptor(descriptor2);
+    EXPECT_EQ(distance(descriptor1, descriptor2), distance(binary1, binary2));
+  }
+}
+
+TEST(DistanceMetric, TestMetricFunctors) {
+  // Compile-time metrics should give the same distances as the run-time metric.
+  DistanceMetric distance;
+  ScaledL2Metric scaled_l2;
+  HammingMetric hamming;
+
+  Descriptor descriptor1(32);
+  Descriptor descriptor2(32);
+  for (int ii = 0; ii < 100; ++ii) {
+    descriptor1 = Descriptor::Random(32).normalized();
+    descriptor2 = Descriptor::Random(32).normalized();
+    distance.SetMetric(ScaledL2Metric::kMetric);
+    EXPECT_EQ(distance(descriptor1, descriptor2),
+              scaled_l2(descriptor1, descriptor2));
+
+    descriptor1 = (128.0 * (descriptor1.array() + 1.0)).floor().matrix();
+    descriptor2 = (128.0 * (descriptor2.array() + 1.0)).floor().matrix();
+    distance.SetMetric(HammingMetric::kMetric);
+    EXPECT_EQ(distance(descriptor1, descriptor2),
+              hamming(descriptor1, descriptor2));
+    EXPECT_EQ(distance(descriptor1, descriptor2),
+              hamming(BinaryDescriptor::FromDescriptor(descriptor1),
+                      BinaryDescriptor::FromDescriptor(descriptor2)));
+  }
+
+  // Metric names are parsed once into a metric.
+  EXPECT_EQ(DistanceMetric::SCALED_L2, DistanceMetric::Parse("SCALED_L2"));
+  EXPECT_EQ(DistanceMetric::HAMMING, DistanceMetric::Parse("HAMMING"));
+}
+
+TEST(DistanceMetric, TestBounded) {
+  // Bounded distances must be exact below the bound, and no smaller than the
+  // bound otherwise.
+  DistanceMetric distance;
+  const DistanceMetric::Metric kMetrics[] = {DistanceMetric::Metric::SCALED_L2,
+                                             DistanceMetric::Metric::HAMMING};
+  for (const auto& metric : kMetrics) {
+    distance.SetMetric(metric);
+
+    Descriptor descriptor1(128);
+    Descriptor descriptor2(128);
+    for (int ii = 0; ii < 1000; ++ii) {
+      descriptor1.setRandom();
+      descriptor2.setRandom();
+      if (metric == DistanceMetric::Metric::SCALED_L2) {
+        descriptor1.normalize();
+        descriptor2.normalize();
+      } else {
+        descriptor1 = (128.0 * (descriptor1.array() + 1.0)).floor().matrix();
+        descriptor2 = (128.0 * (descriptor2.array() + 1.0)).floor().matrix();
+      }
+
+      const double exact = distance(descriptor1, descriptor2);
+      const double kBounds[] = {0.0, 0.5 * exact, exact, exact + 1.0,
+                                std::numeric_limits<double>::max()};
+      for (const double bound : kBounds) {
+        const double bounded = distance.Bounded(descriptor1, descriptor2, bound);
+        if (exact < bound)
+          EXPECT_EQ(exact, bounded);
+        else
+          EXPECT_LE(bound, bounded);
+      }
+    }
+  }
+}
+
 }  //\namespace bsfm
@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2015, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: Erik Nelson            ( eanelson@eecs.berkeley.edu )
+ *          David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+#include <limits>
+#include <vector>
+
+#include <matching/descriptor_matrix.h>
+#include <matching/distance_metric.h>
+#include <matching/dot_product_matcher.h>
+#include <matching/feature_matcher_options.h>
+#include <matching/two_nearest_neighbors.h>
+#include <util/types.h>
+
+#include <gtest/gtest.h>
+
+namespace bsfm {
+
+namespace {
+
+// Make a list of random normalized descriptors.
+std::vector<Descriptor> RandomDescriptors(size_t count, int length) {
+  std::vector<Descriptor> descriptors;
+  for (size_t ii = 0; ii < count; ++ii)
+    descriptors.push_back(Descriptor::Random(length).normalized());
+  return descriptors;
+}
+
+}  //\namespace
+
+TEST(DescriptorMatrix, TestGetBlock) {
+  const std::vector<Descriptor> descriptors = RandomDescriptors(50, 128);
+
+  DescriptorMatrix matrix;
+  matrix.SetDescriptors(descriptors);
+  EXPECT_EQ(50u, matrix.Rows());
+  EXPECT_EQ(128u, matrix.Cols());
+
+  RowMatrixXf block;
+  matrix.GetBlock(10, 20, block);
+  EXPECT_EQ(20, block.rows());
+  for (int ii = 0; ii < 20; ++ii)
+    for (int jj = 0; jj < 128; ++jj)
+      EXPECT_NEAR(descriptors[10 + ii](jj), block(ii, jj), 1e-6);
+
+  // Quantized descriptors should be within half a quantization step.
+  DescriptorMatrix quantized;
+  quantized.SetDescriptors(descriptors, true /*quantize*/);
+  EXPECT_TRUE(quantized.IsQuantized());
+  quantized.GetBlock(0, 50, block);
+  for (int ii = 0; ii < 50; ++ii) {
+    const double step = descriptors[ii].cwiseAbs().maxCoeff() / 127.0;
+    for (int jj = 0; jj < 128; ++jj)
+      EXPECT_NEAR(descriptors[ii](jj), block(ii, jj), 0.5 * step + 1e-6);
+  }
+}
+
+TEST(DotProductMatcher, TestMatchesBruteForce) {
+  DistanceMetric distance;
+  distance.SetMetric(DistanceMetric::Metric::SCALED_L2);
+
+  const std::vector<Descriptor> query = RandomDescriptors(300, 64);
+  const std::vector<Descriptor> train = RandomDescriptors(700, 64);
+
+  DescriptorMatrix query_matrix, train_matrix;
+  query_matrix.SetDescriptors(query);
+  train_matrix.SetDescriptors(train);
+
+  // Use small blocks so that queries and train rows span several of them.
+  std::vector<TwoNearestNeighbors> neighbors;
+  FindTwoNearestNeighbors(query_matrix, train_matrix, neighbors, 64, 128);
+  ASSERT_EQ(query.size(), neighbors.size());
+
+  for (size_t ii = 0; ii < query.size(); ++ii) {
+    double best = std::numeric_limits<double>::max();
+    double second = std::numeric_limits<double>::max();
+    for (size_t jj = 0; jj < train.size(); ++jj) {
+      const double d = distance(query[ii], train[jj]);
+      if (d < best) {
+        second = best;
+        best = d;
+      } else if (d < second) {
+        second = d;
+      }
+    }
+
+    // Compare distances rather than indices, since single precision may swap
+    // near-ties.
+    EXPECT_NEAR(best, neighbors[ii].best_distance_, 1e-5);
+    EXPECT_NEAR(second, neighbors[ii].second_distance_, 1e-5);
+    EXPECT_NEAR(distance(query[ii], train[neighbors[ii].best_index_]),
+                neighbors[ii].best_distance_, 1e-5);
+  }
+}
+
+TEST(DotProductMatcher, TestSingleTrainRow) {
+  const std::vector<Descriptor> query = RandomDescriptors(10, 32);
+  const std::vector<Descriptor> train = RandomDescriptors(1, 32);
+
+  DescriptorMatrix query_matrix, train_matrix;
+  query_matrix.SetDescriptors(query);
+  train_matrix.SetDescriptors(train);
+
+  std::vector<TwoNearestNeighbors> neighbors;
+  FindTwoNearestNeighbors(query_matrix, train_matrix, neighbors);
+  for (const auto& nn : neighbors) {
+    EXPECT_EQ(0, nn.best_index_);
+    EXPECT_EQ(-1, nn.second_index_);
+  }
+}
+
+TEST(DotProductMatcher, TestMutualNeighbors) {
+  const std::vector<Descriptor> descriptors1 = RandomDescriptors(200, 32);
+  const std::vector<Descriptor> descriptors2 = RandomDescriptors(300, 32);
+
+  DescriptorMatrix matrix1, matrix2;
+  matrix1.SetDescriptors(descriptors1);
+  matrix2.SetDescriptors(descriptors2);
+
+  // A single mutual pass must agree with searching in both directions.
+  std::vector<TwoNearestNeighbors> forward, reverse, neighbors1, neighbors2;
+  FindTwoNearestNeighbors(matrix1, matrix2, forward, 64, 128);
+  FindTwoNearestNeighbors(matrix2, matrix1, reverse, 64, 128);
+  FindMutualTwoNearestNeighbors(matrix1, matrix2, neighbors1, neighbors2, 64,
+                                128);
+  ASSERT_EQ(forward.size(), neighbors1.size());
+  ASSERT_EQ(reverse.size(), neighbors2.size());
+  for (size_t ii = 0; ii < forward.size(); ++ii) {
+    EXPECT_EQ(forward[ii].best_index_, neighbors1[ii].best_index_);
+    EXPECT_EQ(forward[ii].second_index_, neighbors1[ii].second_index_);
+  }
+  for (size_t ii = 0; ii < reverse.size(); ++ii) {
+    EXPECT_EQ(reverse[ii].best_index_, neighbors2[ii].best_index_);
+    EXPECT_EQ(reverse[ii].second_index_, neighbors2[ii].second_index_);
+  }
+
+  // Mutual matches are the symmetric subset of one-way matches.
+  FeatureMatcherOptions options;
+  const double kMaxDistance = std::numeric_limits<double>::max();
+  std::vector<LightFeatureMatch> forward_matches, reverse_matches, mutual;
+  OneWayMatches(forward, kMaxDistance, options, forward_matches);
+  OneWayMatches(reverse, kMaxDistance, options, reverse_matches);
+  MutualMatches(neighbors1, neighbors2, kMaxDistance, options, mutual);
+
+  std::vector<LightFeatureMatch> expected;
+  for (const auto& match : forward_matches) {
+    for (const auto& reverse_match : reverse_matches) {
+      if (reverse_match.feature_index1_ == match.feature_index2_ &&
+          reverse_match.feature_index2_ == match.feature_index1_)
+        expected.push_back(match);
+    }
+  }
+  ASSERT_EQ(expected.size(), mutual.size());
+  for (size_t ii = 0; ii < expected.size(); ++ii) {
+    EXPECT_EQ(expected[ii].feature_index1_, mutual[ii].feature_index1_);
+    EXPECT_EQ(expected[ii].feature_index2_, mutual[ii].feature_index2_);
+  }
+}
+
+}  //\namespace bsfm
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2015, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: Erik Nelson            ( eanelson@eecs.berkeley.edu )
+ *          David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include <matching/feature.h>
+#include <matching/feature_grid.h>
+#include <math/random_generator.h>
+
+#include <gtest/gtest.h>
+
+namespace bsfm {
+
+TEST(FeatureGrid, TestNeighborsContainAllNearbyFeatures) {
+  math::RandomGenerator rng(0);
+
+  std::vector<Feature> features;
+  for (int ii = 0; ii < 1000; ++ii)
+    features.push_back(Feature(rng.DoubleUniform(0.0, 1242.0),
+                               rng.DoubleUniform(0.0, 375.0)));
+
+  const double radius = 30.0;
+  FeatureGrid grid;
+  grid.Build(features, radius);
+
+  std::vector<int> neighbors;
+  for (int ii = 0; ii < 100; ++ii) {
+    const Feature query(rng.DoubleUniform(-50.0, 1300.0),
+                        rng.DoubleUniform(-50.0, 425.0));
+    grid.GetNeighbors(query, neighbors);
+    EXPECT_TRUE(std::is_sorted(neighbors.begin(), neighbors.end()));
+
+    // Every feature within the radius must be returned, and far fewer than all
+    // features should be returned.
+    for (size_t jj = 0; jj < features.size(); ++jj) {
+      const double du = query.u_ - features[jj].u_;
+      const double dv = query.v_ - features[jj].v_;
+      if (std::sqrt(du*du + dv*dv) <= radius) {
+        EXPECT_TRUE(std::binary_search(neighbors.begin(), neighbors.end(),
+                                       static_cast<int>(jj)));
+      }
+    }
+    EXPECT_LT(neighbors.size(), features.size() / 4);
+  }
+}
+
+TEST(FeatureGrid, TestFeaturesAtInfinityAreIgnored) {
+  std::vector<Feature> features;
+  features.push_back(Feature(10.0, 10.0));
+  features.push_back(Feature(std::numeric_limits<double>::max(),
+                             std::numeric_limits<double>::max()));
+  features.push_back(Feature(20.0, 10.0));
+
+  FeatureGrid grid;
+  grid.Build(features, 30.0);
+
+  std::vector<int> neighbors;
+  grid.GetNeighbors(Feature(15.0, 10.0), neighbors);
+  ASSERT_EQ(2u, neighbors.size());
+  EXPECT_EQ(0, neighbors[0]);
+  EXPECT_EQ(2, neighbors[1]);
+
+  // Queries at infinity have no neighbors.
+  grid.GetNeighbors(features[1], neighbors);
+  EXPECT_TRUE(neighbors.empty());
+}
+
+}  //\namespace bsfm
@@ -35,8 +35,11 @@
  *          David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
  */
 
+#include <algorithm>
 #include <limits>
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include <gflags/gflags.h>
 #include <sfm/flann_descriptor_kdtree.h>
@@ -86,7 +89,55 @@ TEST(FlannDescriptorKDTree, TestFlannDescriptorKDTree) {
   }
 
   EXPECT_EQ(min_distance_index, nn_index);
-  EXPECT_NEAR(min_distance, nn_distance, 1e-8);
+  // Descriptors are stored in single precision.
+  EXPECT_NEAR(min_distance, nn_distance, 1e-4);
+}
+
+TEST(FlannDescriptorKDTree, TestKNearestNeighbors) {
+  // Build the kd tree in one batch.
+  std::vector<Descriptor> descriptors;
+  for (int ii = 0; ii < 1000; ++ii)
+    descriptors.push_back(Descriptor::Random(32));
+  FlannDescriptorKDTree descriptor_kdtree;
+  descriptor_kdtree.AddDescriptors(descriptors);
+  EXPECT_EQ(descriptors.size(), descriptor_kdtree.Size());
+
+  std::vector<Descriptor> queries;
+  for (int ii = 0; ii < 100; ++ii)
+    queries.push_back(Descriptor::Random(32));
+
+  // Exact search, split across threads, must find the two nearest neighbors.
+  const unsigned int kNumThreads = 4;
+  std::vector<std::vector<int> > nn_indices;
+  std::vector<std::vector<double> > nn_distances;
+  EXPECT_TRUE(descriptor_kdtree.KNearestNeighbors(queries, 2, nn_indices,
+                                                  nn_distances, kNumThreads));
+  ASSERT_EQ(queries.size(), nn_indices.size());
+  ASSERT_EQ(queries.size(), nn_distances.size());
+
+  for (size_t ii = 0; ii < queries.size(); ++ii) {
+    std::vector<std::pair<double, int> > expected;
+    for (size_t jj = 0; jj < descriptors.size(); ++jj)
+      expected.push_back(std::make_pair(
+          (descriptors[jj] - queries[ii]).squaredNorm(), jj));
+    std::partial_sort(expected.begin(), expected.begin() + 2, expected.end());
+
+    ASSERT_EQ(2u, nn_indices[ii].size());
+    for (size_t jj = 0; jj < 2; ++jj) {
+      EXPECT_EQ(expected[jj].second, nn_indices[ii][jj]);
+      EXPECT_NEAR(expected[jj].first, nn_distances[ii][jj], 1e-4);
+    }
+  }
+
+  // An approximate search still returns sorted neighbors for every query.
+  descriptor_kdtree.SetSearchChecks(32);
+  EXPECT_TRUE(descriptor_kdtree.KNearestNeighbors(queries, 2, nn_indices,
+                                                  nn_distances));
+  ASSERT_EQ(queries.size(), nn_indices.size());
+  for (size_t ii = 0; ii < queries.size(); ++ii) {
+    ASSERT_EQ(2u, nn_distances[ii].size());
+    EXPECT_LE(nn_distances[ii][0], nn_distances[ii][1]);
+  }
 }
 
 }  //\namespace bsfm
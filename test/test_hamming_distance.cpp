@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2015, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: Erik Nelson            ( eanelson@eecs.berkeley.edu )
+ *          David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+#include <bitset>
+#include <vector>
+
+#include <matching/binary_descriptor.h>
+#include <matching/hamming_distance.h>
+#include <math/random_generator.h>
+
+#include <gtest/gtest.h>
+
+namespace bsfm {
+
+namespace {
+
+// Make a random binary descriptor with the given number of bytes.
+BinaryDescriptor RandomBinaryDescriptor(size_t num_bytes) {
+  static math::RandomGenerator rng(0);
+  unsigned char bytes[BinaryDescriptor::kMaxBytes];
+  for (size_t ii = 0; ii < num_bytes; ++ii)
+    bytes[ii] = static_cast<unsigned char>(rng.IntegerUniform(0, 255));
+  return BinaryDescriptor(bytes, num_bytes);
+}
+
+// Count differing bits one byte at a time.
+int ReferenceHammingDistance(const BinaryDescriptor& descriptor1,
+                             const BinaryDescriptor& descriptor2) {
+  int distance = 0;
+  for (size_t ii = 0; ii < descriptor1.Bytes(); ++ii)
+    distance += std::bitset<8>(descriptor1.Data()[ii] ^
+                               descriptor2.Data()[ii]).count();
+  return distance;
+}
+
+}  //\namespace
+
+TEST(HammingDistance, TestPackUnpack) {
+  const BinaryDescriptor binary = RandomBinaryDescriptor(32);
+  EXPECT_EQ(32u, binary.Bytes());
+  EXPECT_EQ(256u, binary.Bits());
+  EXPECT_EQ(4u, binary.Words());
+
+  // Converting to a descriptor with one double per byte and back should not
+  // change anything.
+  const Descriptor descriptor = binary.ToDescriptor();
+  EXPECT_EQ(32, descriptor.size());
+  EXPECT_TRUE(binary == BinaryDescriptor::FromDescriptor(descriptor));
+}
+
+TEST(HammingDistance, TestValue) {
+  // Check common descriptor lengths, including one that is not a multiple of
+  // the 64-bit word size.
+  const size_t kLengths[] = {16, 32, 37, 64};
+  for (const size_t length : kLengths) {
+    for (int ii = 0; ii < 100; ++ii) {
+      const BinaryDescriptor descriptor1 = RandomBinaryDescriptor(length);
+      const BinaryDescriptor descriptor2 = RandomBinaryDescriptor(length);
+      EXPECT_EQ(ReferenceHammingDistance(descriptor1, descriptor2),
+                HammingDistance(descriptor1, descriptor2));
+      EXPECT_EQ(HammingDistance(descriptor1, descriptor2),
+                HammingDistance(descriptor2, descriptor1));
+      EXPECT_EQ(0, HammingDistance(descriptor1, descriptor1));
+
+      // Bounded distances are exact below the bound.
+      const int distance = HammingDistance(descriptor1, descriptor2);
+      EXPECT_EQ(distance, HammingDistance(descriptor1, descriptor2, distance + 1));
+      EXPECT_LE(distance / 2,
+                HammingDistance(descriptor1, descriptor2, distance / 2));
+    }
+  }
+
+  // Complementary descriptors differ in every bit.
+  unsigned char zeros[32], ones[32];
+  for (int ii = 0; ii < 32; ++ii) {
+    zeros[ii] = 0x00;
+    ones[ii] = 0xff;
+  }
+  EXPECT_EQ(256, HammingDistance(BinaryDescriptor(zeros, 32),
+                                 BinaryDescriptor(ones, 32)));
+}
+
+TEST(HammingDistance, TestOneToMany) {
+  // The batch kernel must agree with the pairwise kernel.
+  const size_t kLengths[] = {32, 64, 48};
+  for (const size_t length : kLengths) {
+    const BinaryDescriptor query = RandomBinaryDescriptor(length);
+    std::vector<BinaryDescriptor> descriptors;
+    for (int ii = 0; ii < 1000; ++ii)
+      descriptors.push_back(RandomBinaryDescriptor(length));
+
+    std::vector<int> distances;
+    HammingDistances(query, descriptors, distances);
+    ASSERT_EQ(descriptors.size(), distances.size());
+    for (size_t ii = 0; ii < descriptors.size(); ++ii)
+      EXPECT_EQ(HammingDistance(query, descriptors[ii]), distances[ii]);
+  }
+}
+
+}  //\namespace bsfm
@@ -36,6 +36,7 @@
  */
 
 #include <gflags/gflags.h>
+#include <matching/distance_metric.h>
 #include <matching/feature.h>
 #include <sfm/view.h>
 #include <slam/landmark.h>
@@ -156,4 +157,40 @@ TEST(Landmark, TestSeenByAtLeastTwoViews) {
   View::ResetViews();
 }
 
+TEST(Landmark, TestIncorporateObservationDescriptorCheck) {
+  Landmark::ResetLandmarks();
+  View::ResetViews();
+
+  // Observations whose descriptors are far from the landmark's descriptor
+  // should not be incorporated.
+  Feature feature(0.0, 0.0);
+  Descriptor descriptor(Descriptor::Random(64).normalized());
+  Landmark::Ptr landmark = Landmark::Create();
+  EXPECT_TRUE(landmark->IncorporateObservation(
+      Observation::Create(View::Create(Camera()), feature, descriptor)));
+
+  Observation::Ptr opposite =
+      Observation::Create(View::Create(Camera()), feature, -descriptor);
+  EXPECT_FALSE(
+      landmark->IncorporateObservation(opposite, ScaledL2Metric(), 0.5));
+  EXPECT_FALSE(opposite->IsIncorporated());
+
+  // Packed binary descriptors are compared with the Hamming distance.
+  Descriptor bytes(Descriptor::Zero(32));
+  BinaryDescriptor binary_descriptor = BinaryDescriptor::FromDescriptor(bytes);
+  bytes.setConstant(255.0);
+  BinaryDescriptor flipped = BinaryDescriptor::FromDescriptor(bytes);
+
+  Landmark::Ptr binary_landmark = Landmark::Create();
+  EXPECT_TRUE(binary_landmark->IncorporateObservation(Observation::Create(
+      View::Create(Camera()), feature, binary_descriptor)));
+  EXPECT_FALSE(binary_landmark->IncorporateObservation(
+      Observation::Create(View::Create(Camera()), feature, flipped),
+      HammingMetric(), 10.0));
+
+  // Clean up.
+  Landmark::ResetLandmarks();
+  View::ResetViews();
+}
+
 }  //\namespace bsfm
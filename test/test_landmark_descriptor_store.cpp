@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2015, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: Erik Nelson            ( eanelson@eecs.berkeley.edu )
+ *          David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+#include <matching/distance_metric.h>
+#include <slam/landmark.h>
+#include <slam/landmark_descriptor_store.h>
+#include <util/types.h>
+
+#include <gtest/gtest.h>
+
+namespace bsfm {
+
+TEST(LandmarkDescriptorStore, TestUpdate) {
+  Landmark::ResetLandmarks();
+
+  std::vector<LandmarkIndex> landmark_indices;
+  for (int ii = 0; ii < 10; ++ii) {
+    Landmark::Ptr landmark = Landmark::Create();
+    landmark->SetDescriptor(Descriptor::Random(32));
+    landmark_indices.push_back(landmark->Index());
+  }
+
+  LandmarkDescriptorStore store;
+  store.SetMetric("SCALED_L2");
+  store.Update(landmark_indices);
+  ASSERT_EQ(landmark_indices.size(), store.Size());
+
+  // Stored descriptors are normalized copies of the landmark descriptors.
+  for (const auto& landmark_index : landmark_indices) {
+    const int slot = store.Slot(landmark_index);
+    ASSERT_LE(0, slot);
+    EXPECT_EQ(landmark_index, store.LandmarkIndices()[slot]);
+    const Descriptor expected =
+        Landmark::GetLandmark(landmark_index)->Descriptor().normalized();
+    EXPECT_NEAR(0.0, (expected - store.Descriptors()[slot]).norm(), 1e-12);
+  }
+
+  // Changing a descriptor is picked up by the next update.
+  Landmark::Ptr changed = Landmark::GetLandmark(landmark_indices[3]);
+  changed->SetDescriptor(Descriptor::Random(32));
+  store.Update(landmark_indices);
+  EXPECT_NEAR(0.0, (changed->Descriptor().normalized() -
+                    store.Descriptors()[store.Slot(changed->Index())]).norm(),
+              1e-12);
+
+  // Landmarks that are no longer listed are removed, and the remaining ones
+  // keep their descriptors.
+  std::vector<LandmarkIndex> kept(landmark_indices.begin() + 5,
+                                  landmark_indices.end());
+  store.Update(kept);
+  ASSERT_EQ(kept.size(), store.Size());
+  for (const auto& landmark_index : landmark_indices) {
+    const int slot = store.Slot(landmark_index);
+    if (landmark_index < kept[0]) {
+      EXPECT_EQ(-1, slot);
+      continue;
+    }
+    ASSERT_LE(0, slot);
+    const Descriptor expected =
+        Landmark::GetLandmark(landmark_index)->Descriptor().normalized();
+    EXPECT_NEAR(0.0, (expected - store.Descriptors()[slot]).norm(), 1e-12);
+  }
+
+  // Single landmark updates and removals.
+  store.Update(landmark_indices[0]);
+  EXPECT_EQ(kept.size() + 1, store.Size());
+  EXPECT_LE(0, store.Slot(landmark_indices[0]));
+  store.Remove(landmark_indices[0]);
+  EXPECT_EQ(kept.size(), store.Size());
+  EXPECT_EQ(-1, store.Slot(landmark_indices[0]));
+
+  Landmark::ResetLandmarks();
+}
+
+TEST(LandmarkDescriptorStore, TestReusedIndices) {
+  Landmark::ResetLandmarks();
+  Landmark::Ptr landmark = Landmark::Create();
+  landmark->SetDescriptor(Descriptor::Random(32));
+
+  LandmarkDescriptorStore store;
+  store.SetMetric("SCALED_L2");
+  store.Update(std::vector<LandmarkIndex>(1, landmark->Index()));
+
+  // A new landmark with the same index is not mistaken for the old one.
+  Landmark::ResetLandmarks();
+  Landmark::Ptr replacement = Landmark::Create();
+  replacement->SetDescriptor(Descriptor::Random(32));
+  ASSERT_EQ(landmark->Index(), replacement->Index());
+  store.Update(std::vector<LandmarkIndex>(1, replacement->Index()));
+  EXPECT_NEAR(0.0, (replacement->Descriptor().normalized() -
+                    store.Descriptors()[0]).norm(), 1e-12);
+
+  Landmark::ResetLandmarks();
+}
+
+}  //\namespace bsfm
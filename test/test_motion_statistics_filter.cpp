@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2015, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: Erik Nelson            ( eanelson@eecs.berkeley.edu )
+ *          David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include <matching/feature.h>
+#include <matching/feature_match.h>
+#include <matching/motion_statistics_filter.h>
+#include <math/random_generator.h>
+
+#include <gtest/gtest.h>
+
+namespace bsfm {
+
+TEST(MotionStatisticsFilter, TestRemovesIncoherentMatches) {
+  math::RandomGenerator rng(0);
+
+  // Correct matches translate by a constant offset with a little noise, and
+  // incorrect matches land anywhere in the second image.
+  const int kNumMatches = 2000;
+  std::vector<Feature> features1, features2;
+  std::vector<bool> is_correct;
+  for (int ii = 0; ii < kNumMatches; ++ii) {
+    const Feature feature1(rng.DoubleUniform(0.0, 640.0),
+                           rng.DoubleUniform(0.0, 480.0));
+    features1.push_back(feature1);
+    is_correct.push_back(rng.DoubleUniform(0.0, 1.0) < 0.6);
+    if (is_correct.back()) {
+      features2.push_back(
+          Feature(feature1.u_ + 40.0 + rng.DoubleUniform(-1.0, 1.0),
+                  feature1.v_ + 20.0 + rng.DoubleUniform(-1.0, 1.0)));
+    } else {
+      features2.push_back(Feature(rng.DoubleUniform(40.0, 680.0),
+                                  rng.DoubleUniform(20.0, 500.0)));
+    }
+  }
+
+  MotionStatisticsFilter filter(20, 6.0);
+  std::vector<int> inliers;
+  filter.Filter(features1, features2, inliers);
+  EXPECT_TRUE(std::is_sorted(inliers.begin(), inliers.end()));
+
+  int num_correct = 0, num_kept_correct = 0, num_kept_incorrect = 0;
+  for (int ii = 0; ii < kNumMatches; ++ii)
+    num_correct += is_correct[ii];
+  for (const auto& inlier : inliers) {
+    if (is_correct[inlier])
+      num_kept_correct++;
+    else
+      num_kept_incorrect++;
+  }
+
+  // Most correct matches are kept, and most incorrect matches are removed.
+  EXPECT_GT(num_kept_correct, 0.85 * num_correct);
+  EXPECT_LT(num_kept_incorrect, 0.1 * (kNumMatches - num_correct));
+}
+
+TEST(MotionStatisticsFilter, TestFeatureMatchList) {
+  math::RandomGenerator rng(0);
+
+  // A dense set of coherent matches, plus one match that moves the opposite
+  // way.
+  FeatureMatchList feature_matches;
+  for (int ii = 0; ii < 1000; ++ii) {
+    const Feature feature1(rng.DoubleUniform(0.0, 640.0),
+                           rng.DoubleUniform(0.0, 480.0));
+    feature_matches.emplace_back(
+        feature1, Feature(feature1.u_ + 10.0, feature1.v_ - 5.0));
+  }
+  feature_matches.emplace_back(Feature(320.0, 240.0), Feature(100.0, 400.0));
+
+  FeatureMatchList filtered_matches = feature_matches;
+  MotionStatisticsFilter filter(20, 6.0);
+  filter.Filter(filtered_matches);
+
+  // The incoherent match is removed, and the remaining matches keep their
+  // order.
+  ASSERT_FALSE(filtered_matches.empty());
+  EXPECT_LT(filtered_matches.size(), feature_matches.size());
+  size_t jj = 0;
+  for (const auto& match : filtered_matches) {
+    EXPECT_NE(100.0, match.feature2_.u_);
+    while (jj < feature_matches.size() &&
+           feature_matches[jj].feature1_.u_ != match.feature1_.u_)
+      ++jj;
+    EXPECT_LT(jj, feature_matches.size());
+  }
+
+  // Filtering no matches keeps no matches.
+  FeatureMatchList empty_matches;
+  filter.Filter(empty_matches);
+  EXPECT_TRUE(empty_matches.empty());
+}
+
+}  //\namespace bsfm
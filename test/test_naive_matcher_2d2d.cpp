@@ -65,8 +65,6 @@ class TestNaiveMatcher2D2D : public ::testing::Test {
 
   const unsigned int expected_matched_features_symmetric_floating = 199;
   const unsigned int expected_matched_features_asymmetric_floating = 480;
-  const unsigned int expected_matched_features_symmetric_binary = 806;
-  const unsigned int expected_matched_features_asymmetric_binary = 2501;
 };  //\class TestNaiveFeatureMatcher
 
 TEST_F(TestNaiveMatcher2D2D, TestNaiveMatcherSiftSift) {
@@ -167,31 +165,52 @@ TEST_F(TestNaiveMatcher2D2D, TestNaiveMatcherFastOrb) {
   DescriptorExtractor extractor;
   extractor.SetDescriptor("ORB");
 
+  // Describe the same keypoints with packed binary descriptors and with one
+  // byte per floating point element.
   std::vector<Feature> features1;
   std::vector<Feature> features2;
-  std::vector<Descriptor> descriptors1;
-  std::vector<Descriptor> descriptors2;
-  extractor.DescribeFeatures(image1, keypoints1, features1, descriptors1);
-  extractor.DescribeFeatures(image2, keypoints2, features2, descriptors2);
+  std::vector<BinaryDescriptor> binary_descriptors1;
+  std::vector<BinaryDescriptor> binary_descriptors2;
+  ASSERT_TRUE(extractor.DescribeFeatures(image1, keypoints1, features1,
+                                         binary_descriptors1));
+  ASSERT_TRUE(extractor.DescribeFeatures(image2, keypoints2, features2,
+                                         binary_descriptors2));
   LOG(INFO) << "Extracted " << features1.size() << " features from image 1.";
   LOG(INFO) << "Extracted " << features2.size() << " features from image 2.";
 
+  std::vector<Feature> float_features1;
+  std::vector<Feature> float_features2;
+  std::vector<Descriptor> descriptors1;
+  std::vector<Descriptor> descriptors2;
+  extractor.DescribeFeatures(image1, keypoints1, float_features1, descriptors1);
+  extractor.DescribeFeatures(image2, keypoints2, float_features2, descriptors2);
+  ASSERT_EQ(features1.size(), float_features1.size());
+  ASSERT_EQ(features2.size(), float_features2.size());
+
   FeatureMatcherOptions options;
   options.threshold_image_distance = false;
   options.distance_metric = "HAMMING";
   NaiveMatcher2D2D feature_matcher;
+  feature_matcher.AddImageFeatures(features1, binary_descriptors1);
+  feature_matcher.AddImageFeatures(features2, binary_descriptors2);
 
-  feature_matcher.AddImageFeatures(features1, descriptors1);
-  feature_matcher.AddImageFeatures(features2, descriptors2);
+  // Both paths count differing bits, so the floating point matcher gives the
+  // reference number of matches for the packed one. Absolute counts depend on
+  // the OpenCV version that detected and described the keypoints.
+  NaiveMatcher2D2D float_feature_matcher;
+  float_feature_matcher.AddImageFeatures(float_features1, descriptors1);
+  float_feature_matcher.AddImageFeatures(float_features2, descriptors2);
 
   // Match images with symmetric feature matches enforced.
   PairwiseImageMatchList image_matches;
+  PairwiseImageMatchList float_image_matches;
   ASSERT_TRUE(feature_matcher.MatchImages(options, image_matches));
+  ASSERT_TRUE(float_feature_matcher.MatchImages(options, float_image_matches));
 
-  // Different OpenCV versions will yield different numbers of
-  // keypoints/descriptors. Check for matches with some tolerance.
-  EXPECT_NEAR(expected_matched_features_symmetric_binary,
-              image_matches[0].feature_matches_.size(), 20);
+  const size_t num_symmetric_matches = image_matches[0].feature_matches_.size();
+  EXPECT_GT(num_symmetric_matches, 0u);
+  EXPECT_EQ(float_image_matches[0].feature_matches_.size(),
+            num_symmetric_matches);
 
   // Draw feature matches.
   if (FLAGS_draw_feature_matches) {
@@ -202,13 +221,15 @@ TEST_F(TestNaiveMatcher2D2D, TestNaiveMatcherFastOrb) {
 
   // Match images without enforcing symmetric feature matches.
   image_matches = PairwiseImageMatchList();
+  float_image_matches = PairwiseImageMatchList();
   options.require_symmetric_matches = false;
   ASSERT_TRUE(feature_matcher.MatchImages(options, image_matches));
+  ASSERT_TRUE(float_feature_matcher.MatchImages(options, float_image_matches));
 
-  // Different OpenCV versoins will yield different numbers of
-  // keypoints/descriptors. Check for matches with some tolerance.
-  EXPECT_NEAR(expected_matched_features_asymmetric_binary,
-              image_matches[0].feature_matches_.size(), 20);
+  // Every symmetric match is also an asymmetric match.
+  EXPECT_GE(image_matches[0].feature_matches_.size(), num_symmetric_matches);
+  EXPECT_EQ(float_image_matches[0].feature_matches_.size(),
+            image_matches[0].feature_matches_.size());
 
   // Draw feature matches.
   if (FLAGS_draw_feature_matches) {
@@ -218,4 +239,123 @@ TEST_F(TestNaiveMatcher2D2D, TestNaiveMatcherFastOrb) {
   }
 }
 
+TEST_F(TestNaiveMatcher2D2D, TestMultithreadedMatchesAreDeterministic) {
+  // Make several images that observe noisy copies of the same descriptors, so
+  // that every image pair matches.
+  const int kNumImages = 6;
+  const int kNumFeatures = 100;
+  std::vector<Descriptor> base_descriptors;
+  for (int ii = 0; ii < kNumFeatures; ++ii)
+    base_descriptors.push_back(Descriptor::Random(64).normalized());
+
+  std::vector<std::vector<Feature> > features(kNumImages);
+  std::vector<std::vector<Descriptor> > descriptors(kNumImages);
+  for (int ii = 0; ii < kNumImages; ++ii) {
+    for (int jj = 0; jj < kNumFeatures; ++jj) {
+      features[ii].push_back(Feature(jj, ii));
+      descriptors[ii].push_back(base_descriptors[jj] +
+                                0.05 * Descriptor::Random(64));
+    }
+  }
+
+  FeatureMatcherOptions options;
+  options.distance_metric = "SCALED_L2";
+  options.min_num_feature_matches = 10;
+
+  // Match on a single thread.
+  NaiveMatcher2D2D serial_matcher;
+  serial_matcher.AddImageFeatures(features, descriptors);
+  PairwiseImageMatchList serial_matches;
+  options.num_threads = 1;
+  ASSERT_TRUE(serial_matcher.MatchImages(options, serial_matches));
+  EXPECT_EQ(static_cast<size_t>(kNumImages * (kNumImages - 1) / 2),
+            serial_matches.size());
+
+  // Match on several threads. Results should be identical and in the same
+  // order.
+  NaiveMatcher2D2D threaded_matcher;
+  threaded_matcher.AddImageFeatures(features, descriptors);
+  PairwiseImageMatchList threaded_matches;
+  options.num_threads = 4;
+  ASSERT_TRUE(threaded_matcher.MatchImages(options, threaded_matches));
+  ASSERT_EQ(serial_matches.size(), threaded_matches.size());
+
+  for (size_t ii = 0; ii < serial_matches.size(); ++ii) {
+    EXPECT_EQ(serial_matches[ii].image_index1_,
+              threaded_matches[ii].image_index1_);
+    EXPECT_EQ(serial_matches[ii].image_index2_,
+              threaded_matches[ii].image_index2_);
+    EXPECT_EQ(serial_matches[ii].descriptor_indices1_,
+              threaded_matches[ii].descriptor_indices1_);
+    EXPECT_EQ(serial_matches[ii].descriptor_indices2_,
+              threaded_matches[ii].descriptor_indices2_);
+  }
+}
+
+TEST_F(TestNaiveMatcher2D2D, TestVocabularyTreeCandidatePairs) {
+  // Make pairs of images that view the same scene, with different scenes
+  // sharing no descriptors.
+  const int kNumScenes = 3;
+  const int kNumFeatures = 100;
+  std::vector<std::vector<Feature> > features(2 * kNumScenes);
+  std::vector<std::vector<Descriptor> > descriptors(2 * kNumScenes);
+  for (int scene = 0; scene < kNumScenes; ++scene) {
+    for (int jj = 0; jj < kNumFeatures; ++jj) {
+      const Descriptor base = Descriptor::Random(64).normalized();
+      for (int ii = scene; ii < 2 * kNumScenes; ii += kNumScenes) {
+        features[ii].push_back(Feature(jj, ii));
+        descriptors[ii].push_back(base + 0.05 * Descriptor::Random(64));
+      }
+    }
+  }
+
+  FeatureMatcherOptions options;
+  options.distance_metric = "SCALED_L2";
+  options.min_num_feature_matches = 10;
+  options.num_candidate_images = 1;
+  options.vocabulary_tree_branching = 8;
+  options.vocabulary_tree_depth = 3;
+
+  // Each image should only be matched with the other image of its scene.
+  NaiveMatcher2D2D feature_matcher;
+  feature_matcher.AddImageFeatures(features, descriptors);
+  PairwiseImageMatchList image_matches;
+  ASSERT_TRUE(feature_matcher.MatchImages(options, image_matches));
+  ASSERT_EQ(static_cast<size_t>(kNumScenes), image_matches.size());
+  for (int ii = 0; ii < kNumScenes; ++ii) {
+    EXPECT_EQ(ii, image_matches[ii].image_index1_);
+    EXPECT_EQ(ii + kNumScenes, image_matches[ii].image_index2_);
+  }
+}
+
+TEST_F(TestNaiveMatcher2D2D, TestVocabularyTreeTwoImages) {
+  // A vocabulary tree trained on only two images of the same scene should
+  // still pair them.
+  const int kNumFeatures = 200;
+  std::vector<std::vector<Feature> > features(2);
+  std::vector<std::vector<Descriptor> > descriptors(2);
+  for (int jj = 0; jj < kNumFeatures; ++jj) {
+    const Descriptor base = Descriptor::Random(64).normalized();
+    for (int ii = 0; ii < 2; ++ii) {
+      features[ii].push_back(Feature(jj, ii));
+      descriptors[ii].push_back(base + 0.01 * Descriptor::Random(64));
+    }
+  }
+
+  FeatureMatcherOptions options;
+  options.distance_metric = "SCALED_L2";
+  options.min_num_feature_matches = 10;
+  options.num_candidate_images = 1;
+  options.vocabulary_tree_branching = 8;
+  options.vocabulary_tree_depth = 3;
+
+  NaiveMatcher2D2D feature_matcher;
+  feature_matcher.AddImageFeatures(features, descriptors);
+  PairwiseImageMatchList image_matches;
+  ASSERT_TRUE(feature_matcher.MatchImages(options, image_matches));
+  ASSERT_EQ(1u, image_matches.size());
+  EXPECT_EQ(0, image_matches[0].image_index1_);
+  EXPECT_EQ(1, image_matches[0].image_index2_);
+}
+
 }  //\namespace bsfm
@@ -46,6 +46,7 @@
 #include <math/random_generator.h>
 #include <sfm/view.h>
 #include <slam/landmark.h>
+#include <slam/landmark_descriptor_store.h>
 #include <slam/observation.h>
 
 #include <gtest/gtest.h>
@@ -177,12 +178,6 @@ void TestMatcher(unsigned int num_bad_matches) {
       CreateObservations(landmark_indices, view->Index(), 0);
   ASSERT_LT(0, projected_landmarks.size());
 
-  // Make sure the distance metric (which is global across tests) is set up
-  // correctly.
-  DistanceMetric& distance = DistanceMetric::Instance();
-  distance.SetMetric(DistanceMetric::Metric::SCALED_L2);
-  distance.SetMaximumDistance(std::numeric_limits<double>::max());
-
   // Match 2D features in the view to 3D landmarks.
   FeatureMatcherOptions options;
   options.min_num_feature_matches = projected_landmarks.size();
@@ -225,5 +220,107 @@ TEST(NaiveMatcher2D3D, TestNaiveMatcher2D3DVeryNoisy) {
   TestMatcher(100.0 * kNumLandmarks);
 }
 
+// Test matching landmarks near their projections into a (predicted) camera.
+TEST(NaiveMatcher2D3D, TestNaiveMatcher2D3DProjected) {
+  Landmark::ResetLandmarks();
+  View::ResetViews();
+
+  // Make a camera looking down the z axis from behind all landmarks.
+  Camera camera;
+  CameraExtrinsics extrinsics;
+  extrinsics.Translate(0.0, 0.0, -5.0);
+  camera.SetExtrinsics(extrinsics);
+  camera.SetIntrinsics(DefaultIntrinsics());
+  View::Ptr view = View::Create(camera);
+
+  for (unsigned int ii = 0; ii < kNumLandmarks; ++ii) {
+    Landmark::Ptr landmark = Landmark::Create();
+    landmark->SetPosition(RandomPoint());
+    landmark->SetDescriptor(Descriptor::Random(kDescriptorLength));
+  }
+  std::vector<LandmarkIndex> landmark_indices =
+      Landmark::ExistingLandmarkIndices();
+  std::vector<LandmarkIndex> projected_landmarks =
+      CreateObservations(landmark_indices, view->Index(), 0);
+  ASSERT_EQ(landmark_indices.size(), projected_landmarks.size());
+
+  // None of the landmarks have been observed, so they can only be matched
+  // through their projections.
+  std::vector<Feature> projected_features;
+  for (const auto& landmark_index : landmark_indices) {
+    const Point3D point = Landmark::GetLandmark(landmark_index)->Position();
+    double u = 0.0, v = 0.0;
+    ASSERT_TRUE(camera.WorldToImage(point.X(), point.Y(), point.Z(), &u, &v));
+    projected_features.push_back(Feature(u + 1.0, v - 1.0));
+  }
+
+  FeatureMatcherOptions options;
+  options.min_num_feature_matches = projected_landmarks.size();
+  options.threshold_image_distance = true;
+  options.maximum_image_distance = 5.0;
+  NaiveMatcher2D3D feature_matcher;
+  EXPECT_FALSE(
+      feature_matcher.Match(options, view->Index(), landmark_indices));
+  EXPECT_TRUE(feature_matcher.Match(options, view->Index(), landmark_indices,
+                                    projected_features));
+
+  std::vector<Observation::Ptr> observations = view->Observations();
+  for (size_t ii = 0; ii < observations.size(); ++ii) {
+    ASSERT_TRUE(observations[ii]->IsMatched());
+    EXPECT_EQ(projected_landmarks[ii], observations[ii]->GetLandmarkIndex());
+  }
+
+  // Observations that are already matched are not matched again.
+  options.min_num_feature_matches = 1;
+  EXPECT_FALSE(feature_matcher.Match(options, view->Index(), landmark_indices,
+                                     projected_features));
+
+  Landmark::ResetLandmarks();
+  View::ResetViews();
+}
+
+// Test matching with landmark descriptors taken from a descriptor store.
+TEST(NaiveMatcher2D3D, TestNaiveMatcher2D3DDescriptorStore) {
+  Landmark::ResetLandmarks();
+  View::ResetViews();
+
+  Camera camera;
+  camera.SetIntrinsics(DefaultIntrinsics());
+  View::Ptr view = View::Create(camera);
+
+  for (unsigned int ii = 0; ii < kNumLandmarks; ++ii) {
+    Landmark::Ptr landmark = Landmark::Create();
+    landmark->SetPosition(RandomPoint());
+    landmark->SetDescriptor(Descriptor::Random(kDescriptorLength));
+  }
+  std::vector<LandmarkIndex> landmark_indices =
+      Landmark::ExistingLandmarkIndices();
+  std::vector<LandmarkIndex> projected_landmarks =
+      CreateObservations(landmark_indices, view->Index(), 0);
+  ASSERT_LT(0, projected_landmarks.size());
+
+  // Store landmark descriptors in reverse order, so that store slots do not
+  // line up with the order landmarks are matched in.
+  LandmarkDescriptorStore store;
+  store.SetMetric("SCALED_L2");
+  store.Update(std::vector<LandmarkIndex>(landmark_indices.rbegin(),
+                                          landmark_indices.rend()));
+  ASSERT_EQ(landmark_indices.size(), store.Size());
+
+  FeatureMatcherOptions options;
+  options.min_num_feature_matches = projected_landmarks.size();
+  NaiveMatcher2D3D feature_matcher;
+  feature_matcher.SetLandmarkDescriptorStore(&store);
+  EXPECT_TRUE(feature_matcher.Match(options, view->Index(), landmark_indices));
+
+  std::vector<Observation::Ptr> observations = view->Observations();
+  for (size_t ii = 0; ii < observations.size(); ++ii) {
+    ASSERT_TRUE(observations[ii]->IsMatched());
+    EXPECT_EQ(projected_landmarks[ii], observations[ii]->GetLandmarkIndex());
+  }
+
+  Landmark::ResetLandmarks();
+  View::ResetViews();
+}
 
 }  //\namespace bsfm
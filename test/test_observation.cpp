@@ -105,6 +105,36 @@ TEST(Observation, TestGetters) {
   View::ResetViews();
 }
 
+TEST(Observation, TestNormalizedDescriptors) {
+  Landmark::ResetLandmarks();
+  View::ResetViews();
+
+  // Observations and landmarks remember whether their descriptors have unit
+  // length, so that matchers can skip normalizing them.
+  Feature feature(0.0, 0.0);
+  Descriptor descriptor(Descriptor::Random(64));
+  View::Ptr view = View::Create(Camera());
+  EXPECT_FALSE(
+      Observation::Create(view, feature, descriptor)->HasNormalizedDescriptor());
+  EXPECT_FALSE(Observation::Create(view, feature, Descriptor::Zero(64))
+                   ->HasNormalizedDescriptor());
+
+  descriptor.normalize();
+  Observation::Ptr observation = Observation::Create(view, feature, descriptor);
+  EXPECT_TRUE(observation->HasNormalizedDescriptor());
+
+  Landmark::Ptr landmark = Landmark::Create();
+  EXPECT_FALSE(landmark->HasNormalizedDescriptor());
+  EXPECT_TRUE(landmark->IncorporateObservation(observation));
+  EXPECT_TRUE(landmark->HasNormalizedDescriptor());
+  landmark->SetDescriptor(Descriptor(2.0 * descriptor));
+  EXPECT_FALSE(landmark->HasNormalizedDescriptor());
+
+  // Clean up.
+  Landmark::ResetLandmarks();
+  View::ResetViews();
+}
+
 TEST(Observation, TestTriangulateObservations) {
   // Clear all possibly existing views and landmarks, since all tests are run in
   // the same process.
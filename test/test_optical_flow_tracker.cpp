@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2015, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: Erik Nelson            ( eanelson@eecs.berkeley.edu )
+ *          David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+#include <cmath>
+#include <vector>
+
+#include <image/image.h>
+#include <matching/feature.h>
+#include <matching/keypoint_detector.h>
+#include <matching/optical_flow_tracker.h>
+#include <strings/join_filepath.h>
+#include <util/types.h>
+
+#include <gtest/gtest.h>
+
+namespace bsfm {
+
+TEST(OpticalFlowTracker, TestTrackTranslatedImage) {
+  const std::string test_image =
+      strings::JoinFilepath(BSFM_TEST_DATA_DIR, "lenna.png");
+  Image image1(test_image, true);
+
+  // Translate the image by a few pixels.
+  const int du = 3, dv = 2;
+  cv::Mat cv_image1;
+  image1.ToCV(cv_image1);
+  cv::Mat cv_image2(cv_image1.size(), cv_image1.type(), cv::Scalar(0));
+  const cv::Rect source(0, 0, cv_image1.cols - du, cv_image1.rows - dv);
+  const cv::Rect destination(du, dv, cv_image1.cols - du, cv_image1.rows - dv);
+  cv_image1(source).copyTo(cv_image2(destination));
+  Image image2(cv_image2);
+
+  // Track corners away from the image border.
+  KeypointDetector detector;
+  detector.SetDetector("GFTT");
+  KeypointList keypoints;
+  ASSERT_TRUE(detector.DetectKeypoints(image1, keypoints));
+
+  std::vector<Feature> features;
+  for (const auto& keypoint : keypoints) {
+    if (keypoint.pt.x > 30 && keypoint.pt.x < cv_image1.cols - 30 &&
+        keypoint.pt.y > 30 && keypoint.pt.y < cv_image1.rows - 30)
+      features.push_back(Feature(keypoint.pt.x, keypoint.pt.y));
+  }
+  ASSERT_FALSE(features.empty());
+
+  OpticalFlowTracker tracker;
+  std::vector<Feature> tracked_features;
+  std::vector<bool> found;
+  EXPECT_FALSE(tracker.Track(image2, features, tracked_features, found));
+
+  tracker.SetImage(image1);
+  ASSERT_TRUE(tracker.Track(image2, features, tracked_features, found));
+  ASSERT_EQ(features.size(), tracked_features.size());
+  ASSERT_EQ(features.size(), found.size());
+
+  // Nearly all features should be found, at their translated positions.
+  unsigned int num_found = 0;
+  for (size_t ii = 0; ii < features.size(); ++ii) {
+    if (!found[ii])
+      continue;
+    num_found++;
+    EXPECT_NEAR(features[ii].u_ + du, tracked_features[ii].u_, 0.1);
+    EXPECT_NEAR(features[ii].v_ + dv, tracked_features[ii].v_, 0.1);
+  }
+  EXPECT_GT(num_found, 0.9 * features.size());
+}
+
+}  //\namespace bsfm
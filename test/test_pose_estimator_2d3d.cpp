@@ -73,7 +73,8 @@ CameraIntrinsics DefaultIntrinsics() {
 }
 
   void TestPoseEstimator(double pixel_noise_stddev = 0.0,
-			 double error_threshold = 1e-8) {
+			 double error_threshold = 1e-8,
+			 bool linear_only = false) {
   // Create a random number generator.
   math::RandomGenerator rng(0);
 
@@ -120,7 +121,10 @@ CameraIntrinsics DefaultIntrinsics() {
     estimator.Initialize(points_2d, points_3d, camera.Intrinsics());
 
     Pose calculated_pose;
-    estimator.Solve(calculated_pose);
+    if (linear_only)
+      EXPECT_TRUE(estimator.SolveLinear(calculated_pose));
+    else
+      estimator.Solve(calculated_pose);
 
     // Make sure we got the right rotation and translation. Extract camera
     // center with c = -R' * t, and extract euler angles from R for comparison.
@@ -144,6 +148,14 @@ TEST(PoseEstimator2D3D, TestPoseEstimatorNoiseless) {
 		    1e-8 /* error threshold */);
 }
 
+// Test if the linear solution alone is exact when a set of 3D points are
+// perfectly projected into the image.
+TEST(PoseEstimator2D3D, TestPoseEstimatorLinearNoiseless) {
+  TestPoseEstimator(0.0 /* pixel noise */,
+		    1e-8 /* error threshold */,
+		    true /* linear only */);
+}
+
 // Test if the pose estimator can correctly predict camera position when a set
 // of 3D points are noisuly projected into the image.
 TEST(PoseEstimator2D3D, TestPoseEstimatorNoisy) {
@@ -161,7 +161,60 @@ std::vector<LandmarkIndex> CreateObservations(
   return projected_landmarks;
 }
 
-void TestRansac2D3D(double fraction_bad_matches, double noise_stddev) {
+// A RANSAC problem that forwards to a PnP RANSAC problem, whose methods are
+// final, and counts the number of models it fits.
+class CountingPnPRansacProblem
+    : public RansacProblem<Observation::Ptr, PnPRansacModel> {
+ public:
+  CountingPnPRansacProblem() : num_fits_(0) {}
+
+  void SetIntrinsics(CameraIntrinsics& intrinsics) {
+    problem_.SetIntrinsics(intrinsics);
+  }
+
+  virtual void SetData(const std::vector<Observation::Ptr>& data) {
+    RansacProblem::SetData(data);
+    problem_.SetData(data);
+  }
+
+  virtual PnPRansacModel FitModel(const std::vector<int>& indices) const {
+    num_fits_++;
+    return problem_.FitModel(indices);
+  }
+
+  virtual size_t FindInliers(const PnPRansacModel& model,
+                             double error_tolerance,
+                             InlierMask& inliers) const {
+    return problem_.FindInliers(model, error_tolerance, inliers);
+  }
+
+  virtual bool IsInlier(const PnPRansacModel& model, double error_tolerance,
+                        int index) const {
+    return problem_.IsInlier(model, error_tolerance, index);
+  }
+
+  virtual size_t CountInliers(const PnPRansacModel& model,
+                              double error_tolerance,
+                              const std::vector<int>& indices) const {
+    return problem_.CountInliers(model, error_tolerance, indices);
+  }
+
+  virtual void RefineBestModel(const std::vector<int>& indices,
+                               double error_tolerance,
+                               PnPRansacModel& model) const {
+    problem_.RefineBestModel(indices, error_tolerance, model);
+  }
+
+  unsigned int NumFits() const { return num_fits_; }
+
+ private:
+  PnPRansacProblem problem_;
+  mutable unsigned int num_fits_;
+};  //\class CountingPnPRansacProblem
+
+void TestRansac2D3D(double fraction_bad_matches, double noise_stddev,
+                    bool adaptive_iterations = false,
+                    bool preemptive = false) {
   // Clean up from other tests.
   Landmark::ResetLandmarks();
   View::ResetViews();
@@ -198,14 +251,8 @@ void TestRansac2D3D(double fraction_bad_matches, double noise_stddev) {
       landmark_indices, view->Index(), num_bad_matches, noise_stddev);
   ASSERT_LT(0, projected_landmarks.size());
 
-  // Make sure the distance metric (which is global across tests) is set up
-  // correctly.
-  DistanceMetric& distance = DistanceMetric::Instance();
-  distance.SetMetric(DistanceMetric::Metric::SCALED_L2);
-  distance.SetMaximumDistance(std::numeric_limits<double>::max());
-
   // Set up RANSAC.
-  PnPRansacProblem problem;
+  CountingPnPRansacProblem problem;
   CameraIntrinsics intrinsics = DefaultIntrinsics();
   problem.SetIntrinsics(intrinsics);
   problem.SetData(view->Observations());
@@ -224,12 +271,35 @@ void TestRansac2D3D(double fraction_bad_matches, double noise_stddev) {
 				 static_cast<double>(projected_landmarks.size())),
 	     static_cast<size_t>(options.num_samples));
 
+  // With adaptive iterations, allow many more iterations than needed. RANSAC
+  // should stop long before reaching them.
+  if (adaptive_iterations) {
+    options.iterations = 10000;
+    options.adaptive_iterations = true;
+    options.confidence = 0.99;
+  }
+
+  // Preemptive RANSAC scores hypotheses on blocks of data, so only the best
+  // one is refit to its inliers.
+  if (preemptive) {
+    options.preemptive = true;
+    options.preemption_block_size = 20;
+  }
+
   solver.SetOptions(options);
   solver.Run(problem);
 
   // Get the solution from the problem object.
   ASSERT_TRUE(problem.SolutionFound());
 
+  // Each iteration fits at most two models.
+  if (adaptive_iterations) {
+    EXPECT_LT(problem.NumFits(), 2 * 200);
+  }
+  if (preemptive) {
+    EXPECT_EQ(options.iterations + 1, problem.NumFits());
+  }
+
   // Iterate over all inliers and make sure we have low enough reprojection error.
   Camera estimated_camera = problem.Model().camera_;
   for (auto& observation : problem.Inliers()) {
@@ -296,4 +366,36 @@ TEST(PnPRansac2D3D, TestPnPRansac2D3DVeryNoisy) {
   TestRansac2D3D(0.33, FLAGS_noise_stddev);
 }
 
+// Test RANSAC that stops once it is confident that it has sampled only inliers.
+TEST(PnPRansac2D3D, TestPnPRansac2D3DAdaptiveIterations) {
+  TestRansac2D3D(0.25, FLAGS_noise_stddev, true);
+}
+
+// Test RANSAC that discards the worse half of its hypotheses after scoring them
+// on each block of data.
+TEST(PnPRansac2D3D, TestPnPRansac2D3DPreemptive) {
+  TestRansac2D3D(0.25, FLAGS_noise_stddev, false, true);
+}
+
+TEST(PnPRansac2D3D, TestRequiredRansacIterations) {
+  // 10% outliers with 8 samples per iteration at 99% confidence. See Table 4.3
+  // of H&Z.
+  EXPECT_EQ(9, RequiredRansacIterations(0.9, 8, 0.99));
+
+  // Fewer inliers, larger samples, and higher confidence all require more
+  // iterations.
+  EXPECT_LT(RequiredRansacIterations(0.9, 8, 0.99),
+            RequiredRansacIterations(0.8, 8, 0.99));
+  EXPECT_LT(RequiredRansacIterations(0.9, 6, 0.99),
+            RequiredRansacIterations(0.9, 8, 0.99));
+  EXPECT_LT(RequiredRansacIterations(0.9, 8, 0.99),
+            RequiredRansacIterations(0.9, 8, 0.999));
+
+  // Without outliers a single iteration suffices, and without inliers no
+  // number of iterations does.
+  EXPECT_EQ(1, RequiredRansacIterations(1.0, 8, 0.99));
+  EXPECT_EQ(std::numeric_limits<unsigned int>::max(),
+            RequiredRansacIterations(0.0, 8, 0.99));
+}
+
 }  //\namespace bsfm
@@ -35,6 +35,10 @@
  *          David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
  */
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+
 #include <camera/camera.h>
 #include <camera/camera_extrinsics.h>
 #include <camera/camera_intrinsics.h>
@@ -50,9 +54,11 @@
 #include <matching/pairwise_image_match.h>
 #include <math/random_generator.h>
 #include <ransac/fundamental_matrix_ransac_problem.h>
+#include <ransac/prosac_sampler.h>
 #include <ransac/ransac.h>
 #include <ransac/ransac_options.h>
 #include <strings/join_filepath.h>
+#include <util/timer.h>
 
 #include <gtest/gtest.h>
 
@@ -69,6 +75,64 @@ namespace bsfm {
 using Eigen::Matrix3d;
 using Eigen::Vector3d;
 
+// Forwards to a fundamental matrix problem, whose methods are final, and counts
+// the models it fits and the single data points it checks.
+class CountingProblem
+    : public RansacProblem<FeatureMatch, FundamentalMatrixRansacModel> {
+ public:
+  CountingProblem() : num_fits_(0), num_checks_(0) {}
+
+  virtual void SetData(const std::vector<FeatureMatch>& data) {
+    RansacProblem::SetData(data);
+    problem_.SetData(data);
+  }
+
+  virtual FundamentalMatrixRansacModel FitModel(
+      const std::vector<int>& indices) const {
+    num_fits_++;
+    return problem_.FitModel(indices);
+  }
+
+  virtual size_t FindInliers(const FundamentalMatrixRansacModel& model,
+                             double error_tolerance,
+                             InlierMask& inliers) const {
+    return problem_.FindInliers(model, error_tolerance, inliers);
+  }
+
+  virtual bool IsInlier(const FundamentalMatrixRansacModel& model,
+                        double error_tolerance, int index) const {
+    num_checks_++;
+    return problem_.IsInlier(model, error_tolerance, index);
+  }
+
+  virtual size_t CountInliers(const FundamentalMatrixRansacModel& model,
+                              double error_tolerance,
+                              const std::vector<int>& indices) const {
+    return problem_.CountInliers(model, error_tolerance, indices);
+  }
+
+  mutable unsigned int num_fits_;
+  mutable unsigned int num_checks_;
+
+ private:
+  FundamentalMatrixRansacProblem problem_;
+};  //\class CountingProblem
+
+// Replaces the best model with one fit to only its first eight inliers, so that
+// refinement moves some matches across the error tolerance. The inliers of the
+// model before refinement are kept for comparison.
+class CoarselyRefinedProblem : public FundamentalMatrixRansacProblem {
+ public:
+  virtual void RefineBestModel(const std::vector<int>& indices,
+                               double error_tolerance,
+                               FundamentalMatrixRansacModel& model) const {
+    FindInliers(model, error_tolerance, unrefined_inliers_);
+    model = FitModel(std::vector<int>(indices.begin(), indices.begin() + 8));
+  }
+
+  mutable InlierMask unrefined_inliers_;
+};  //\class CoarselyRefinedProblem
+
 class TestRansac : public ::testing::Test {
  protected:
 
@@ -319,6 +383,395 @@ TEST_F(TestRansac, TestBadMatches) {
   }
 }
 
+TEST_F(TestRansac, TestInliersKeepDataOrder) {
+  // RANSAC refers to data by index, so the data should not be reordered, and
+  // inliers should be returned in the order they were given.
+  const int kNumGoodMatches = 100;
+  const int kNumBadMatches = 100;
+
+  PairwiseImageMatch data =
+      CreateFakeMatchedImagePair(kNumGoodMatches, kNumBadMatches);
+
+  FundamentalMatrixRansacProblem problem;
+  problem.SetData(data.feature_matches_);
+  ASSERT_EQ(data.feature_matches_.size(), problem.NumData());
+
+  // Samples are distinct indices into the data.
+  std::vector<int> sample;
+  for (int ii = 0; ii < 100; ++ii) {
+    problem.SampleIndices(8, sample);
+    ASSERT_EQ(8, sample.size());
+    std::sort(sample.begin(), sample.end());
+    EXPECT_TRUE(std::adjacent_find(sample.begin(), sample.end()) ==
+                sample.end());
+    EXPECT_LE(0, sample.front());
+    EXPECT_GT(problem.NumData(), sample.back());
+  }
+
+  Ransac<FeatureMatch, FundamentalMatrixRansacModel> solver;
+  RansacOptions options;
+  options.iterations = 10000;
+  options.acceptable_error = 1e-8;
+  options.num_samples = 8;
+  options.minimum_num_inliers = kNumGoodMatches;
+
+  solver.SetOptions(options);
+  solver.Run(problem);
+  ASSERT_TRUE(problem.SolutionFound());
+
+  // All good matches are inliers, and come first.
+  const FeatureMatchList& inliers = problem.Inliers();
+  ASSERT_LE(kNumGoodMatches, inliers.size());
+  for (int ii = 0; ii < kNumGoodMatches; ++ii) {
+    EXPECT_EQ(data.feature_matches_[ii].feature1_.u_, inliers[ii].feature1_.u_);
+    EXPECT_EQ(data.feature_matches_[ii].feature2_.v_, inliers[ii].feature2_.v_);
+  }
+}
+
+TEST_F(TestRansac, TestProsacSamplesBestMatchesFirst) {
+  // With matches ranked by quality, PROSAC should find the model in a handful
+  // of iterations, even when the bad matches come first in the data.
+  const int kNumGoodMatches = 100;
+  const int kNumBadMatches = 100;
+
+  PairwiseImageMatch data =
+      CreateFakeMatchedImagePair(kNumGoodMatches, kNumBadMatches);
+  std::rotate(data.feature_matches_.begin(),
+              data.feature_matches_.begin() + kNumGoodMatches,
+              data.feature_matches_.end());
+
+  FundamentalMatrixRansacProblem problem;
+  problem.SetData(data.feature_matches_);
+
+  std::vector<double> quality(kNumBadMatches, 0.0);
+  quality.resize(kNumBadMatches + kNumGoodMatches, 1.0);
+  problem.SetQuality(quality);
+  ASSERT_EQ(quality.size(), problem.QualityOrder().size());
+  EXPECT_EQ(kNumBadMatches, problem.QualityOrder().front());
+
+  // PROSAC samples are distinct, and start out drawn from the best matches.
+  std::vector<int> sample;
+  ProsacSampler sampler(8, problem.NumData(), problem.QualityOrder());
+  for (int ii = 0; ii < 100; ++ii) {
+    sampler.Sample(sample);
+    ASSERT_EQ(8, sample.size());
+    std::sort(sample.begin(), sample.end());
+    EXPECT_TRUE(std::adjacent_find(sample.begin(), sample.end()) ==
+                sample.end());
+    EXPECT_LE(kNumBadMatches, sample.front());
+  }
+
+  Ransac<FeatureMatch, FundamentalMatrixRansacModel> solver;
+  RansacOptions options;
+  options.iterations = 5;
+  options.acceptable_error = 1e-8;
+  options.num_samples = 8;
+  options.minimum_num_inliers = kNumGoodMatches;
+  options.use_prosac = true;
+
+  solver.SetOptions(options);
+  solver.Run(problem);
+  ASSERT_TRUE(problem.SolutionFound());
+
+  const FundamentalMatrixRansacModel& model = problem.Model();
+  for (int ii = kNumBadMatches; ii < kNumBadMatches + kNumGoodMatches; ++ii) {
+    const double error =
+        model.EvaluateEpipolarCondition(data.feature_matches_[ii]);
+    EXPECT_NEAR(0.0, error, 1e-8);
+  }
+}
+
+TEST_F(TestRansac, TestMultiThreadedIsReproducible) {
+  // Threads sample from their own seeded random number generators, so running
+  // twice with the same seed and number of threads gives the same result.
+  const int kNumGoodMatches = 100;
+  const int kNumBadMatches = 100;
+
+  PairwiseImageMatch data =
+      CreateFakeMatchedImagePair(kNumGoodMatches, kNumBadMatches);
+
+  RansacOptions options;
+  options.iterations = 10000;
+  options.adaptive_iterations = true;
+  options.acceptable_error = 1e-8;
+  options.num_samples = 8;
+  options.minimum_num_inliers = kNumGoodMatches;
+  options.num_threads = 4;
+  options.seed = 7;
+
+  Ransac<FeatureMatch, FundamentalMatrixRansacModel> solver;
+  solver.SetOptions(options);
+
+  FundamentalMatrixRansacProblem problem1, problem2;
+  problem1.SetData(data.feature_matches_);
+  problem2.SetData(data.feature_matches_);
+  ASSERT_TRUE(solver.Run(problem1));
+  ASSERT_TRUE(solver.Run(problem2));
+
+  EXPECT_TRUE(problem1.Model().F_ == problem2.Model().F_);
+  EXPECT_EQ(problem1.Inliers().size(), problem2.Inliers().size());
+
+  const FundamentalMatrixRansacModel& model = problem1.Model();
+  for (int ii = 0; ii < kNumGoodMatches; ++ii) {
+    const double error =
+        model.EvaluateEpipolarCondition(data.feature_matches_[ii]);
+    EXPECT_NEAR(0.0, error, 1e-8);
+  }
+}
+
+TEST_F(TestRansac, TestSingleThreadedIsReproducible) {
+  // A single thread also samples from a generator seeded by 'seed', so the
+  // result does not depend on the state of std::rand().
+  const int kNumGoodMatches = 100;
+  const int kNumBadMatches = 100;
+  const double noise_stddev = 1.0;
+
+  PairwiseImageMatch data = CreateFakeMatchedImagePair(
+      kNumGoodMatches, kNumBadMatches, noise_stddev);
+  std::vector<double> quality(data.feature_matches_.size());
+  for (size_t ii = 0; ii < quality.size(); ++ii)
+    quality[ii] = static_cast<double>(ii % 7);
+
+  RansacOptions options;
+  options.iterations = 200;
+  options.acceptable_error = 25.0 * noise_stddev * noise_stddev;
+  options.num_samples = 8;
+  options.minimum_num_inliers = kNumGoodMatches / 2;
+  options.use_sprt = true;
+  options.num_threads = 1;
+  options.seed = 7;
+
+  for (bool use_prosac : {false, true}) {
+    options.use_prosac = use_prosac;
+    Ransac<FeatureMatch, FundamentalMatrixRansacModel> solver;
+    solver.SetOptions(options);
+
+    FundamentalMatrixRansacProblem problem1, problem2;
+    problem1.SetData(data.feature_matches_);
+    problem2.SetData(data.feature_matches_);
+    problem1.SetQuality(quality);
+    problem2.SetQuality(quality);
+
+    std::srand(1);
+    ASSERT_TRUE(solver.Run(problem1));
+    std::srand(2);
+    ASSERT_TRUE(solver.Run(problem2));
+
+    EXPECT_TRUE(problem1.Model().F_ == problem2.Model().F_);
+    EXPECT_EQ(problem1.Inliers().size(), problem2.Inliers().size());
+  }
+}
+
+TEST_F(TestRansac, TestPreemptive) {
+  // Preemptive RANSAC should keep a good hypothesis while discarding the rest,
+  // and refit it to the inliers.
+  const int kNumGoodMatches = 100;
+  const int kNumBadMatches = 30;
+
+  PairwiseImageMatch data =
+      CreateFakeMatchedImagePair(kNumGoodMatches, kNumBadMatches);
+
+  FundamentalMatrixRansacProblem problem;
+  problem.SetData(data.feature_matches_);
+
+  Ransac<FeatureMatch, FundamentalMatrixRansacModel> solver;
+  RansacOptions options;
+  options.iterations = 200;
+  options.acceptable_error = 1e-8;
+  options.num_samples = 8;
+  options.minimum_num_inliers = kNumGoodMatches;
+  options.preemptive = true;
+  options.preemption_block_size = 20;
+
+  solver.SetOptions(options);
+  ASSERT_TRUE(solver.Run(problem));
+  EXPECT_LE(kNumGoodMatches, problem.Inliers().size());
+
+  const FundamentalMatrixRansacModel& model = problem.Model();
+  for (int ii = 0; ii < kNumGoodMatches; ++ii) {
+    const double error =
+        model.EvaluateEpipolarCondition(data.feature_matches_[ii]);
+    EXPECT_NEAR(0.0, error, 1e-8);
+  }
+}
+
+TEST_F(TestRansac, TestDeadline) {
+  // Once the deadline has passed, RANSAC should stop after the first
+  // hypothesis, in both the standard and preemptive modes.
+
+  PairwiseImageMatch data = CreateFakeMatchedImagePair(100, 0);
+
+  for (const bool preemptive : {false, true}) {
+    CountingProblem problem;
+    problem.SetData(data.feature_matches_);
+
+    Ransac<FeatureMatch, FundamentalMatrixRansacModel> solver;
+    RansacOptions options;
+    options.iterations = 10000;
+    options.acceptable_error = 1e-8;
+    options.num_samples = 8;
+    options.minimum_num_inliers = 100;
+    options.preemptive = preemptive;
+    solver.SetOptions(options);
+
+    // A hypothesis fit to noiseless inliers is good, and is refit once.
+    EXPECT_TRUE(solver.Run(problem, std::chrono::steady_clock::now()));
+    EXPECT_EQ(2, problem.num_fits_);
+  }
+}
+
+TEST_F(TestRansac, TestSprt) {
+  // The sequential probability ratio test should reject most bad hypotheses
+  // after checking only a few matches, and still find the right model.
+
+  const int kNumGoodMatches = 100;
+  const int kNumBadMatches = 100;
+
+  PairwiseImageMatch data =
+      CreateFakeMatchedImagePair(kNumGoodMatches, kNumBadMatches);
+
+  CountingProblem problem;
+  problem.SetData(data.feature_matches_);
+
+  Ransac<FeatureMatch, FundamentalMatrixRansacModel> solver;
+  RansacOptions options;
+  options.iterations = 2000;
+  options.acceptable_error = 1e-8;
+  options.num_samples = 8;
+  options.minimum_num_inliers = kNumGoodMatches;
+  options.use_sprt = true;
+
+  solver.SetOptions(options);
+  ASSERT_TRUE(solver.Run(problem));
+
+  // Checking every match against every hypothesis would take 400000 checks.
+  EXPECT_LT(problem.num_checks_, options.iterations * problem.NumData() / 10);
+
+  const FundamentalMatrixRansacModel& model = problem.Model();
+  for (int ii = 0; ii < kNumGoodMatches; ++ii) {
+    const double error =
+        model.EvaluateEpipolarCondition(data.feature_matches_[ii]);
+    EXPECT_NEAR(0.0, error, 1e-8);
+  }
+}
+
+TEST_F(TestRansac, TestLocalOptimization) {
+  // Models fit to minimal samples of noisy matches miss many of the good
+  // matches, so few of them would be accepted. Local optimization should
+  // recover nearly all of the good matches.
+  const int kNumGoodMatches = 100;
+  const int kNumBadMatches = 100;
+  const double noise_stddev = 1.0;
+
+  PairwiseImageMatch data =
+      CreateFakeMatchedImagePair(kNumGoodMatches, kNumBadMatches, noise_stddev);
+
+  FundamentalMatrixRansacProblem problem;
+  problem.SetData(data.feature_matches_);
+
+  Ransac<FeatureMatch, FundamentalMatrixRansacModel> solver;
+  RansacOptions options;
+  options.iterations = 10000;
+  options.adaptive_iterations = true;
+  options.acceptable_error = 4.0 * noise_stddev * noise_stddev;
+  options.num_samples = 8;
+  options.minimum_num_inliers = 0.9 * kNumGoodMatches;
+  options.use_local_optimization = true;
+  solver.SetOptions(options);
+  ASSERT_TRUE(solver.Run(problem));
+  EXPECT_LE(options.minimum_num_inliers, problem.Inliers().size());
+
+  const FundamentalMatrixRansacModel& model = problem.Model();
+  for (int ii = 0; ii < kNumGoodMatches; ++ii) {
+    const double error =
+        model.EvaluateEpipolarCondition(data.feature_matches_[ii]);
+    EXPECT_NEAR(0.0, error, 0.1);
+  }
+}
+
+TEST_F(TestRansac, TestInliersMatchRefinedModel) {
+  // The inliers returned with a model should be found under that model, even
+  // when refinement moves matches across the error tolerance.
+  const int kNumGoodMatches = 100;
+  const int kNumBadMatches = 100;
+  const double noise_stddev = 1.0;
+
+  PairwiseImageMatch data = CreateFakeMatchedImagePair(
+      kNumGoodMatches, kNumBadMatches, noise_stddev);
+
+  CoarselyRefinedProblem problem;
+  problem.SetData(data.feature_matches_);
+
+  Ransac<FeatureMatch, FundamentalMatrixRansacModel> solver;
+  RansacOptions options;
+  options.iterations = 1000;
+  options.acceptable_error = 4.0 * noise_stddev * noise_stddev;
+  options.num_samples = 8;
+  options.minimum_num_inliers = kNumGoodMatches / 2;
+  solver.SetOptions(options);
+  ASSERT_TRUE(solver.Run(problem));
+
+  InlierMask inliers;
+  problem.FindInliers(problem.Model(), options.acceptable_error, inliers);
+  EXPECT_TRUE(inliers != problem.unrefined_inliers_);
+
+  std::vector<FeatureMatch> expected_inliers;
+  for (size_t ii = 0; ii < inliers.size(); ++ii) {
+    if (inliers[ii])
+      expected_inliers.push_back(data.feature_matches_[ii]);
+  }
+  ASSERT_EQ(expected_inliers.size(), problem.Inliers().size());
+  for (size_t ii = 0; ii < expected_inliers.size(); ++ii) {
+    EXPECT_EQ(expected_inliers[ii].feature1_.u_,
+              problem.Inliers()[ii].feature1_.u_);
+    EXPECT_EQ(expected_inliers[ii].feature1_.v_,
+              problem.Inliers()[ii].feature1_.v_);
+  }
+}
+
+TEST_F(TestRansac, TestStaticAndVirtualDispatchAgree) {
+  // Running RANSAC on the fundamental matrix problem binds its calls at compile
+  // time. Running it on a RansacProblem reference dispatches them virtually.
+  // Both should find the same model from the same random numbers. Timings of
+  // the two are logged for comparison.
+  const int kNumGoodMatches = 100;
+  const int kNumBadMatches = 100;
+  const unsigned int kSeed = 7;
+
+  PairwiseImageMatch data =
+      CreateFakeMatchedImagePair(kNumGoodMatches, kNumBadMatches);
+
+  FundamentalMatrixRansacProblem problem;
+  problem.SetData(data.feature_matches_);
+  RansacProblem<FeatureMatch, FundamentalMatrixRansacModel>& base = problem;
+
+  Ransac<FeatureMatch, FundamentalMatrixRansacModel> solver;
+  RansacOptions options;
+  options.iterations = 2000;
+  options.acceptable_error = 1e-8;
+  options.num_samples = 8;
+  options.minimum_num_inliers = kNumGoodMatches;
+  options.use_sprt = true;
+  options.seed = kSeed;
+  solver.SetOptions(options);
+
+  util::Timer timer;
+  ASSERT_TRUE(solver.Run(problem));
+  const double static_time = timer.Toc();
+  const Matrix3d F = problem.Model().F_;
+  const size_t num_inliers = problem.Inliers().size();
+
+  problem.SetData(data.feature_matches_);
+  timer.Tic();
+  ASSERT_TRUE(solver.Run(base));
+  const double virtual_time = timer.Toc();
+  EXPECT_TRUE(F.isApprox(problem.Model().F_));
+  EXPECT_EQ(num_inliers, problem.Inliers().size());
+
+  LOG(INFO) << "RANSAC took " << static_time << " s with static dispatch and "
+            << virtual_time << " s with virtual dispatch.";
+}
+
 TEST_F(TestRansac, TestNeedAtLeastEight) {
   // Make sure that the fundamental matrix ransac solver fails when we don't
   // have a sufficient number of input matches. Make sure the solver fails
@@ -406,7 +859,7 @@ TEST_F(TestRansac, TestDrawInliers) {
   RansacOptions ransac_options;
 
   ransac_options.iterations = 5000;
-  ransac_options.acceptable_error = 1e-3;
+  ransac_options.acceptable_error = 1.0;
   ransac_options.minimum_num_inliers = 100;
   ransac_options.num_samples = 8;
 
@@ -451,10 +904,11 @@ TEST_F(TestRansac, TestNoisyAndBadMatches) {
   RansacOptions options;
 
   // Run RANSAC for a bunch of iterations. It is very likely that in at least 1
-  // iteration, all samples will be from the set of good matches and will
-  // therefore result in an error of < 1e-2.
+  // iteration, all samples will be from the set of good matches. Inliers are
+  // then within a few standard deviations of the noise of their epipolar lines,
+  // since the Sampson distance is measured in pixels.
   options.iterations = 10000;
-  options.acceptable_error = 1e-2;
+  options.acceptable_error = 25.0 * noise_stddev * noise_stddev;
   options.num_samples = 8;
   options.minimum_num_inliers = kNumGoodMatches;
 
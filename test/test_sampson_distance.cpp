@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2015, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: Erik Nelson            ( eanelson@eecs.berkeley.edu )
+ *          David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+#include <vector>
+
+#include <geometry/sampson_distance.h>
+#include <matching/feature_match.h>
+#include <math/random_generator.h>
+
+#include <gtest/gtest.h>
+
+namespace bsfm {
+
+using Eigen::Matrix3d;
+
+TEST(SampsonDistance, TestRectifiedStereo) {
+  // With rectified cameras, epipolar lines are image rows. Each feature of a
+  // match must move half of their vertical offset to lie on the same row.
+  Matrix3d F;
+  F << 0.0, 0.0, 0.0,
+       0.0, 0.0, -1.0,
+       0.0, 1.0, 0.0;
+
+  FeatureMatch match;
+  match.feature1_.u_ = 100.0;
+  match.feature1_.v_ = 50.0;
+  match.feature2_.u_ = 80.0;
+  match.feature2_.v_ = 54.0;
+  EXPECT_NEAR(8.0, SampsonDistance(F, match), 1e-12);
+
+  match.feature2_.v_ = 50.0;
+  EXPECT_NEAR(0.0, SampsonDistance(F, match), 1e-12);
+}
+
+TEST(SampsonDistance, TestBatchMatchesSingle) {
+  // Scoring a batch must agree with scoring each match, including the matches
+  // left over after the last full SIMD register.
+  math::RandomGenerator rng(0);
+  const Matrix3d F = Matrix3d::Random();
+
+  for (const size_t num_matches : {0, 1, 4, 7, 1001}) {
+    FeatureMatchList matches(num_matches);
+    for (auto& match : matches) {
+      match.feature1_.u_ = rng.DoubleUniform(0.0, 1.0);
+      match.feature1_.v_ = rng.DoubleUniform(0.0, 1.0);
+      match.feature2_.u_ = rng.DoubleUniform(0.0, 1.0);
+      match.feature2_.v_ = rng.DoubleUniform(0.0, 1.0);
+    }
+    FeatureMatchArrays arrays;
+    arrays.Set(matches);
+    ASSERT_EQ(num_matches, arrays.Size());
+
+    const double kThreshold = 0.01;
+    std::vector<unsigned char> inliers;
+    const size_t num_inliers = SampsonInliers(F, arrays, kThreshold, inliers);
+    ASSERT_EQ(num_matches, inliers.size());
+
+    size_t expected_num_inliers = 0;
+    for (size_t ii = 0; ii < num_matches; ++ii) {
+      const bool inlier = SampsonDistance(F, matches[ii]) < kThreshold;
+      EXPECT_EQ(inlier, inliers[ii] != 0);
+      expected_num_inliers += inlier;
+    }
+    EXPECT_EQ(expected_num_inliers, num_inliers);
+  }
+}
+
+}  //\namespace bsfm
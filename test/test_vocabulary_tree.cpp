@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2015, The Regents of the University of California (Regents).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS AS IS
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Please contact the author(s) of this library if you have any questions.
+ * Authors: Erik Nelson            ( eanelson@eecs.berkeley.edu )
+ *          David Fridovich-Keil   ( dfk@eecs.berkeley.edu )
+ */
+
+#include <cstring>
+#include <vector>
+
+#include <matching/binary_descriptor.h>
+#include <matching/vocabulary_tree.h>
+#include <math/random_generator.h>
+#include <util/types.h>
+
+#include <gtest/gtest.h>
+
+namespace bsfm {
+
+namespace {
+
+const int kNumScenes = 4;
+const int kImagesPerScene = 3;
+const int kDescriptorsPerScene = 200;
+const int kDescriptorLength = 32;
+
+// Each image views a noisy copy of the descriptors in one of several scenes.
+// Image 'ii' views scene 'ii % kNumScenes'.
+std::vector<std::vector<Descriptor> > MakeImages() {
+  std::vector<std::vector<Descriptor> > scenes(kNumScenes);
+  for (auto& scene : scenes) {
+    for (int ii = 0; ii < kDescriptorsPerScene; ++ii)
+      scene.push_back(Descriptor::Random(kDescriptorLength));
+  }
+
+  std::vector<std::vector<Descriptor> > images;
+  for (int ii = 0; ii < kNumScenes * kImagesPerScene; ++ii) {
+    std::vector<Descriptor> image;
+    for (const auto& descriptor : scenes[ii % kNumScenes])
+      image.push_back(descriptor + 0.05 * Descriptor::Random(kDescriptorLength));
+    images.push_back(image);
+  }
+  return images;
+}
+
+std::vector<std::vector<BinaryDescriptor> > MakeBinaryImages() {
+  math::RandomGenerator rng(0);
+  std::vector<std::vector<BinaryDescriptor> > scenes(kNumScenes);
+  unsigned char bytes[kDescriptorLength];
+  for (auto& scene : scenes) {
+    for (int ii = 0; ii < kDescriptorsPerScene; ++ii) {
+      for (int jj = 0; jj < kDescriptorLength; ++jj)
+        bytes[jj] = static_cast<unsigned char>(rng.Integer());
+      scene.push_back(BinaryDescriptor(bytes, kDescriptorLength));
+    }
+  }
+
+  // Flip a few random bits in each copy.
+  std::vector<std::vector<BinaryDescriptor> > images;
+  for (int ii = 0; ii < kNumScenes * kImagesPerScene; ++ii) {
+    std::vector<BinaryDescriptor> image;
+    for (const auto& descriptor : scenes[ii % kNumScenes]) {
+      std::memcpy(bytes, descriptor.Data(), kDescriptorLength);
+      for (int jj = 0; jj < 8; ++jj) {
+        const int bit = rng.IntegerUniform(0, 8 * kDescriptorLength - 1);
+        bytes[bit / 8] ^= static_cast<unsigned char>(1 << (bit % 8));
+      }
+      image.push_back(BinaryDescriptor(bytes, kDescriptorLength));
+    }
+    images.push_back(image);
+  }
+  return images;
+}
+
+// Check that the top candidates for each image view the same scene.
+template <typename DescriptorType>
+void TestRetrieval(const std::vector<std::vector<DescriptorType> >& images) {
+  VocabularyTree tree;
+  ASSERT_TRUE(tree.Train(images, 8, 3));
+  EXPECT_TRUE(tree.IsTrained());
+  EXPECT_LE(tree.NumWords(), 8u * 8u * 8u);
+
+  for (const auto& image : images)
+    tree.AddImage(image);
+  EXPECT_EQ(images.size(), tree.NumImages());
+
+  std::vector<int> candidates;
+  for (int ii = 0; ii < static_cast<int>(images.size()); ++ii) {
+    tree.Query(ii, kImagesPerScene - 1, candidates);
+    ASSERT_EQ(static_cast<size_t>(kImagesPerScene - 1), candidates.size());
+    for (const auto& candidate : candidates) {
+      EXPECT_NE(ii, candidate);
+      EXPECT_EQ(ii % kNumScenes, candidate % kNumScenes);
+      EXPECT_GT(tree.Score(ii, candidate), 0.0);
+    }
+  }
+}
+
+}  //\namespace
+
+TEST(VocabularyTree, TestRetrievalFloat) {
+  TestRetrieval(MakeImages());
+}
+
+TEST(VocabularyTree, TestRetrievalBinary) {
+  TestRetrieval(MakeBinaryImages());
+}
+
+TEST(VocabularyTree, TestIdenticalImagesScoreOne) {
+  std::vector<std::vector<Descriptor> > images = MakeImages();
+  VocabularyTree tree;
+  ASSERT_TRUE(tree.Train(images, 8, 3));
+  const int index1 = tree.AddImage(images[0]);
+  const int index2 = tree.AddImage(images[0]);
+  EXPECT_NEAR(1.0, tree.Score(index1, index2), 1e-8);
+}
+
+TEST(VocabularyTree, TestTwoImagesRetrieveEachOther) {
+  // Words seen in every training image should still be weighted, so that a
+  // tree trained on just two views of a scene retrieves one from the other.
+  std::vector<std::vector<Descriptor> > images = MakeImages();
+  images.resize(kNumScenes + 1);
+  images.erase(images.begin() + 1, images.begin() + kNumScenes);
+
+  VocabularyTree tree;
+  ASSERT_TRUE(tree.Train(images, 8, 3));
+  for (const auto& image : images)
+    tree.AddImage(image);
+
+  std::vector<int> candidates;
+  tree.Query(0, 1, candidates);
+  ASSERT_EQ(1u, candidates.size());
+  EXPECT_EQ(1, candidates[0]);
+  EXPECT_GT(tree.Score(0, 1), 0.0);
+}
+
+TEST(VocabularyTree, TestTrainRequiresDescriptors) {
+  VocabularyTree tree;
+  std::vector<std::vector<Descriptor> > images(3);
+  EXPECT_FALSE(tree.Train(images, 8, 3));
+  EXPECT_FALSE(tree.IsTrained());
+}
+
+}  //\namespace bsfm